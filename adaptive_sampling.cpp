@@ -0,0 +1,124 @@
+//
+// Stopping rules for samplers that draw until a confidence interval is narrow enough, instead of
+// for a fixed number of samples.
+//
+
+#include "adaptive_sampling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+tcount::running_moments::running_moments() : n(0), mean_(0.0), m2(0.0) {}
+
+void tcount::running_moments::add(double x) {
+    n += 1;
+    double delta = x - mean_;
+    mean_ += delta / n;
+    m2 += delta * (x - mean_);
+}
+
+/**
+ * Merges in a batch of samples given by their count, sum and sum of squares, as a sampler can keep
+ * per thread without any floating point state.
+ */
+void tcount::running_moments::add(unsigned long count, double sum, double sum_of_squares) {
+    if (count == 0) {
+        return;
+    }
+    double batch_mean = sum / count;
+    double batch_m2 = std::max(0.0, sum_of_squares - sum * batch_mean);
+    double delta = batch_mean - mean_;
+    unsigned long total = n + count;
+
+    mean_ += delta * count / total;
+    m2 += batch_m2 + delta * delta * (static_cast<double>(n) * count / total);
+    n = total;
+}
+
+unsigned long tcount::running_moments::count() const {
+    return n;
+}
+
+double tcount::running_moments::mean() const {
+    return mean_;
+}
+
+/**
+ * @return The unbiased sample variance, or 0 with fewer than two samples.
+ */
+double tcount::running_moments::variance() const {
+    return n < 2 ? 0.0 : m2 / (n - 1);
+}
+
+/**
+ * @param z The normal quantile of the confidence level, as returned by check_target.
+ * @return The half width of the normal approximation confidence interval around the mean.
+ */
+double tcount::running_moments::half_width(double z) const {
+    if (n == 0) {
+        return 0.0;
+    }
+    return z * std::sqrt(variance() / n);
+}
+
+/**
+ * @param target The relative error to reach.
+ * @param z The normal quantile of the target's confidence level, as returned by check_target.
+ * @return Whether enough samples have been drawn for the interval to meet the target. A mean of 0
+ * with no variance meets it, so a graph without triangles stops at min_samples.
+ */
+bool tcount::running_moments::reached(const sampling_target &target, double z) const {
+    if (n == 0 || n < target.min_samples) {
+        return false;
+    }
+    return half_width(z) <= target.relative_error * std::fabs(mean_);
+}
+
+tcount::sampling_estimate tcount::running_moments::estimate(const sampling_target &target, double z) const {
+    double half = half_width(z);
+    return sampling_estimate{mean_, std::max(0.0, mean_ - half), mean_ + half, n, reached(target, z)};
+}
+
+/**
+ * The inverse of the standard normal distribution function, found by bisection on erfc.
+ *
+ * @param p A probability in (0, 1).
+ * @return The z with P(Z <= z) = p.
+ */
+double tcount::normal_quantile(double p) {
+    if (!(p > 0.0 && p < 1.0)) {
+        throw std::invalid_argument("a normal quantile needs a probability strictly between 0 and 1");
+    }
+    double lo = -40.0, hi = 40.0;
+    for (int i = 0; i < 200; ++i) {
+        double mid = (lo + hi) / 2;
+        if (0.5 * std::erfc(-mid / std::sqrt(2.0)) < p) {
+            lo = mid;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return (lo + hi) / 2;
+}
+
+/**
+ * Checks a target before sampling starts and works out the quantile its interval is scaled by, so
+ * the bisection in normal_quantile runs once per target rather than once per check.
+ *
+ * @return The normal quantile of the target's confidence level, for reached and estimate.
+ * @throws std::invalid_argument If the target cannot be met by any number of samples.
+ */
+double tcount::check_target(const sampling_target &target) {
+    if (!(target.relative_error > 0.0)) {
+        throw std::invalid_argument("the relative error target must be positive");
+    }
+    if (!(target.confidence > 0.0 && target.confidence < 1.0)) {
+        throw std::invalid_argument("the confidence level must be strictly between 0 and 1");
+    }
+    if (target.max_samples < target.min_samples) {
+        throw std::invalid_argument("max_samples must be at least min_samples");
+    }
+    return normal_quantile(0.5 + target.confidence / 2);
+}
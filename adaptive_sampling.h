@@ -0,0 +1,56 @@
+//
+// Stopping rules for samplers that draw until a confidence interval is narrow enough, instead of
+// for a fixed number of samples.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_ADAPTIVE_SAMPLING_H
+#define TRIANGLECOUNTINGAPI_ADAPTIVE_SAMPLING_H
+
+namespace tcount {
+    struct sampling_target {
+        // stop once the half width of the interval is at most this fraction of the estimate
+        double relative_error = 0.01;
+        // the probability that the interval holds the true count
+        double confidence = 0.95;
+        // samples drawn before the interval is trusted, since the per sample estimates are skewed
+        unsigned long min_samples = 10000;
+        // give up here, with converged left false
+        unsigned long max_samples = 1000000000;
+    };
+
+    struct sampling_estimate {
+        double triangles;
+        // the confidence interval around triangles
+        double lower;
+        double upper;
+        unsigned long samples;
+        // whether the target was met before max_samples
+        bool converged;
+    };
+
+    /**
+     * The count, mean and sum of squared deviations of a stream of per sample estimates, updated
+     * with Welford's method, or merged from partial sums of other streams.
+     */
+    class running_moments {
+        unsigned long n;
+        double mean_;
+        double m2;
+
+    public:
+        running_moments();
+        void add(double x);
+        void add(unsigned long count, double sum, double sum_of_squares);
+        unsigned long count() const;
+        double mean() const;
+        double variance() const;
+        double half_width(double z) const;
+        bool reached(const sampling_target &target, double z) const;
+        sampling_estimate estimate(const sampling_target &target, double z) const;
+    };
+
+    double normal_quantile(double p);
+    double check_target(const sampling_target &target);
+}
+
+#endif //TRIANGLECOUNTINGAPI_ADAPTIVE_SAMPLING_H
@@ -7,6 +7,7 @@
 #include <unordered_set>
 #include <iostream>
 #include "adjacency_list_graph.h"
+#include "stats.h"
 
 
 tcount::adjacency_list_graph::adjacency_list_graph() {
@@ -17,6 +18,17 @@ tcount::adjacency_list_graph::~adjacency_list_graph() {
     delete g;
 }
 
+/**
+ * Add an edge e = (u, v) to the undirected graph.
+ *
+ * @param u The node u of edge e
+ * @param v The node v of the edge e
+ */
+void tcount::adjacency_list_graph::add_edge(unsigned long u, unsigned long v) {
+    (*g)[u].push_back(v);
+    (*g)[v].push_back(u);
+}
+
 std::vector<unsigned long> & tcount::adjacency_list_graph::operator[](unsigned long i) {
     return (*g)[i];
 }
@@ -33,38 +45,42 @@ unsigned long long int tcount::adjacency_list_graph::number_of_nodes() {
     return this->g->size();
 }
 
-bool node_order_sort(std::pair<unsigned int, unsigned int> vec1, std::pair<unsigned int, unsigned int> vec2) {
+bool node_order_sort(std::pair<unsigned long, unsigned long> vec1, std::pair<unsigned long, unsigned long> vec2) {
     return vec1.second < vec2.second;
 }
 
-unsigned long tcount::forward(tcount::adjacency_list_graph &g) {
-    // ( node_id, d(node_id) )
-    std::vector<std::pair<unsigned int, unsigned int>> sorted_node_order(g.number_of_nodes());
+unsigned long long tcount::forward(tcount::adjacency_list_graph &g) {
+    stats::phase_timer timer(stats::phase::count);
+    stats::local_counters counters;
+    // ( node_id, d(node_id) ), keeping the full width of the ids and degrees
+    std::vector<std::pair<unsigned long, unsigned long>> sorted_node_order(g.number_of_nodes());
     // node_id -> eta (index of element in sorted_node_order)
-    std::unordered_map<unsigned int, unsigned int> eta;
+    std::unordered_map<unsigned long, unsigned long> eta;
 
     unsigned long i = 0;
     for(auto pair: g) {
         sorted_node_order[i].first = pair.first;
-        sorted_node_order[i].second = static_cast<unsigned int>(pair.second.size());
+        sorted_node_order[i].second = pair.second.size();
         i += 1;
     }
 
     std::sort(sorted_node_order.begin(), sorted_node_order.end(), node_order_sort);
 
-    unsigned int eta_label = 0;
+    unsigned long eta_label = 0;
     for (auto node: sorted_node_order) {
         eta[node.first] = eta_label++;
     }
 
-    std::unordered_map<unsigned int, std::unordered_set<unsigned int>> a(g.number_of_nodes());
-    unsigned int T = 0;
+    std::unordered_map<unsigned long, std::unordered_set<unsigned long>> a(g.number_of_nodes());
+    unsigned long long T = 0;
 
     for (auto ordered_tuple: sorted_node_order) {
-        unsigned int s = ordered_tuple.first;
+        unsigned long s = ordered_tuple.first;
         for (auto t: g[s]) {
             if (eta[s] < eta[t]) {
                 // s is lower in degree
+                counters.add(stats::counter::intersections, 1);
+                counters.add(stats::counter::elements_compared, a[s].size());
                 for (auto v : a[s]) {
                     if (a[t].find(v) != a[t].end()) {
                         T += 1;
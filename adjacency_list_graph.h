@@ -14,6 +14,7 @@ namespace tcount {
     public:
         adjacency_list_graph();
         ~adjacency_list_graph();
+        void add_edge(unsigned long u, unsigned long v);
         std::vector<unsigned long> & operator [](unsigned long i);
         std::unordered_map<unsigned long, std::vector<unsigned long>>::iterator begin();
         std::unordered_map<unsigned long, std::vector<unsigned long>>::iterator end();
@@ -22,7 +23,7 @@ namespace tcount {
 }
 
 namespace tcount {
-    unsigned long forward(adjacency_list_graph &g);
+    unsigned long long forward(adjacency_list_graph &g);
 }
 
 #endif //TRIANGLECOUNTINGAPI_ADJACENCY_LIST_GRAPH_H
@@ -4,30 +4,169 @@
 
 #include "adjacency_matrix_graph.h"
 
+#include <cstdint>
+#include "intersection.h"
+#include "parallel.h"
+#include "stats.h"
 
+namespace {
+    // 64 bit words per 64 byte cache line
+    const size_t LINE_WORDS = 8;
+    // rows counted together, so each row they share a triangle with is loaded once for all of them
+    const unsigned long ROW_BLOCK = 8;
+}
+
+/**
+ * Creates an empty graph of the specified number of nodes, 0 to nodes - 1.
+ *
+ * @param nodes The number of nodes.
+ */
 tcount::adjacency_matrix_graph::adjacency_matrix_graph(unsigned long nodes) {
     this->size = nodes;
-    this->g = new std::vector<std::vector<unsigned long>>;
-    for (int i = 0; i < nodes; ++i) {
-        std::vector<unsigned long> inner;
-        inner.resize(nodes);
-        g->push_back(inner);
-    }
-}
+    this->words = ((nodes + 63) / 64 + LINE_WORDS - 1) / LINE_WORDS * LINE_WORDS;
 
-tcount::adjacency_matrix_graph::~adjacency_matrix_graph() {
-    delete g;
+    //one spare cache line so the first row can be moved onto a line boundary
+    storage.assign(words * nodes + LINE_WORDS, 0);
+    auto address = reinterpret_cast<std::uintptr_t>(storage.data());
+    this->offset = ((64 - address % 64) % 64) / sizeof(unsigned long long);
 }
 
+/**
+ * Add an undirected edge e = (u, v).
+ *
+ * @param u The node u of edge e
+ * @param v The node v of the edge e
+ */
 void tcount::adjacency_matrix_graph::add_edge(unsigned long u, unsigned long v) {
-    (*g)[u][v] = 1;
+    row_data(u)[v >> 6] |= 1ull << (v & 63);
+    row_data(v)[u >> 6] |= 1ull << (u & 63);
 }
 
+/**
+ * Remove the undirected edge e = (u, v).
+ *
+ * @param u The node u of edge e
+ * @param v The node v of the edge e
+ */
 void tcount::adjacency_matrix_graph::remove_edge(unsigned long u, unsigned long v) {
-    (*g)[u][v] = 0;
+    row_data(u)[v >> 6] &= ~(1ull << (v & 63));
+    row_data(v)[u >> 6] &= ~(1ull << (u & 63));
+}
+
+bool tcount::adjacency_matrix_graph::has_edge(unsigned long u, unsigned long v) const {
+    return (row_data(u)[v >> 6] >> (v & 63)) & 1;
+}
+
+/**
+ * @return A view of the neighbours of node i, without copying the row.
+ */
+tcount::adjacency_matrix_graph::row tcount::adjacency_matrix_graph::operator[](unsigned long i) const {
+    return row(row_data(i), size);
+}
+
+unsigned long tcount::adjacency_matrix_graph::number_of_nodes() const {
+    return size;
+}
+
+/**
+ * @return The length of every row in 64 bit words, padding included.
+ */
+size_t tcount::adjacency_matrix_graph::words_per_row() const {
+    return words;
+}
+
+unsigned long long* tcount::adjacency_matrix_graph::row_data(unsigned long i) {
+    return storage.data() + offset + i * words;
+}
+
+const unsigned long long* tcount::adjacency_matrix_graph::row_data(unsigned long i) const {
+    return storage.data() + offset + i * words;
 }
 
-std::vector<unsigned long> tcount::adjacency_matrix_graph::operator[](unsigned long i) {
-    return (*g)[i];
+tcount::adjacency_matrix_graph::row::row(const unsigned long long* bits, unsigned long size) {
+    this->bits = bits;
+    this->size_ = size;
 }
 
+bool tcount::adjacency_matrix_graph::row::operator[](unsigned long v) const {
+    return (bits[v >> 6] >> (v & 63)) & 1;
+}
+
+/**
+ * @return The bits of the row, 64 byte aligned.
+ */
+const unsigned long long* tcount::adjacency_matrix_graph::row::data() const {
+    return bits;
+}
+
+unsigned long tcount::adjacency_matrix_graph::row::size() const {
+    return size_;
+}
+
+/**
+ * Counts every triangle u < v < w once, as popcount(row u & row v) over the bits after v, for every
+ * edge u < v. Rows are taken ROW_BLOCK at a time, and every v adjacent to any row of the block is
+ * intersected with all of them while it is in cache. Blocks are shared out between threads.
+ *
+ * @param g The graph.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @return The number of triangles in the graph.
+ */
+unsigned long long tcount::count_triangles(const adjacency_matrix_graph &g, unsigned int threads) {
+    if (threads == 0) {
+        threads = default_threads();
+    }
+    stats::phase_timer timer(stats::phase::count);
+
+    unsigned long n = g.number_of_nodes();
+    size_t words = g.words_per_row();
+    unsigned long blocks = (n + ROW_BLOCK - 1) / ROW_BLOCK;
+    std::vector<unsigned long long> totals(threads, 0);
+
+    parallel_for_dynamic(0, blocks, 1, threads, [&](unsigned int t, size_t lo, size_t hi) {
+        unsigned long long count = 0;
+        stats::local_counters counters;
+        for (size_t block = lo; block < hi; ++block) {
+            unsigned long first = block * ROW_BLOCK;
+            unsigned long last = std::min(n, first + ROW_BLOCK);
+
+            for (size_t word = (first + 1) >> 6; word < words; ++word) {
+                unsigned long long candidates = 0;
+                for (unsigned long u = first; u < last; ++u) {
+                    candidates |= g[u].data()[word];
+                }
+
+                while (candidates != 0) {
+                    unsigned long v = word * 64 + static_cast<unsigned long>(__builtin_ctzll(candidates));
+                    candidates &= candidates - 1;
+                    if (v <= first) {
+                        continue;
+                    }
+
+                    //only the bits after v, so every triangle is counted from its two lowest nodes
+                    const unsigned long long* row_v = g[v].data();
+                    size_t start = (v + 1) >> 6;
+                    unsigned long long first_mask = ~0ull << ((v + 1) & 63);
+
+                    for (unsigned long u = first; u < last && u < v; ++u) {
+                        const unsigned long long* row_u = g[u].data();
+                        if (!((row_u[word] >> (v & 63)) & 1) || start >= words) {
+                            continue;
+                        }
+                        count += static_cast<unsigned long long>(__builtin_popcountll(row_u[start] & row_v[start] & first_mask));
+                        count += popcount_and(row_u + start + 1, row_v + start + 1, words - start - 1);
+                        counters.add(stats::counter::intersections, 1);
+                        counters.add(stats::counter::elements_compared, words - start);
+                    }
+                }
+            }
+        }
+        totals[t] += count;
+    });
+
+    unsigned long long total = 0;
+    for (unsigned long long t: totals) {
+        total += t;
+    }
+    return total;
+}
@@ -5,24 +5,55 @@
 #ifndef TRIANGLECOUNTINGAPI_ADJACENCY_MATRIX_GRAPH_H
 #define TRIANGLECOUNTINGAPI_ADJACENCY_MATRIX_GRAPH_H
 
+#include <cstddef>
 #include <vector>
 
 namespace tcount {
+    /*
+     * An undirected graph as a matrix of one bit per cell. Every row is padded to a whole number of
+     * 64 byte cache lines and starts on a cache line boundary.
+     */
     class adjacency_matrix_graph {
-        std::vector<std::vector<unsigned long>>* g;
+        std::vector<unsigned long long> storage;
+        // index in storage of the first, cache line aligned, row
+        size_t offset;
         unsigned long size;
+        size_t words;
 
     public:
+        // a read only view of one row, straight into the matrix
+        class row {
+            const unsigned long long* bits;
+            unsigned long size_;
+
+        public:
+            row(const unsigned long long* bits, unsigned long size);
+            bool operator [](unsigned long v) const;
+            const unsigned long long* data() const;
+            unsigned long size() const;
+        };
+
         explicit adjacency_matrix_graph(unsigned long nodes);
-        ~adjacency_matrix_graph();
+        adjacency_matrix_graph(const adjacency_matrix_graph &) = delete;
+        adjacency_matrix_graph& operator=(const adjacency_matrix_graph &) = delete;
+        adjacency_matrix_graph(adjacency_matrix_graph &&) = default;
+        adjacency_matrix_graph& operator=(adjacency_matrix_graph &&) = default;
+
         void add_edge(unsigned long u, unsigned long v);
         void remove_edge(unsigned long u, unsigned long v);
-        std::vector<unsigned long> operator [](unsigned long i);
+        bool has_edge(unsigned long u, unsigned long v) const;
+        row operator [](unsigned long i) const;
+        unsigned long number_of_nodes() const;
+        size_t words_per_row() const;
+
+    private:
+        unsigned long long* row_data(unsigned long i);
+        const unsigned long long* row_data(unsigned long i) const;
     };
 }
 
 namespace tcount {
-    //unsigned long count_triangles(adjacency_matrix_graph g);
+    unsigned long long count_triangles(const adjacency_matrix_graph &g, unsigned int threads = 0);
 }
 
 #endif //TRIANGLECOUNTINGAPI_ADJACENCY_MATRIX_GRAPH_H
@@ -0,0 +1,1162 @@
+//
+// Benchmarks for the triangle counting api.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "edge_list_reader.h"
+#include "csr_graph.h"
+#include "sampler_edge_array.h"
+#include "adjacency_list_graph.h"
+#include "oriented_graph.h"
+#include "intersection.h"
+#include "csr_builder.h"
+#include "gps_post_stream.h"
+#include "gps_reservoir.h"
+#include "doulion.h"
+#include "dynamic_graph.h"
+#include "adjacency_matrix_graph.h"
+#include "masked_spgemm.h"
+#include "counting_engine.h"
+#include "truss.h"
+#include "out_of_core.h"
+#include "reorder.h"
+#include "generators.h"
+#include "sampler.h"
+#include "wedge_sampler.h"
+#include "gps_sharded.h"
+#include <cmath>
+#include <fstream>
+#include <random>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Compares the throughput of the fscanf loop the cli used to read edge lists with with the
+ * memory mapped edge_list_reader.
+ */
+void parse_benchmark(const char* filename, unsigned int threads) {
+    unsigned long fscanf_edges = 0;
+    unsigned long checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    {
+        FILE *file = fopen(filename, "r");
+        unsigned long x, y;
+        int matched;
+        while ((matched = fscanf(file, "%lu %lu\n", &x, &y)) != EOF) {
+            if (matched != 2) {
+                //the cli's loop spins forever on comment lines, so skip them here
+                if (fscanf(file, "%*[^\n]\n") == EOF) {
+                    break;
+                }
+                continue;
+            }
+            fscanf_edges += 1;
+            checksum += x ^ y;
+        }
+        fclose(file);
+    }
+    double fscanf_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    tcount::edge_list_reader reader(filename, threads);
+    unsigned long batch_edges = 0;
+    reader.for_each_batch([&](const tcount::edge* edges, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            checksum += edges[i].first ^ edges[i].second;
+        }
+        batch_edges += count;
+    });
+    double batch_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    auto edges = reader.read_edges();
+    double read_time = seconds_since(start);
+
+    double mb = reader.size() / 1e6;
+    std::cout << "file: " << filename << " (" << mb << " MB), threads: " << reader.number_of_threads() << std::endl;
+    std::cout << "fscanf:         " << fscanf_edges << " edges, " << mb / fscanf_time << " MB/s" << std::endl;
+    std::cout << "for_each_batch: " << batch_edges << " edges, " << mb / batch_time << " MB/s" << std::endl;
+    std::cout << "read_edges:     " << edges.size() << " edges, " << mb / read_time << " MB/s" << std::endl;
+    std::cout << "(checksum " << checksum << ")" << std::endl;
+}
+
+/**
+ * Compares building the CSR from a text edge list with mapping the same graph from a .tcsr file.
+ */
+void load_benchmark(const char* filename, const char* csr_filename) {
+    auto start = std::chrono::steady_clock::now();
+    tcount::sampler_edge_array built;
+    tcount::edge_list_reader reader(filename);
+    reader.feed(built);
+    built.build_edge_array(true);
+    double build_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    tcount::csr_graph mapped(csr_filename);
+    double map_time = seconds_since(start);
+
+    std::cout << "text + build_edge_array: " << build_time * 1e3 << " ms ("
+              << built.graph().number_of_edges() << " edges)" << std::endl;
+    std::cout << "mapped .tcsr:            " << map_time * 1e3 << " ms ("
+              << mapped.number_of_edges() << " edges)" << std::endl;
+}
+
+/**
+ * Compares building the CSR through sampler_edge_array's hash sets with build_csr on the raw edge
+ * buffer.
+ */
+void build_benchmark(const char* filename, unsigned int threads) {
+    tcount::edge_list_reader reader(filename, threads);
+    std::vector<tcount::edge> edges = reader.read_edges();
+    size_t buffer_bytes = edges.size() * sizeof(tcount::edge);
+
+    auto start = std::chrono::steady_clock::now();
+    tcount::sampler_edge_array hashed;
+    for (const auto &e: edges) {
+        hashed.add_edge(e.first, e.second);
+    }
+    hashed.build_edge_array(true);
+    double hash_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    tcount::csr_graph built = tcount::build_csr(std::move(edges), threads);
+    double build_time = seconds_since(start);
+
+    size_t csr_bytes = (built.number_of_nodes() * 2 + 1 + built.size_of_edge_array()) * sizeof(unsigned long);
+    std::cout << "edge buffer: " << buffer_bytes / 1e6 << " MB, csr: " << csr_bytes / 1e6 << " MB" << std::endl;
+    std::cout << "build_edge_array: " << hash_time * 1e3 << " ms (" << hashed.graph().number_of_nodes() << " nodes, "
+              << hashed.graph().number_of_edges() << " edges)" << std::endl;
+    std::cout << "build_csr:        " << build_time * 1e3 << " ms (" << built.number_of_nodes() << " nodes, "
+              << built.number_of_edges() << " edges)" << std::endl;
+}
+
+/**
+ * Compares the ingestion rate of gps_post_stream with gps_reservoir, in edges per second. The edges
+ * are read up front so only add_edge is timed.
+ */
+void gps_benchmark(const char* filename, unsigned long res_size) {
+    tcount::edge_list_reader reader(filename);
+    std::vector<tcount::edge> edges = reader.read_edges();
+
+    auto start = std::chrono::steady_clock::now();
+    tcount::gps_post_stream post_stream(res_size);
+    for (const auto &e: edges) {
+        post_stream.add_edge(e.first, e.second);
+    }
+    double post_stream_time = seconds_since(start);
+    unsigned long long post_stream_estimate = post_stream.compute_triangle_count();
+
+    start = std::chrono::steady_clock::now();
+    tcount::gps_reservoir reservoir(res_size, 1);
+    for (const auto &e: edges) {
+        reservoir.add_edge(e.first, e.second);
+    }
+    double reservoir_time = seconds_since(start);
+    unsigned long long reservoir_estimate = reservoir.compute_triangle_count();
+
+    std::cout << "reservoir: " << res_size << " edges, stream: " << edges.size() << " edges" << std::endl;
+    std::cout << "gps_post_stream: " << edges.size() / post_stream_time << " edges/s, estimate "
+              << post_stream_estimate << std::endl;
+    std::cout << "gps_reservoir:   " << edges.size() / reservoir_time << " edges/s, estimate "
+              << reservoir_estimate << std::endl;
+}
+
+/**
+ * Compares the input stage of the old DOULION modes, fscanf and a coin flip per edge, with the
+ * doulion stage's geometric skipping.
+ */
+void doulion_benchmark(const char* filename, double p, unsigned int threads) {
+    unsigned long coin_edges = 0;
+    unsigned long checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::mt19937 mt(1);
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        FILE *file = fopen(filename, "r");
+        unsigned long x, y;
+        int matched;
+        while ((matched = fscanf(file, "%lu %lu\n", &x, &y)) != EOF) {
+            if (matched != 2) {
+                if (fscanf(file, "%*[^\n]\n") == EOF) {
+                    break;
+                }
+                continue;
+            }
+            if (dist(mt) < p) {
+                coin_edges += 1;
+                checksum += x ^ y;
+            }
+        }
+        fclose(file);
+    }
+    double coin_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    tcount::doulion stage(p, 1, threads);
+    std::vector<tcount::edge> kept = stage.sparsify(filename);
+    double stage_time = seconds_since(start);
+    for (const auto &e: kept) {
+        checksum += e.first ^ e.second;
+    }
+
+    std::cout << "p = " << p << std::endl;
+    std::cout << "fscanf + coin flips: " << coin_edges << " edges kept, " << coin_time * 1e3 << " ms" << std::endl;
+    std::cout << "doulion::sparsify:   " << kept.size() << " edges kept, " << stage_time * 1e3 << " ms ("
+              << coin_time / stage_time << "x)" << std::endl;
+    std::cout << "(checksum " << checksum << ")" << std::endl;
+}
+
+/**
+ * Update throughput of dynamic_graph, one edge at a time and in batches, against recounting the
+ * whole graph with forward_oriented after every batch.
+ */
+void dynamic_benchmark(const char* filename, size_t batch_size, unsigned int threads) {
+    tcount::edge_list_reader reader(filename, threads);
+    std::vector<tcount::edge> edges = reader.read_edges();
+
+    auto start = std::chrono::steady_clock::now();
+    tcount::dynamic_graph single(false, threads);
+    for (const auto &e: edges) {
+        single.insert_edge(e.first, e.second);
+    }
+    double single_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    tcount::dynamic_graph batched(false, threads);
+    std::vector<tcount::edge> none;
+    for (size_t i = 0; i < edges.size(); i += batch_size) {
+        std::vector<tcount::edge> batch(edges.begin() + i, edges.begin() + std::min(edges.size(), i + batch_size));
+        batched.apply(batch, none);
+    }
+    double insert_time = seconds_since(start);
+
+    //delete every tenth edge, a batch at a time
+    std::vector<tcount::edge> deletions;
+    for (size_t i = 0; i < edges.size(); i += 10) {
+        deletions.push_back(edges[i]);
+    }
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < deletions.size(); i += batch_size) {
+        std::vector<tcount::edge> batch(deletions.begin() + i,
+                                        deletions.begin() + std::min(deletions.size(), i + batch_size));
+        batched.apply(none, batch);
+    }
+    double delete_time = seconds_since(start);
+
+    std::vector<tcount::edge> remaining;
+    for (size_t i = 0; i < edges.size(); ++i) {
+        if (i % 10 != 0) {
+            remaining.push_back(edges[i]);
+        }
+    }
+    start = std::chrono::steady_clock::now();
+    tcount::oriented_graph oriented{tcount::build_csr(std::move(remaining), threads)};
+    unsigned long long recount = tcount::forward_oriented(oriented, threads);
+    double recount_time = seconds_since(start);
+
+    std::cout << "insert_edge:      " << edges.size() / single_time << " edges/s, "
+              << single.number_of_triangles() << " triangles" << std::endl;
+    std::cout << "batched inserts:  " << edges.size() / insert_time << " edges/s (batches of " << batch_size << ")"
+              << std::endl;
+    std::cout << "batched deletes:  " << deletions.size() / delete_time << " edges/s, "
+              << batched.number_of_triangles() << " triangles left" << std::endl;
+    std::cout << "full recount:     " << recount_time * 1e3 << " ms, " << recount << " triangles, so "
+              << batch_size / recount_time << " edges/s if recounting after every batch" << std::endl;
+}
+
+/**
+ * Counts the triangles of a graph with the bit matrix and with forward_oriented. Meant for dense
+ * graphs of up to around 100k nodes: the matrix takes n^2 / 8 bytes.
+ */
+void matrix_benchmark(const char* filename, unsigned int threads) {
+    tcount::edge_list_reader reader(filename, threads);
+    tcount::csr_graph graph = tcount::build_csr(reader.read_edges(), threads);
+
+    auto start = std::chrono::steady_clock::now();
+    tcount::adjacency_matrix_graph matrix(graph.number_of_nodes());
+    for (unsigned long u = 0; u < graph.number_of_nodes(); ++u) {
+        for (const unsigned long* v = graph.neighbours_begin(u); v != graph.neighbours_end(u); ++v) {
+            matrix.add_edge(u, *v);
+        }
+    }
+    double fill_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    unsigned long long matrix_count = tcount::count_triangles(matrix, threads);
+    double matrix_time = seconds_since(start);
+
+    tcount::oriented_graph oriented(graph);
+    start = std::chrono::steady_clock::now();
+    unsigned long long forward_count = tcount::forward_oriented(oriented, threads == 0 ? tcount::default_threads() : threads);
+    double forward_time = seconds_since(start);
+
+    std::cout << "nodes: " << graph.number_of_nodes() << ", edges: " << graph.number_of_edges() << ", density: "
+              << 2.0 * graph.number_of_edges() / (double(graph.number_of_nodes()) * graph.number_of_nodes()) << std::endl;
+    std::cout << "matrix:           " << matrix_count << " triangles, " << matrix_time * 1e3 << " ms ("
+              << fill_time * 1e3 << " ms filling " << matrix.words_per_row() * 8.0 * matrix.number_of_nodes() / 1e6
+              << " MB)" << std::endl;
+    std::cout << "forward_oriented: " << forward_count << " triangles, " << forward_time * 1e3 << " ms" << std::endl;
+}
+
+/**
+ * Times every exact engine on the same oriented graph, along with the work the cost model of
+ * choose_engine estimates for each, and shows the engine it picks. The costs in choose_engine were
+ * calibrated from this output. The matrix is skipped for graphs of more than 100k nodes. The
+ * forward and product engines are timed again with 32 bit ranks.
+ */
+void engines_benchmark(const char* filename, unsigned int threads) {
+    tcount::edge_list_reader reader(filename, threads);
+    tcount::csr_graph graph = tcount::build_csr(reader.read_edges(), threads);
+    tcount::oriented_graph oriented(graph);
+    if (threads == 0) {
+        threads = tcount::default_threads();
+    }
+
+    double wedges = 0;
+    for (unsigned long u = 0; u < oriented.number_of_nodes(); ++u) {
+        for (const unsigned long* w = oriented.out_begin(u); w != oriented.out_end(u); ++w) {
+            wedges += static_cast<double>(oriented.out_degree(*w));
+        }
+    }
+    double matrix_words = static_cast<double>((oriented.number_of_nodes() + 511) / 512 * 8) * oriented.number_of_edges();
+    std::cout << "nodes: " << oriented.number_of_nodes() << ", edges: " << oriented.number_of_edges()
+              << ", wedges: " << wedges << ", matrix words: " << matrix_words << std::endl;
+
+    auto time = [&](const char* name, const std::function<unsigned long long()> &count) {
+        auto start = std::chrono::steady_clock::now();
+        unsigned long long triangles = count();
+        double elapsed = seconds_since(start);
+        std::cout << name << triangles << " triangles, " << elapsed * 1e3 << " ms" << std::endl;
+    };
+
+    time("forward:        ", [&]() { return tcount::forward_oriented(oriented, threads); });
+    time("spgemm (hash):  ", [&]() { return tcount::masked_spgemm(oriented, threads, tcount::spgemm_accumulator::hash); });
+    time("spgemm (dense): ", [&]() { return tcount::masked_spgemm(oriented, threads, tcount::spgemm_accumulator::dense); });
+    if (oriented.number_of_nodes() <= 100000) {
+        time("matrix:         ", [&]() { return tcount::count_triangles(oriented, tcount::counting_engine::matrix, threads); });
+    }
+
+    //the same graph with 32 bit ranks
+    tcount::compact_oriented_graph compact(graph);
+    std::cout << "oriented graph: " << oriented.memory_bytes() / 1e6 << " MB with 64 bit ranks, "
+              << compact.memory_bytes() / 1e6 << " MB with 32 bit ranks" << std::endl;
+    time("forward (32):   ", [&]() { return tcount::forward_oriented(compact, threads); });
+    time("spgemm (32):    ", [&]() { return tcount::masked_spgemm(compact, threads, tcount::spgemm_accumulator::dense); });
+    std::cout << "auto picks " << tcount::engine_name(tcount::choose_engine(oriented)) << std::endl;
+}
+
+/**
+ * Times the per edge support pass against the plain forward count it extends, then the truss
+ * decomposition, on a graph meant to be large (10^8 edges or more).
+ */
+void truss_benchmark(const char* filename, unsigned int threads) {
+    tcount::edge_list_reader reader(filename, threads);
+    tcount::oriented_graph oriented{tcount::build_csr(reader.read_edges(), threads)};
+    if (threads == 0) {
+        threads = tcount::default_threads();
+    }
+    std::cout << "nodes: " << oriented.number_of_nodes() << ", edges: " << oriented.number_of_edges()
+              << ", threads: " << threads << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    unsigned long long triangles = tcount::forward_oriented(oriented, threads);
+    double forward_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<unsigned int> support = tcount::edge_support(oriented, threads);
+    double support_time = seconds_since(start);
+    unsigned long long support_total = 0;
+    for (unsigned int s: support) {
+        support_total += s;
+    }
+
+    start = std::chrono::steady_clock::now();
+    std::vector<unsigned int> truss = tcount::truss_decomposition(oriented, threads);
+    double truss_time = seconds_since(start);
+
+    std::cout << "forward:  " << triangles << " triangles, " << forward_time * 1e3 << " ms" << std::endl;
+    std::cout << "support:  " << support_total / 3 << " triangles, " << support_time * 1e3 << " ms" << std::endl;
+    std::cout << "truss:    max k " << *std::max_element(truss.begin(), truss.end()) << ", " << truss_time * 1e3
+              << " ms (support included), " << oriented.number_of_edges() / truss_time / 1e6 << " M edges/s" << std::endl;
+}
+
+/**
+ * Counts a graph out of core under shrinking memory budgets, to show how the running time and the
+ * disk traffic grow as the partitions get smaller.
+ */
+void external_benchmark(const char* filename, const char* temp_dir, const std::vector<size_t> &budgets_mib,
+                        unsigned int threads) {
+    for (size_t budget: budgets_mib) {
+        tcount::out_of_core_counter counter(budget * 1024 * 1024, temp_dir, threads);
+        auto start = std::chrono::steady_clock::now();
+        unsigned long long triangles = counter.count_triangles(filename);
+        double elapsed = seconds_since(start);
+
+        std::cout << budget << " MiB: " << triangles << " triangles, " << elapsed * 1e3 << " ms, "
+                  << counter.number_of_partitions() << " partitions, "
+                  << counter.bytes_written() / (1024.0 * 1024.0) << " MiB written, "
+                  << counter.bytes_read() / (1024.0 * 1024.0) << " MiB read" << std::endl;
+    }
+}
+
+/**
+ * Counts the last level cache misses of the calling process between start and stop, through
+ * perf_event_open. Where the counter is not available (not Linux, or perf_event_paranoid forbids
+ * it) available() is false and stop returns 0.
+ */
+class cache_miss_counter {
+    int fd = -1;
+
+public:
+    cache_miss_counter() {
+#ifdef __linux__
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    ~cache_miss_counter() {
+#ifdef __linux__
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+
+    cache_miss_counter(const cache_miss_counter&) = delete;
+    cache_miss_counter& operator=(const cache_miss_counter&) = delete;
+
+    bool available() const {
+        return fd >= 0;
+    }
+
+    void start() {
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    unsigned long long stop() {
+        unsigned long long misses = 0;
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &misses, sizeof(misses)) != sizeof(misses)) {
+                misses = 0;
+            }
+        }
+#endif
+        return misses;
+    }
+};
+
+/**
+ * Renumbers a graph by every vertex ordering and times edge and wedge sampling on the result, with
+ * the cache misses each incurs. Both read the CSR directly. The exact engines are left out, as
+ * they renumber the nodes by degree rank whatever the ordering.
+ */
+void reorder_benchmark(const char* filename, unsigned int threads, unsigned long samples) {
+    tcount::edge_list_reader reader(filename, threads);
+    tcount::csr_graph graph = tcount::build_csr(reader.read_edges(), threads);
+    if (threads == 0) {
+        threads = tcount::default_threads();
+    }
+    std::cout << "nodes: " << graph.number_of_nodes() << ", edges: " << graph.number_of_edges()
+              << ", threads: " << threads << std::endl;
+
+    cache_miss_counter misses;
+    if (!misses.available()) {
+        std::cout << "cache miss counter unavailable, misses are reported as n/a" << std::endl;
+    }
+    auto time = [&](const char* name, const std::function<unsigned long long()> &run) {
+        misses.start();
+        auto start = std::chrono::steady_clock::now();
+        unsigned long long result = run();
+        double elapsed = seconds_since(start);
+        unsigned long long count = misses.stop();
+
+        std::cout << "  " << name << result << " triangles, " << elapsed * 1e3 << " ms, ";
+        if (misses.available()) {
+            std::cout << count / 1e6 << " M misses" << std::endl;
+        }
+        else {
+            std::cout << "n/a misses" << std::endl;
+        }
+    };
+
+    const tcount::vertex_order orders[] = {tcount::vertex_order::original, tcount::vertex_order::degree,
+                                           tcount::vertex_order::rcm, tcount::vertex_order::hub_cluster,
+                                           tcount::vertex_order::gorder};
+    for (tcount::vertex_order order: orders) {
+        std::cout << tcount::order_name(order) << ":" << std::endl;
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<unsigned long> permutation = tcount::compute_order(graph, order);
+        double order_time = seconds_since(start);
+        start = std::chrono::steady_clock::now();
+        tcount::csr_graph reordered = tcount::reorder(graph, permutation, threads);
+        double apply_time = seconds_since(start);
+        std::cout << "  ordering " << order_time * 1e3 << " ms, renumbering " << apply_time * 1e3 << " ms" << std::endl;
+
+        tcount::sampler_edge_array sampler{std::move(reordered)};
+        time("sampling: ", [&]() { return static_cast<unsigned long long>(sampler.sample_triangles(samples, threads, 1)); });
+        tcount::wedge_sampler wedges(sampler.graph());
+        time("wedges:   ", [&]() {
+            return static_cast<unsigned long long>(wedges.sample_wedges(samples, threads, 1).triangles);
+        });
+    }
+}
+
+/**
+ * Compares the hash based tcount::forward with forward_oriented on the same graph.
+ */
+void forward_benchmark(const char* filename) {
+    tcount::adjacency_list_graph g;
+    tcount::edge_list_reader reader(filename);
+    reader.feed(g);
+
+    auto start = std::chrono::steady_clock::now();
+    unsigned long long hashed = tcount::forward(g);
+    double hashed_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    tcount::oriented_graph oriented(g);
+    double orient_time = seconds_since(start);
+    start = std::chrono::steady_clock::now();
+    unsigned long long merged = tcount::forward_oriented(oriented);
+    double count_time = seconds_since(start);
+
+    std::cout << "forward:          " << hashed << " triangles, " << hashed_time * 1e3 << " ms" << std::endl;
+    std::cout << "forward_oriented: " << merged << " triangles, " << orient_time * 1e3 << " ms orienting + "
+              << count_time * 1e3 << " ms counting" << std::endl;
+}
+
+/**
+ * Strong scaling of the parallel forward_oriented and sampler_edge_array::sample_triangles, from 1
+ * thread up to max_threads.
+ */
+void scaling_benchmark(const char* filename, unsigned int max_threads, unsigned long samples) {
+    if (max_threads == 0) {
+        max_threads = tcount::default_threads();
+    }
+
+    tcount::sampler_edge_array sampler;
+    tcount::edge_list_reader reader(filename);
+    reader.feed(sampler);
+    sampler.build_edge_array(true);
+    tcount::oriented_graph oriented(sampler.graph());
+
+    //powers of two, then max_threads itself
+    std::vector<unsigned int> thread_counts;
+    for (unsigned int threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    double base_time = 0;
+    for (unsigned int threads: thread_counts) {
+        auto start = std::chrono::steady_clock::now();
+        unsigned long long T = tcount::forward_oriented(oriented, threads);
+        double time = seconds_since(start);
+        if (threads == 1) {
+            base_time = time;
+        }
+
+        std::cout << "forward_oriented threads: " << threads << ", triangles: " << T << ", " << time * 1e3
+                  << " ms, speedup " << base_time / time << std::endl;
+    }
+
+    for (unsigned int threads: thread_counts) {
+        auto start = std::chrono::steady_clock::now();
+        unsigned long estimate = sampler.sample_triangles(samples, threads, 42);
+        double time = seconds_since(start);
+        if (threads == 1) {
+            base_time = time;
+        }
+
+        std::cout << "sample_triangles threads: " << threads << ", estimate: " << estimate << ", " << time * 1e3
+                  << " ms, speedup " << base_time / time << std::endl;
+    }
+}
+
+template<typename T>
+std::vector<T> random_sorted_set(size_t size, T universe, std::mt19937_64 &mt) {
+    std::uniform_int_distribution<T> dist(0, universe - 1);
+    std::vector<T> set;
+    while (set.size() < size) {
+        while (set.size() < size) {
+            set.push_back(dist(mt));
+        }
+        std::sort(set.begin(), set.end());
+        set.erase(std::unique(set.begin(), set.end()), set.end());
+    }
+    return set;
+}
+
+template<typename T>
+void intersect_benchmark_width(const char* width) {
+    std::mt19937_64 mt(42);
+    const size_t small_size = 256;
+    const size_t pairs = 64;
+
+    for (size_t ratio: {1, 4, 16, 64, 256, 1024}) {
+        size_t large_size = small_size * ratio;
+        //a dense universe so the sets actually overlap
+        auto universe = static_cast<T>(large_size * 4);
+
+        std::vector<std::vector<T>> small_sets, large_sets;
+        for (size_t i = 0; i < pairs; ++i) {
+            small_sets.push_back(random_sorted_set<T>(small_size, universe, mt));
+            large_sets.push_back(random_sorted_set<T>(large_size, universe, mt));
+        }
+
+        auto run = [&](const char* name, unsigned long (*kernel)(const T*, size_t, const T*, size_t)) {
+            unsigned long total = 0;
+            size_t repeats = std::max<size_t>(1, 4096 / ratio);
+            auto start = std::chrono::steady_clock::now();
+            for (size_t r = 0; r < repeats; ++r) {
+                for (size_t i = 0; i < pairs; ++i) {
+                    total += kernel(small_sets[i].data(), small_size, large_sets[i].data(), large_size);
+                }
+            }
+            double ns = seconds_since(start) * 1e9 / (repeats * pairs);
+            std::cout << width << " 1:" << ratio << " " << name << ": " << ns << " ns per intersection (matches "
+                      << total / repeats << ")" << std::endl;
+        };
+
+        run("merge loop", tcount::intersection_count_merge);
+        run("galloping", tcount::intersection_count_galloping);
+        for (auto level: {tcount::simd_level::scalar, tcount::simd_level::sse42,
+                          tcount::simd_level::avx2, tcount::simd_level::avx512}) {
+            if (level > tcount::detected_simd_level()) {
+                continue;
+            }
+            tcount::set_simd_level(level);
+            std::string name = std::string("dispatch ") + tcount::simd_level_name(level);
+            run(name.c_str(), tcount::intersection_count);
+        }
+        tcount::set_simd_level(tcount::detected_simd_level());
+    }
+}
+
+/**
+ * Compares the merge loop the engines used to run with the intersection kernels across size ratios.
+ */
+void intersect_benchmark() {
+    intersect_benchmark_width<unsigned int>("32 bit");
+    intersect_benchmark_width<unsigned long long>("64 bit");
+}
+
+/**
+ * Compares forward_oriented and sampler_edge_array::sample_triangles with and without hub bitmaps.
+ */
+void hubs_benchmark(const char* filename, unsigned long threshold, unsigned long samples) {
+    tcount::sampler_edge_array sampler;
+    tcount::edge_list_reader reader(filename);
+    reader.feed(sampler);
+    sampler.build_edge_array(true);
+    tcount::oriented_graph oriented(sampler.graph());
+
+    if (threshold == 0) {
+        threshold = tcount::hub_index::choose_threshold(oriented.node_array(), oriented.number_of_nodes(),
+                                                        oriented.number_of_edges() * sizeof(unsigned long) / 2);
+    }
+    tcount::hub_index oriented_hubs(oriented.node_array(), oriented.edge_array(), oriented.number_of_nodes(), threshold);
+
+    auto start = std::chrono::steady_clock::now();
+    unsigned long long plain = tcount::forward_oriented(oriented, 1);
+    double plain_time = seconds_since(start);
+    start = std::chrono::steady_clock::now();
+    unsigned long long with_hubs = tcount::forward_oriented(oriented, 1, &oriented_hubs);
+    double hubs_time = seconds_since(start);
+
+    std::cout << "forward_oriented:           " << plain << " triangles, " << plain_time * 1e3 << " ms" << std::endl;
+    std::cout << "forward_oriented with hubs: " << with_hubs << " triangles, " << hubs_time * 1e3 << " ms ("
+              << oriented_hubs.number_of_hubs() << " hubs of out degree >= " << oriented_hubs.threshold() << ", "
+              << oriented_hubs.memory_bytes() << " bytes)" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    unsigned long estimate = sampler.sample_triangles(samples);
+    double sample_time = seconds_since(start);
+    const tcount::hub_index &hubs = sampler.build_hub_index(0);
+    start = std::chrono::steady_clock::now();
+    unsigned long hub_estimate = sampler.sample_triangles(samples);
+    double hub_sample_time = seconds_since(start);
+
+    std::cout << "sample_triangles:           " << estimate << ", " << sample_time * 1e3 << " ms" << std::endl;
+    std::cout << "sample_triangles with hubs: " << hub_estimate << ", " << hub_sample_time * 1e3 << " ms ("
+              << hubs.number_of_hubs() << " hubs of degree >= " << hubs.threshold() << ", "
+              << hubs.memory_bytes() << " bytes)" << std::endl;
+}
+
+/**
+ * Runs both samplers adaptively with several seeds and reports how many samples each took and how
+ * often the confidence interval held the exact count, which should be about the confidence level.
+ */
+void adaptive_benchmark(const char* filename, double relative_error, double confidence, unsigned int runs) {
+    tcount::edge_list_reader reader(filename);
+    tcount::sampler hash_sampler;
+    reader.feed(hash_sampler);
+    tcount::sampler_edge_array sampler{tcount::build_csr(reader.read_edges())};
+    unsigned long long exact = tcount::forward_oriented(sampler.graph());
+
+    tcount::sampling_target target;
+    target.relative_error = relative_error;
+    target.confidence = confidence;
+    std::cout << "exact: " << exact << ", target: " << relative_error * 100 << "% at " << confidence * 100
+              << "% confidence" << std::endl;
+
+    auto report = [&](const char* name, const std::function<tcount::sampling_estimate(unsigned long long)> &run) {
+        unsigned int covered = 0;
+        unsigned long long samples = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int seed = 1; seed <= runs; ++seed) {
+            tcount::sampling_estimate estimate = run(seed);
+            samples += estimate.samples;
+            covered += estimate.lower <= exact && exact <= estimate.upper ? 1 : 0;
+        }
+        double elapsed = seconds_since(start);
+        std::cout << name << samples / runs << " samples per run, " << elapsed / runs * 1e3 << " ms per run, interval held "
+                  << covered << " of " << runs << std::endl;
+    };
+
+    report("sampler:            ", [&](unsigned long long seed) { return hash_sampler.sample_triangles(target, seed); });
+    report("sampler_edge_array: ", [&](unsigned long long seed) { return sampler.sample_triangles(target, 0, seed); });
+}
+
+/**
+ * Accuracy against time of the hash sampler, the edge array sampler and the wedge sampler, at
+ * sample sizes from 1000 up to max_samples: the mean relative error over several seeds and the
+ * mean time of a run. The hash sampler is single threaded.
+ */
+void wedges_benchmark(const char* filename, unsigned int threads, unsigned int runs, unsigned long max_samples) {
+    tcount::edge_list_reader reader(filename);
+    tcount::sampler hash_sampler;
+    reader.feed(hash_sampler);
+    tcount::sampler_edge_array sampler{tcount::build_csr(reader.read_edges())};
+    auto start = std::chrono::steady_clock::now();
+    tcount::wedge_sampler wedges(sampler.graph());
+    double alias_time = seconds_since(start);
+    auto exact = static_cast<double>(tcount::forward_oriented(sampler.graph()));
+
+    std::cout << "exact: " << exact << ", wedges: " << wedges.number_of_wedges() << ", transitivity: "
+              << 3 * exact / wedges.number_of_wedges() << ", alias table: " << alias_time * 1e3 << " ms" << std::endl;
+
+    auto report = [&](const char* name, unsigned long samples, const std::function<double(unsigned long long)> &estimate) {
+        double error = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int seed = 1; seed <= runs; ++seed) {
+            error += std::fabs(estimate(seed) - exact) / exact;
+        }
+        double elapsed = seconds_since(start);
+        std::cout << name << samples << " samples: mean error " << error / runs * 100 << "%, "
+                  << elapsed / runs * 1e3 << " ms per run" << std::endl;
+    };
+
+    for (unsigned long samples = 1000; samples <= max_samples; samples *= 10) {
+        report("sampler:            ", samples, [&](unsigned long long seed) {
+            return static_cast<double>(hash_sampler.sample_triangles(samples, seed));
+        });
+        report("sampler_edge_array: ", samples, [&](unsigned long long seed) {
+            return static_cast<double>(sampler.sample_triangles(samples, threads, seed));
+        });
+        report("wedge_sampler:      ", samples, [&](unsigned long long seed) {
+            return wedges.sample_wedges(samples, threads, seed).triangles;
+        });
+    }
+}
+
+/**
+ * Resets the peak resident set size of the process to its current size, so the next reading of
+ * peak_rss_bytes covers only what ran in between. Only Linux supports this.
+ *
+ * @return Whether the peak was reset.
+ */
+bool reset_peak_rss() {
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    if (!clear_refs) {
+        return false;
+    }
+    clear_refs << "5";
+    clear_refs.flush();
+    return static_cast<bool>(clear_refs);
+}
+
+/**
+ * @return The peak resident set size of the process in bytes, or 0 where it cannot be read.
+ */
+size_t peak_rss_bytes() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::stoul(line.substr(6)) * 1024;
+        }
+    }
+#ifndef _WIN32
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        //kilobytes on Linux, bytes on macOS
+#ifdef __APPLE__
+        return static_cast<size_t>(usage.ru_maxrss);
+#else
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+    }
+#endif
+    return 0;
+}
+
+// one timed run of the suite
+struct suite_run {
+    std::string graph;
+    unsigned long nodes;
+    unsigned long edges;
+    std::string engine;
+    unsigned int threads;
+    // samples, reservoir size or DOULION p, 0 when the engine has none
+    double parameter;
+    double triangles;
+    unsigned long long exact;
+    double seconds;
+    size_t peak_rss;
+};
+
+void write_suite_json(std::ostream &out, const std::vector<suite_run> &runs, bool rss_per_run) {
+    out << "{\n  \"benchmark\": \"suite\",\n  \"peak_rss_scope\": \"" << (rss_per_run ? "run" : "process")
+        << "\",\n  \"runs\": [";
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const suite_run &r = runs[i];
+        double error = r.exact == 0 ? 0.0 : std::fabs(r.triangles - r.exact) / r.exact;
+        out << (i == 0 ? "\n" : ",\n") << std::setprecision(10)
+            << "    {\"graph\": \"" << r.graph << "\", \"nodes\": " << r.nodes << ", \"edges\": " << r.edges
+            << ", \"engine\": \"" << r.engine << "\", \"threads\": " << r.threads
+            << ", \"parameter\": " << r.parameter << ", \"triangles\": " << r.triangles
+            << ", \"exact\": " << r.exact << ", \"relative_error\": " << error
+            << ", \"seconds\": " << r.seconds << ", \"edges_per_second\": " << r.edges / r.seconds
+            << ", \"peak_rss_bytes\": " << r.peak_rss << "}";
+    }
+    out << "\n  ]\n}" << std::endl;
+}
+
+void write_suite_csv(std::ostream &out, const std::vector<suite_run> &runs) {
+    out << "graph,nodes,edges,engine,threads,parameter,triangles,exact,relative_error,seconds,"
+           "edges_per_second,peak_rss_bytes\n";
+    for (const suite_run &r: runs) {
+        double error = r.exact == 0 ? 0.0 : std::fabs(r.triangles - r.exact) / r.exact;
+        out << std::setprecision(10) << r.graph << "," << r.nodes << "," << r.edges << "," << r.engine << ","
+            << r.threads << "," << r.parameter << "," << r.triangles << "," << r.exact << "," << error << ","
+            << r.seconds << "," << r.edges / r.seconds << "," << r.peak_rss << "\n";
+    }
+    out.flush();
+}
+
+/**
+ * Runs every engine over synthetic R-MAT, Erdos-Renyi and power law graphs of 2^10 up to
+ * 2^max_scale nodes, over powers of two threads up to max_threads and a range of sample sizes,
+ * reservoir sizes and DOULION probabilities. Every run is written to output with its wall time,
+ * edges per second, peak resident set size and relative error against the exact count, as JSON,
+ * or as CSV if output ends in .csv, so that results can be tracked across commits.
+ *
+ * A run times everything the engine builds from the deduplicated graph held in memory: the
+ * oriented graph for the exact engines, the hash adjacency for sampler, the alias table for
+ * wedge_sampler, the stream for GPS and the sparsified graph for DOULION. The hash based sampler
+ * is single threaded.
+ */
+void suite_benchmark(const char* output, unsigned int max_scale, unsigned int max_threads) {
+    if (max_threads == 0) {
+        max_threads = tcount::default_threads();
+    }
+    std::vector<unsigned int> thread_counts;
+    for (unsigned int threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    const unsigned long long seed = 42;
+    const unsigned long edge_factor = 16;
+    const unsigned long sample_sizes[] = {10000, 100000, 1000000};
+    const double probabilities[] = {0.1, 0.3};
+
+    bool rss_per_run = reset_peak_rss();
+    std::vector<suite_run> runs;
+
+    for (unsigned int scale = 10; scale <= max_scale; scale += 2) {
+        unsigned long n = 1ul << scale;
+        std::vector<std::pair<std::string, std::function<std::vector<tcount::edge>()>>> generators = {
+                {"rmat-" + std::to_string(scale), [&]() { return tcount::generate_rmat(scale, n * edge_factor, seed); }},
+                {"er-" + std::to_string(scale), [&]() { return tcount::generate_erdos_renyi(n, n * edge_factor, seed); }},
+                {"powerlaw-" + std::to_string(scale), [&]() { return tcount::generate_power_law(n, 2.5, 8, seed); }}
+        };
+
+        for (auto &generator: generators) {
+            tcount::sampler_edge_array sampler{tcount::build_csr(generator.second())};
+            const tcount::csr_graph &graph = sampler.graph();
+            unsigned long long exact = 0;
+
+            //the stream GPS sees, in a random order
+            std::vector<tcount::edge> stream;
+            stream.reserve(graph.number_of_edges());
+            graph.for_each_batch([&stream](const tcount::edge* edges, size_t count) {
+                stream.insert(stream.end(), edges, edges + count);
+            });
+            std::mt19937_64 mt(seed);
+            std::shuffle(stream.begin(), stream.end(), mt);
+
+            auto run = [&](const std::string &engine, unsigned int threads, double parameter,
+                           const std::function<double()> &count) {
+                std::cerr << generator.first << " " << engine << " threads " << threads << " parameter " << parameter
+                          << std::endl;
+                if (rss_per_run) {
+                    reset_peak_rss();
+                }
+                auto start = std::chrono::steady_clock::now();
+                double triangles = count();
+                double elapsed = seconds_since(start);
+                runs.push_back({generator.first, graph.number_of_nodes(), graph.number_of_edges(), engine, threads,
+                                parameter, triangles, exact, elapsed, peak_rss_bytes()});
+            };
+
+            exact = tcount::forward_oriented(tcount::compact_oriented_graph(graph), max_threads);
+
+            for (unsigned int threads: thread_counts) {
+                run("forward", threads, 0, [&]() {
+                    return static_cast<double>(tcount::forward_oriented(tcount::compact_oriented_graph(graph), threads));
+                });
+                run("spgemm", threads, 0, [&]() {
+                    return static_cast<double>(tcount::count_triangles(tcount::compact_oriented_graph(graph),
+                                                                       tcount::counting_engine::spgemm, threads));
+                });
+            }
+
+            for (unsigned long samples: sample_sizes) {
+                run("sampler", 1, samples, [&]() {
+                    tcount::sampler hash_sampler;
+                    graph.feed(hash_sampler);
+                    return static_cast<double>(hash_sampler.sample_triangles(samples, seed));
+                });
+            }
+
+            for (unsigned int threads: thread_counts) {
+                for (unsigned long samples: sample_sizes) {
+                    run("sampler_edge_array", threads, samples, [&]() {
+                        return static_cast<double>(sampler.sample_triangles(samples, threads, seed));
+                    });
+                }
+            }
+
+            for (unsigned int threads: thread_counts) {
+                for (unsigned long samples: sample_sizes) {
+                    run("wedge_sampler", threads, samples, [&]() {
+                        return tcount::wedge_sampler(graph).sample_wedges(samples, threads, seed).triangles;
+                    });
+                }
+            }
+
+            for (unsigned int threads: thread_counts) {
+                for (unsigned long divisor: {100ul, 10ul}) {
+                    unsigned long res_size = std::max(1000ul, graph.number_of_edges() / divisor);
+                    run("gps", threads, res_size, [&]() {
+                        tcount::gps_sharded gps(res_size, threads, seed);
+                        gps.add_edges(stream.data(), stream.size());
+                        return gps.estimate(threads).triangles;
+                    });
+                }
+            }
+
+            for (unsigned int threads: thread_counts) {
+                for (double p: probabilities) {
+                    tcount::doulion stage(p, seed, threads);
+                    run("doulion+forward", threads, p, [&]() {
+                        tcount::csr_graph kept = tcount::build_csr(stage.sparsify(graph), threads);
+                        return stage.scale(tcount::forward_oriented(tcount::compact_oriented_graph(kept), threads));
+                    });
+                    run("doulion+sampler_edge_array", threads, p, [&]() {
+                        tcount::sampler_edge_array kept{tcount::build_csr(stage.sparsify(graph), threads)};
+                        return stage.scale(kept.sample_triangles(100000, threads, seed));
+                    });
+                    run("doulion+gps", threads, p, [&]() {
+                        std::vector<tcount::edge> kept = stage.sparsify(graph);
+                        tcount::gps_sharded gps(std::max<size_t>(1000, kept.size() / 10), threads, seed);
+                        gps.add_edges(kept.data(), kept.size());
+                        return stage.scale(gps.estimate(threads).triangles);
+                    });
+                }
+            }
+        }
+    }
+
+    std::string name(output);
+    std::ofstream out(output);
+    if (!out) {
+        throw std::runtime_error("could not open " + name);
+    }
+    if (name.size() >= 4 && name.compare(name.size() - 4, 4, ".csv") == 0) {
+        write_suite_csv(out, runs);
+    }
+    else {
+        write_suite_json(out, runs, rss_per_run);
+    }
+    std::cerr << runs.size() << " runs written to " << name << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && std::string(argv[1]) == "intersect") {
+        intersect_benchmark();
+        return 0;
+    }
+
+    if (argc < 3) {
+        std::cout << "usage: " << argv[0] << " parse <edge list> [threads]" << std::endl;
+        std::cout << "       " << argv[0] << " load <edge list> <.tcsr file>" << std::endl;
+        std::cout << "       " << argv[0] << " build <edge list> [threads]" << std::endl;
+        std::cout << "       " << argv[0] << " forward <edge list>" << std::endl;
+        std::cout << "       " << argv[0] << " scaling <edge list> [max threads] [samples]" << std::endl;
+        std::cout << "       " << argv[0] << " intersect" << std::endl;
+        std::cout << "       " << argv[0] << " hubs <edge list> [threshold] [samples]" << std::endl;
+        std::cout << "       " << argv[0] << " gps <edge list> [reservoir size]" << std::endl;
+        std::cout << "       " << argv[0] << " doulion <edge list> [p] [threads]" << std::endl;
+        std::cout << "       " << argv[0] << " dynamic <edge list> [batch size] [threads]" << std::endl;
+        std::cout << "       " << argv[0] << " matrix <edge list> [threads]" << std::endl;
+        std::cout << "       " << argv[0] << " engines <edge list> [threads]" << std::endl;
+        std::cout << "       " << argv[0] << " truss <edge list> [threads]" << std::endl;
+        std::cout << "       " << argv[0] << " external <edge list> <temp dir> [budget MiB...]" << std::endl;
+        std::cout << "       " << argv[0] << " reorder <edge list> [threads] [samples]" << std::endl;
+        std::cout << "       " << argv[0] << " adaptive <edge list> [relative error] [confidence] [runs]" << std::endl;
+        std::cout << "       " << argv[0] << " wedges <edge list> [threads] [runs] [max samples]" << std::endl;
+        std::cout << "       " << argv[0] << " suite <output .json or .csv> [max scale] [max threads]" << std::endl;
+        return 0;
+    }
+
+    std::string benchmark(argv[1]);
+
+    if (benchmark == "parse") {
+        unsigned int threads = argc >= 4 ? static_cast<unsigned int>(atoi(argv[3])) : 0;
+        parse_benchmark(argv[2], threads);
+    }
+
+    else if (benchmark == "load" && argc >= 4) {
+        load_benchmark(argv[2], argv[3]);
+    }
+
+    else if (benchmark == "build") {
+        unsigned int threads = argc >= 4 ? static_cast<unsigned int>(atoi(argv[3])) : 0;
+        build_benchmark(argv[2], threads);
+    }
+
+    else if (benchmark == "forward") {
+        forward_benchmark(argv[2]);
+    }
+
+    else if (benchmark == "scaling") {
+        unsigned int threads = argc >= 4 ? static_cast<unsigned int>(atoi(argv[3])) : 0;
+        unsigned long samples = argc >= 5 ? std::stoul(argv[4]) : 1000000;
+        scaling_benchmark(argv[2], threads, samples);
+    }
+
+    else if (benchmark == "hubs") {
+        unsigned long threshold = argc >= 4 ? std::stoul(argv[3]) : 0;
+        unsigned long samples = argc >= 5 ? std::stoul(argv[4]) : 1000000;
+        hubs_benchmark(argv[2], threshold, samples);
+    }
+
+    else if (benchmark == "doulion") {
+        double p = argc >= 4 ? atof(argv[3]) : 0.01;
+        unsigned int threads = argc >= 5 ? static_cast<unsigned int>(atoi(argv[4])) : 0;
+        doulion_benchmark(argv[2], p, threads);
+    }
+
+    else if (benchmark == "dynamic") {
+        size_t batch_size = argc >= 4 ? std::stoul(argv[3]) : 10000;
+        unsigned int threads = argc >= 5 ? static_cast<unsigned int>(atoi(argv[4])) : 0;
+        dynamic_benchmark(argv[2], batch_size, threads);
+    }
+
+    else if (benchmark == "matrix") {
+        unsigned int threads = argc >= 4 ? static_cast<unsigned int>(atoi(argv[3])) : 0;
+        matrix_benchmark(argv[2], threads);
+    }
+
+    else if (benchmark == "engines") {
+        unsigned int threads = argc >= 4 ? static_cast<unsigned int>(atoi(argv[3])) : 0;
+        engines_benchmark(argv[2], threads);
+    }
+
+    else if (benchmark == "truss") {
+        unsigned int threads = argc >= 4 ? static_cast<unsigned int>(atoi(argv[3])) : 0;
+        truss_benchmark(argv[2], threads);
+    }
+
+    else if (benchmark == "external" && argc >= 4) {
+        std::vector<size_t> budgets;
+        for (int i = 4; i < argc; ++i) {
+            budgets.push_back(std::stoul(argv[i]));
+        }
+        if (budgets.empty()) {
+            budgets = {1024, 256, 64, 16, 4};
+        }
+        external_benchmark(argv[2], argv[3], budgets, 0);
+    }
+
+    else if (benchmark == "reorder") {
+        unsigned int threads = argc >= 4 ? static_cast<unsigned int>(atoi(argv[3])) : 0;
+        unsigned long samples = argc >= 5 ? std::stoul(argv[4]) : 1000000;
+        reorder_benchmark(argv[2], threads, samples);
+    }
+
+    else if (benchmark == "adaptive") {
+        double relative_error = argc >= 4 ? atof(argv[3]) : 0.01;
+        double confidence = argc >= 5 ? atof(argv[4]) : 0.95;
+        unsigned int runs = argc >= 6 ? static_cast<unsigned int>(atoi(argv[5])) : 20;
+        adaptive_benchmark(argv[2], relative_error, confidence, runs);
+    }
+
+    else if (benchmark == "wedges") {
+        unsigned int threads = argc >= 4 ? static_cast<unsigned int>(atoi(argv[3])) : 0;
+        unsigned int runs = argc >= 5 ? static_cast<unsigned int>(atoi(argv[4])) : 10;
+        unsigned long max_samples = argc >= 6 ? std::stoul(argv[5]) : 1000000;
+        wedges_benchmark(argv[2], threads, runs, max_samples);
+    }
+
+    else if (benchmark == "suite") {
+        unsigned int max_scale = argc >= 4 ? static_cast<unsigned int>(atoi(argv[3])) : 16;
+        unsigned int threads = argc >= 5 ? static_cast<unsigned int>(atoi(argv[4])) : 0;
+        suite_benchmark(argv[2], max_scale, threads);
+    }
+
+    else if (benchmark == "gps") {
+        unsigned long res_size = argc >= 4 ? std::stoul(argv[3]) : 100000;
+        gps_benchmark(argv[2], res_size);
+    }
+
+    return 0;
+}
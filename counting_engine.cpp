@@ -0,0 +1,162 @@
+//
+// The exact triangle counting engines that run on an oriented graph, and a cost model that picks
+// one for a given graph.
+//
+
+#include "counting_engine.h"
+
+#include <stdexcept>
+#include <string>
+#include "adjacency_matrix_graph.h"
+#include "masked_spgemm.h"
+
+namespace {
+    // nanoseconds per unit of work, measured with the 'engines' benchmark: a wedge lookup in a
+    // bitmap accumulator, and a 64 bit word of AND+popcount
+    const double WEDGE_COST = 2.0;
+    const double MATRIX_WORD_COST = 1.5;
+    // the matrix is only considered while it stays this small, and never built larger
+    const double MATRIX_MAX_BYTES = 256.0 * 1024 * 1024;
+
+    // the words of a bit matrix row, padded to whole cache lines of 512 bits
+    double matrix_row_words(unsigned long n) {
+        return static_cast<double>((n + 511) / 512 * 8);
+    }
+}
+
+/**
+ * @param name One of auto, forward, spgemm or matrix.
+ * @return The engine of that name.
+ */
+tcount::counting_engine tcount::parse_engine(const std::string &name) {
+    if (name == "auto") {
+        return counting_engine::automatic;
+    }
+    if (name == "forward") {
+        return counting_engine::forward;
+    }
+    if (name == "spgemm") {
+        return counting_engine::spgemm;
+    }
+    if (name == "matrix") {
+        return counting_engine::matrix;
+    }
+    throw std::invalid_argument("unknown engine " + name + ", expected auto, forward, spgemm or matrix");
+}
+
+const char* tcount::engine_name(counting_engine engine) {
+    switch (engine) {
+        case counting_engine::forward:
+            return "forward";
+        case counting_engine::spgemm:
+            return "spgemm";
+        case counting_engine::matrix:
+            return "matrix";
+        default:
+            return "auto";
+    }
+}
+
+/**
+ * Estimates the work of the masked product, the number of wedges u -> w -> v, and of the bit matrix,
+ * a row of words per edge, and picks the cheaper. On every graph measured so far the product has
+ * beaten forward_oriented, so forward is only used when asked for (or for hub bitmaps).
+ *
+ * @param g The oriented graph.
+ * @return The engine expected to be fastest.
+ */
+template<typename Vertex>
+tcount::counting_engine tcount::choose_engine(const basic_oriented_graph<Vertex> &g) {
+    unsigned long n = g.number_of_nodes();
+    const Vertex* edge_array = g.edge_array();
+
+    double wedges = 0;
+    for (unsigned long e = 0; e < g.number_of_edges(); ++e) {
+        wedges += static_cast<double>(g.out_degree(edge_array[e]));
+    }
+
+    double row_words = matrix_row_words(n);
+    double matrix_bytes = row_words * 8 * static_cast<double>(n);
+    double matrix_cost = row_words * static_cast<double>(g.number_of_edges()) * MATRIX_WORD_COST;
+
+    if (matrix_bytes <= MATRIX_MAX_BYTES && matrix_cost < wedges * WEDGE_COST) {
+        return counting_engine::matrix;
+    }
+    return counting_engine::spgemm;
+}
+
+/**
+ * Counts the triangles of an oriented graph exactly with the specified engine.
+ *
+ * @param g The oriented graph.
+ * @param engine The engine, or automatic to let choose_engine pick one.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @return The number of triangles.
+ * @throws std::invalid_argument If the matrix engine is asked for and its matrix would be larger
+ * than MATRIX_MAX_BYTES.
+ */
+template<typename Vertex>
+unsigned long long tcount::count_triangles(const basic_oriented_graph<Vertex> &g, counting_engine engine,
+                                           unsigned int threads) {
+    if (engine == counting_engine::automatic) {
+        engine = choose_engine(g);
+    }
+
+    switch (engine) {
+        case counting_engine::spgemm:
+            return masked_spgemm(g, threads);
+        case counting_engine::matrix: {
+            double matrix_bytes = matrix_row_words(g.number_of_nodes()) * 8 * static_cast<double>(g.number_of_nodes());
+            if (matrix_bytes > MATRIX_MAX_BYTES) {
+                throw std::invalid_argument("the bit matrix of " + std::to_string(g.number_of_nodes()) + " nodes would take " +
+                                            std::to_string(static_cast<unsigned long long>(matrix_bytes / (1024 * 1024))) +
+                                            " MiB, more than the matrix engine's limit of " +
+                                            std::to_string(static_cast<unsigned long long>(MATRIX_MAX_BYTES / (1024 * 1024))) +
+                                            " MiB; use the forward or spgemm engine");
+            }
+            adjacency_matrix_graph matrix(g.number_of_nodes());
+            {
+                stats::phase_timer timer(stats::phase::preprocess);
+                for (unsigned long u = 0; u < g.number_of_nodes(); ++u) {
+                    for (const Vertex* v = g.out_begin(u); v != g.out_end(u); ++v) {
+                        matrix.add_edge(u, *v);
+                    }
+                }
+            }
+            return count_triangles(matrix, threads);
+        }
+        default:
+            return forward_oriented(g, threads);
+    }
+}
+
+/**
+ * Counts the triangles of an oriented graph exactly with the specified engine, and with hub bitmaps
+ * if the engine is forward, the only one that uses them. They also make the automatic choice
+ * forward.
+ *
+ * @param g The oriented graph.
+ * @param engine The engine, or automatic.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @param hubs Bitmaps of the out neighbours of the high out degree nodes of g, or nullptr.
+ * @return The number of triangles.
+ */
+template<typename Vertex>
+unsigned long long tcount::count_triangles(const basic_oriented_graph<Vertex> &g, counting_engine engine,
+                                           unsigned int threads, const hub_index* hubs) {
+    if (hubs != nullptr && (engine == counting_engine::automatic || engine == counting_engine::forward)) {
+        return forward_oriented(g, threads, hubs);
+    }
+    return count_triangles(g, engine, threads);
+}
+
+template tcount::counting_engine tcount::choose_engine(const compact_oriented_graph &g);
+template tcount::counting_engine tcount::choose_engine(const oriented_graph &g);
+template unsigned long long tcount::count_triangles(const compact_oriented_graph &g, counting_engine engine,
+                                                    unsigned int threads);
+template unsigned long long tcount::count_triangles(const oriented_graph &g, counting_engine engine,
+                                                    unsigned int threads);
+template unsigned long long tcount::count_triangles(const compact_oriented_graph &g, counting_engine engine,
+                                                    unsigned int threads, const hub_index* hubs);
+template unsigned long long tcount::count_triangles(const oriented_graph &g, counting_engine engine,
+                                                    unsigned int threads, const hub_index* hubs);
@@ -0,0 +1,36 @@
+//
+// The exact triangle counting engines that run on an oriented graph, and a cost model that picks
+// one for a given graph.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_COUNTING_ENGINE_H
+#define TRIANGLECOUNTINGAPI_COUNTING_ENGINE_H
+
+#include <string>
+#include "hub_index.h"
+#include "oriented_graph.h"
+
+namespace tcount {
+    enum class counting_engine {
+        automatic,
+        // forward_oriented: one sorted list intersection per edge
+        forward,
+        // masked_spgemm: one accumulator lookup per wedge
+        spgemm,
+        // count_triangles on an adjacency_matrix_graph: one AND+popcount over a row per edge
+        matrix
+    };
+
+    counting_engine parse_engine(const std::string &name);
+    const char* engine_name(counting_engine engine);
+    template<typename Vertex>
+    counting_engine choose_engine(const basic_oriented_graph<Vertex> &g);
+    template<typename Vertex>
+    unsigned long long count_triangles(const basic_oriented_graph<Vertex> &g, counting_engine engine,
+                                       unsigned int threads = 0);
+    template<typename Vertex>
+    unsigned long long count_triangles(const basic_oriented_graph<Vertex> &g, counting_engine engine, unsigned int threads,
+                                       const hub_index* hubs);
+}
+
+#endif //TRIANGLECOUNTINGAPI_COUNTING_ENGINE_H
@@ -0,0 +1,227 @@
+//
+// Builds a csr_graph straight from a buffer of edges, without per node hash sets. Every edge becomes
+// two packed (u, v) keys which are radix sorted, so the sorted keys are already the CSR.
+//
+
+#include "csr_builder.h"
+
+#include <algorithm>
+#include "parallel.h"
+#include "radix_sort.h"
+#include "stats.h"
+
+namespace {
+    //threads each sort and deduplicate their own slice of ids in place, then the slices are joined
+    std::vector<unsigned long> sorted_unique_ids(const std::vector<tcount::edge> &edges, unsigned long max_id,
+                                                 unsigned int threads) {
+        std::vector<unsigned long> ids(edges.size() * 2);
+        std::vector<size_t> bounds(threads + 1), kept(threads);
+        for (unsigned int t = 0; t <= threads; ++t) {
+            bounds[t] = edges.size() / threads * t + std::min<size_t>(t, edges.size() % threads);
+        }
+
+        tcount::parallel_run(threads, [&](unsigned int t) {
+            unsigned long* out = ids.data() + bounds[t] * 2;
+            for (size_t i = bounds[t]; i < bounds[t + 1]; ++i) {
+                *out++ = edges[i].first;
+                *out++ = edges[i].second;
+            }
+            unsigned long* begin = ids.data() + bounds[t] * 2;
+            std::sort(begin, out);
+            kept[t] = static_cast<size_t>(std::unique(begin, out) - begin);
+        });
+
+        size_t size = 0;
+        for (unsigned int t = 0; t < threads; ++t) {
+            std::copy(ids.begin() + bounds[t] * 2, ids.begin() + bounds[t] * 2 + kept[t], ids.begin() + size);
+            size += kept[t];
+        }
+        ids.resize(size);
+        ids.shrink_to_fit();
+
+        std::vector<unsigned long> buffer(size);
+        tcount::parallel_radix_sort(ids.data(), buffer.data(), size, tcount::bits_needed(max_id), threads);
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        ids.shrink_to_fit();
+
+        return ids;
+    }
+}
+
+/**
+ * Relabels the nodes of an edge buffer to 0..n-1, in ascending order of original id.
+ *
+ * Ids that are no larger than twice the number of edges are relabeled through a direct table.
+ * Sparser ids, such as hashes, are sorted and looked up by binary search instead.
+ *
+ * @param edges The edges to relabel in place.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @return The original id of every new label.
+ */
+std::vector<unsigned long> tcount::relabel_edges(std::vector<edge> &edges, unsigned int threads) {
+    if (threads == 0) {
+        threads = default_threads();
+    }
+
+    std::vector<unsigned long> thread_max(threads, 0);
+    parallel_for_dynamic(0, edges.size(), 1u << 16, threads, [&](unsigned int t, size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) {
+            thread_max[t] = std::max(thread_max[t], std::max(edges[i].first, edges[i].second));
+        }
+    });
+    unsigned long max_id = *std::max_element(thread_max.begin(), thread_max.end());
+
+    std::vector<unsigned long> labels;
+
+    if (edges.empty()) {
+        return labels;
+    }
+
+    if (max_id < edges.size() * 2) {
+        //the table is no bigger than the edge buffer
+        std::vector<unsigned long> table(max_id + 1, 0);
+        for (const auto &e: edges) {
+            table[e.first] = 1;
+            table[e.second] = 1;
+        }
+
+        unsigned long next = 0;
+        for (unsigned long id = 0; id <= max_id; ++id) {
+            if (table[id]) {
+                table[id] = next++;
+                labels.push_back(id);
+            }
+        }
+
+        parallel_for_dynamic(0, edges.size(), 1u << 16, threads, [&](unsigned int, size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) {
+                edges[i].first = table[edges[i].first];
+                edges[i].second = table[edges[i].second];
+            }
+        });
+    }
+    else {
+        labels = sorted_unique_ids(edges, max_id, threads);
+
+        parallel_for_dynamic(0, edges.size(), 1u << 16, threads, [&](unsigned int, size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) {
+                edges[i].first = static_cast<unsigned long>(
+                        std::lower_bound(labels.begin(), labels.end(), edges[i].first) - labels.begin());
+                edges[i].second = static_cast<unsigned long>(
+                        std::lower_bound(labels.begin(), labels.end(), edges[i].second) - labels.begin());
+            }
+        });
+    }
+
+    return labels;
+}
+
+/**
+ * Builds a relabeled CSR with sorted neighbour lists from a buffer of edges. Self loops and
+ * duplicate edges (in either direction) are removed.
+ *
+ * @param edges The edges, for example from edge_list_reader::read_edges. Consumed.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @return The graph, with the original ids as its labels.
+ */
+tcount::csr_graph tcount::build_csr(std::vector<edge> &&edges, unsigned int threads) {
+    stats::phase_timer timer(stats::phase::build);
+    if (threads == 0) {
+        threads = default_threads();
+    }
+
+    std::vector<unsigned long> labels = relabel_edges(edges, threads);
+    unsigned long n = labels.size();
+    unsigned int node_bits = std::max(1u, bits_needed(n == 0 ? 0 : n - 1));
+
+    std::vector<unsigned long> keys;
+
+    if (2 * node_bits <= 8 * sizeof(unsigned long)) {
+        //two keys per edge, self loops dropped
+        std::vector<size_t> bounds(threads + 1), counts(threads + 1, 0);
+        for (unsigned int t = 0; t <= threads; ++t) {
+            bounds[t] = edges.size() / threads * t + std::min<size_t>(t, edges.size() % threads);
+        }
+        parallel_run(threads, [&](unsigned int t) {
+            for (size_t i = bounds[t]; i < bounds[t + 1]; ++i) {
+                counts[t + 1] += edges[i].first != edges[i].second ? 2 : 0;
+            }
+        });
+        for (unsigned int t = 0; t < threads; ++t) {
+            counts[t + 1] += counts[t];
+        }
+
+        keys.resize(counts[threads]);
+        parallel_run(threads, [&](unsigned int t) {
+            unsigned long* out = keys.data() + counts[t];
+            for (size_t i = bounds[t]; i < bounds[t + 1]; ++i) {
+                unsigned long u = edges[i].first, v = edges[i].second;
+                if (u != v) {
+                    *out++ = (u << node_bits) | v;
+                    *out++ = (v << node_bits) | u;
+                }
+            }
+        });
+        std::vector<edge>().swap(edges);
+
+        std::vector<unsigned long> buffer(keys.size());
+        parallel_radix_sort(keys.data(), buffer.data(), keys.size(), 2 * node_bits, threads);
+    }
+    else {
+        //too many nodes to pack two ids into one key, fall back to sorting pairs
+        std::vector<edge> directed;
+        directed.reserve(edges.size() * 2);
+        for (const auto &e: edges) {
+            if (e.first != e.second) {
+                directed.emplace_back(e.first, e.second);
+                directed.emplace_back(e.second, e.first);
+            }
+        }
+        std::vector<edge>().swap(edges);
+        std::sort(directed.begin(), directed.end());
+
+        keys.resize(directed.size());
+        std::vector<unsigned long> node_array(n + 1, 0);
+        size_t size = 0;
+        for (size_t i = 0; i < directed.size(); ++i) {
+            if (i > 0 && directed[i] == directed[i - 1]) {
+                continue;
+            }
+            node_array[directed[i].first + 1] += 1;
+            keys[size++] = directed[i].second;
+        }
+        keys.resize(size);
+        for (unsigned long u = 0; u < n; ++u) {
+            node_array[u + 1] += node_array[u];
+        }
+        return csr_graph(std::move(node_array), std::move(keys), std::move(labels), true);
+    }
+
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    keys.shrink_to_fit();
+
+    //the keys are sorted by source, so node u starts at the first key whose high bits are >= u
+    std::vector<unsigned long> node_array(n + 1);
+    const unsigned long mask = (1ul << node_bits) - 1;
+    parallel_for_dynamic(0, keys.size(), 1u << 16, threads, [&](unsigned int, size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) {
+            unsigned long source = keys[i] >> node_bits;
+            unsigned long first = i == 0 ? 0 : (keys[i - 1] >> node_bits) + 1;
+            for (unsigned long u = first; u <= source; ++u) {
+                node_array[u] = i;
+            }
+        }
+    });
+    unsigned long last = keys.empty() ? 0 : (keys.back() >> node_bits) + 1;
+    for (unsigned long u = last; u <= n; ++u) {
+        node_array[u] = keys.size();
+    }
+
+    parallel_for_dynamic(0, keys.size(), 1u << 16, threads, [&](unsigned int, size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) {
+            keys[i] &= mask;
+        }
+    });
+
+    return csr_graph(std::move(node_array), std::move(keys), std::move(labels), true);
+}
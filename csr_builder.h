@@ -0,0 +1,17 @@
+//
+// Builds a csr_graph straight from a buffer of edges, without per node hash sets.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_CSR_BUILDER_H
+#define TRIANGLECOUNTINGAPI_CSR_BUILDER_H
+
+#include <vector>
+#include "csr_graph.h"
+#include "edge_list_reader.h"
+
+namespace tcount {
+    std::vector<unsigned long> relabel_edges(std::vector<edge> &edges, unsigned int threads = 0);
+    csr_graph build_csr(std::vector<edge> &&edges, unsigned int threads = 0);
+}
+
+#endif //TRIANGLECOUNTINGAPI_CSR_BUILDER_H
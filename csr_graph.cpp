@@ -0,0 +1,497 @@
+//
+// A compressed sparse row (CSR) graph that is either held in memory or mapped straight from a
+// binary .tcsr file.
+//
+
+#include "csr_graph.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include "parallel.h"
+#include "stats.h"
+
+namespace {
+    // nodes claimed by a thread at a time while verifying
+    const size_t VERIFY_GRAIN = 4096;
+
+    // ids copied by a thread at a time when narrowing an edge array
+    const size_t NARROW_GRAIN = 1u << 16;
+
+    // whether bytes starting at offset lie within a file of the given size, without overflowing
+    bool within(unsigned long long offset, unsigned long long bytes, unsigned long long size) {
+        return bytes <= size && offset <= size - bytes;
+    }
+
+    // copies a 64 bit edge array into a narrower one, whose type the caller has checked every id fits
+    template<typename Vertex>
+    void narrow(const unsigned long* from, unsigned long count, std::vector<Vertex> &to, unsigned int threads) {
+        to.resize(count);
+        tcount::parallel_for_dynamic(0, count, NARROW_GRAIN, threads == 0 ? tcount::default_threads() : threads,
+                                     [&](unsigned int, size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) {
+                to[i] = static_cast<Vertex>(from[i]);
+            }
+        });
+    }
+
+    // a 64 bit graph reads its edges straight from the mapping
+    void map_edges(const unsigned long* mapped, unsigned long, std::vector<unsigned long> &,
+                   const unsigned long* &edge_array) {
+        edge_array = mapped;
+    }
+
+    // a narrower graph copies them out of it
+    template<typename Vertex>
+    void map_edges(const unsigned long* mapped, unsigned long count, std::vector<Vertex> &storage,
+                   const Vertex* &edge_array) {
+        narrow(mapped, count, storage, 0);
+        edge_array = storage.data();
+    }
+}
+
+template<typename Vertex>
+tcount::basic_csr_graph<Vertex>::basic_csr_graph() {
+    this->n = 0;
+    this->m = 0;
+    this->sorted = true;
+    this->node_storage.assign(1, 0);
+    reset_pointers();
+}
+
+/**
+ * Takes ownership of an in memory CSR.
+ *
+ * @param node_array n + 1 offsets into edge_array, the last being edge_array.size().
+ * @param edge_array The neighbours of every node, both directions of each undirected edge.
+ * @param labels The original id of every node, or an empty vector if the nodes were never relabeled.
+ * @param sorted True if every neighbour list is sorted in ascending order.
+ */
+template<typename Vertex>
+tcount::basic_csr_graph<Vertex>::basic_csr_graph(std::vector<unsigned long> &&node_array,
+                                                std::vector<Vertex> &&edge_array,
+                                                std::vector<unsigned long> &&labels, bool sorted) {
+    this->node_storage = std::move(node_array);
+    this->edge_storage = std::move(edge_array);
+    this->label_storage = std::move(labels);
+    if (node_storage.empty()) {
+        node_storage.assign(1, 0);
+    }
+    this->n = node_storage.size() - 1;
+    this->m = edge_storage.size();
+    this->sorted = sorted;
+    reset_pointers();
+}
+
+/**
+ * Narrows the edge array of a 64 bit graph, taking over its offsets and labels, or its mapping if
+ * it was mapped from a file. The ids are copied on several threads, then the 64 bit edge array is
+ * released.
+ *
+ * @param graph The graph, relabelled to 0..n-1, which is left empty.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @throws std::invalid_argument If the graph has too many nodes for Vertex.
+ */
+template<typename Vertex>
+tcount::basic_csr_graph<Vertex>::basic_csr_graph(basic_csr_graph<unsigned long> &&graph, unsigned int threads) {
+    if (!fits(graph.n)) {
+        throw std::invalid_argument("a graph of " + std::to_string(graph.n) + " nodes has too many for " +
+                                    std::to_string(sizeof(Vertex) * 8) + " bit ids");
+    }
+    stats::phase_timer timer(stats::phase::preprocess);
+
+    narrow(graph.edge_array_, graph.m, edge_storage, threads);
+    //moving a vector keeps its buffer, so the offsets and labels stay where graph pointed to them
+    this->node_storage = std::move(graph.node_storage);
+    this->label_storage = std::move(graph.label_storage);
+    this->mapping = std::move(graph.mapping);
+    this->node_array_ = graph.node_array_;
+    this->edge_array_ = edge_storage.data();
+    this->labels_ = graph.labels_;
+    this->n = graph.n;
+    this->m = graph.m;
+    this->sorted = graph.sorted;
+
+    graph = basic_csr_graph<unsigned long>();
+}
+
+/**
+ * Maps a .tcsr file written by save(). Nothing is copied or read beyond the header; the arrays are
+ * read straight from the page cache when an engine needs them. Only the header is checked, so the
+ * arrays it describes lie within the file, and their contents are trusted. A file that may not
+ * have been written by save() should be checked with verify() before it is used.
+ *
+ * A graph with ids narrower than the file's 64 bits copies its edge array out of the mapping; the
+ * offsets and labels are still read from the file.
+ *
+ * @param filename The path of the .tcsr file.
+ * @throws std::runtime_error If the file is not a .tcsr file, its header does not fit the file, or
+ *                            it has too many nodes for Vertex.
+ */
+template<typename Vertex>
+tcount::basic_csr_graph<Vertex>::basic_csr_graph(const char* filename) {
+    if (sizeof(unsigned long) != 8) {
+        throw std::runtime_error("mapping a .tcsr file requires a 64 bit unsigned long");
+    }
+
+    stats::phase_timer timer(stats::phase::load);
+    this->mapping.reset(new mapped_file(filename));
+
+    csr_file_header header;
+    if (mapping->size() < sizeof(header)) {
+        throw std::runtime_error(std::string(filename) + " is not a .tcsr file");
+    }
+    memcpy(&header, mapping->data(), sizeof(header));
+
+    if (memcmp(header.magic, CSR_MAGIC, sizeof(CSR_MAGIC)) != 0) {
+        throw std::runtime_error(std::string(filename) + " is not a .tcsr file");
+    }
+    if (header.version != CSR_VERSION) {
+        throw std::runtime_error(std::string(filename) + " has unsupported .tcsr version " +
+                                 std::to_string(header.version));
+    }
+
+    //no array can hold more words than the file, which also keeps the byte counts from overflowing
+    std::string corrupt = std::string(filename) + " is truncated or corrupt";
+    unsigned long long size = mapping->size();
+    if (header.nodes >= size / sizeof(unsigned long) || header.edge_entries > size / sizeof(unsigned long)) {
+        throw std::runtime_error(corrupt);
+    }
+    unsigned long long node_bytes = (header.nodes + 1) * sizeof(unsigned long);
+    unsigned long long edge_bytes = header.edge_entries * sizeof(unsigned long);
+    unsigned long long label_bytes = (header.flags & CSR_HAS_LABELS) ? header.nodes * sizeof(unsigned long) : 0;
+    if (!within(header.node_offset, node_bytes, size) ||
+        !within(header.edge_offset, edge_bytes, size) ||
+        !within(header.label_offset, label_bytes, size) ||
+        (header.node_offset | header.edge_offset | header.label_offset) % sizeof(unsigned long) != 0) {
+        throw std::runtime_error(corrupt);
+    }
+
+    if (!fits(header.nodes)) {
+        throw std::runtime_error(std::string(filename) + " has too many nodes for " +
+                                 std::to_string(sizeof(Vertex) * 8) + " bit ids");
+    }
+
+    const char* base = mapping->data();
+    this->n = header.nodes;
+    this->m = header.edge_entries;
+    this->sorted = (header.flags & CSR_SORTED) != 0;
+    this->node_array_ = reinterpret_cast<const unsigned long*>(base + header.node_offset);
+    map_edges(reinterpret_cast<const unsigned long*>(base + header.edge_offset), m, edge_storage, edge_array_);
+    this->labels_ = (header.flags & CSR_HAS_LABELS)
+                    ? reinterpret_cast<const unsigned long*>(base + header.label_offset)
+                    : nullptr;
+    stats::add(stats::counter::edges_ingested, m / 2);
+}
+
+template<typename Vertex>
+tcount::basic_csr_graph<Vertex>::basic_csr_graph(basic_csr_graph &&other) noexcept {
+    *this = std::move(other);
+}
+
+template<typename Vertex>
+tcount::basic_csr_graph<Vertex>& tcount::basic_csr_graph<Vertex>::operator=(basic_csr_graph &&other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+
+    //moving a vector keeps its buffer, so pointers into other's storage stay valid
+    this->node_storage = std::move(other.node_storage);
+    this->edge_storage = std::move(other.edge_storage);
+    this->label_storage = std::move(other.label_storage);
+    this->mapping = std::move(other.mapping);
+    this->node_array_ = other.node_array_;
+    this->edge_array_ = other.edge_array_;
+    this->labels_ = other.labels_;
+    this->n = other.n;
+    this->m = other.m;
+    this->sorted = other.sorted;
+
+    other.n = 0;
+    other.m = 0;
+    other.node_storage.assign(1, 0);
+    other.edge_storage.clear();
+    other.label_storage.clear();
+    other.reset_pointers();
+
+    return *this;
+}
+
+template<typename Vertex>
+void tcount::basic_csr_graph<Vertex>::reset_pointers() {
+    this->node_array_ = node_storage.data();
+    this->edge_array_ = edge_storage.data();
+    this->labels_ = label_storage.empty() ? nullptr : label_storage.data();
+}
+
+template<typename Vertex>
+unsigned long tcount::basic_csr_graph<Vertex>::number_of_nodes() const {
+    return n;
+}
+
+/**
+ * @return The number of undirected edges, i.e. half the size of the edge array.
+ */
+template<typename Vertex>
+unsigned long tcount::basic_csr_graph<Vertex>::number_of_edges() const {
+    return m / 2;
+}
+
+template<typename Vertex>
+unsigned long tcount::basic_csr_graph<Vertex>::size_of_edge_array() const {
+    return m;
+}
+
+template<typename Vertex>
+const unsigned long* tcount::basic_csr_graph<Vertex>::node_array() const {
+    return node_array_;
+}
+
+template<typename Vertex>
+const Vertex* tcount::basic_csr_graph<Vertex>::edge_array() const {
+    return edge_array_;
+}
+
+/**
+ * @return The original id of every node, or nullptr if the graph was never relabeled.
+ */
+template<typename Vertex>
+const unsigned long* tcount::basic_csr_graph<Vertex>::labels() const {
+    return labels_;
+}
+
+template<typename Vertex>
+unsigned long tcount::basic_csr_graph<Vertex>::degree(unsigned long u) const {
+    return node_array_[u + 1] - node_array_[u];
+}
+
+template<typename Vertex>
+const Vertex* tcount::basic_csr_graph<Vertex>::neighbours_begin(unsigned long u) const {
+    return edge_array_ + node_array_[u];
+}
+
+template<typename Vertex>
+const Vertex* tcount::basic_csr_graph<Vertex>::neighbours_end(unsigned long u) const {
+    return edge_array_ + node_array_[u + 1];
+}
+
+/**
+ * @return The id node u had in the input, which is u itself if the graph was never relabeled.
+ */
+template<typename Vertex>
+unsigned long tcount::basic_csr_graph<Vertex>::original_label(unsigned long u) const {
+    return labels_ == nullptr ? u : labels_[u];
+}
+
+template<typename Vertex>
+bool tcount::basic_csr_graph<Vertex>::is_sorted() const {
+    return sorted;
+}
+
+template<typename Vertex>
+bool tcount::basic_csr_graph<Vertex>::is_mapped() const {
+    return mapping != nullptr;
+}
+
+/**
+ * Sorts every neighbour list in ascending order. A mapped edge array is read only, so one that was
+ * saved unsorted is first copied into memory; the offsets and labels are left in the mapping.
+ */
+template<typename Vertex>
+void tcount::basic_csr_graph<Vertex>::sort_neighbours() {
+    if (sorted) {
+        return;
+    }
+
+    if (edge_array_ != edge_storage.data()) {
+        edge_storage.assign(edge_array_, edge_array_ + m);
+        edge_array_ = edge_storage.data();
+    }
+
+    for (unsigned long u = 0; u < n; ++u) {
+        std::sort(edge_storage.begin() + node_array_[u], edge_storage.begin() + node_array_[u + 1]);
+    }
+    this->sorted = true;
+}
+
+/**
+ * Checks everything the engines assume of the arrays, in O(m log d) for sorted neighbour lists:
+ * the offsets ascend from 0 to the size of the edge array, every neighbour is another node, every
+ * edge (u, v) has its reverse (v, u), and the lists are strictly ascending if the graph says they
+ * are sorted. Unsorted lists are compared against the transpose of the graph instead of searched,
+ * which takes another m + 2n words.
+ *
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @throws std::runtime_error If any of these does not hold.
+ */
+template<typename Vertex>
+void tcount::basic_csr_graph<Vertex>::verify(unsigned int threads) const {
+    if (threads == 0) {
+        threads = default_threads();
+    }
+    stats::phase_timer timer(stats::phase::load);
+
+    if (node_array_[0] != 0 || node_array_[n] != m) {
+        throw std::runtime_error("corrupt CSR: the node array does not span the edge array");
+    }
+
+    //the first problem each thread finds
+    std::vector<std::string> problems(threads);
+    auto check = [&](auto problem_at) {
+        parallel_for_dynamic(0, n, VERIFY_GRAIN, threads, [&](unsigned int t, size_t lo, size_t hi) {
+            for (size_t u = lo; u < hi && problems[t].empty(); ++u) {
+                problems[t] = problem_at(u);
+            }
+        });
+        for (const auto &problem: problems) {
+            if (!problem.empty()) {
+                throw std::runtime_error("corrupt CSR: " + problem);
+            }
+        }
+    };
+
+    //offsets first, so that every list read below lies in the edge array
+    check([&](unsigned long u) {
+        return node_array_[u + 1] < node_array_[u] ? "the offsets of node " + std::to_string(u) + " descend"
+                                                   : std::string();
+    });
+
+    check([&](unsigned long u) {
+        for (unsigned long i = node_array_[u]; i < node_array_[u + 1]; ++i) {
+            unsigned long v = edge_array_[i];
+            if (v >= n || v == u) {
+                return "node " + std::to_string(u) + " has neighbour " + std::to_string(v);
+            }
+            if (sorted && i > node_array_[u] && edge_array_[i - 1] >= v) {
+                return "the neighbours of node " + std::to_string(u) + " are not strictly ascending";
+            }
+            if (sorted && !std::binary_search(neighbours_begin(v), neighbours_end(v), u)) {
+                return "edge (" + std::to_string(u) + ", " + std::to_string(v) + ") has no reverse";
+            }
+        }
+        return std::string();
+    });
+    if (sorted) {
+        return;
+    }
+
+    //the lists are symmetric when every node's list holds the same neighbours as the same node's
+    //list in the transpose, which is built in ascending order
+    std::vector<unsigned long> position(node_array_, node_array_ + n);
+    std::vector<unsigned long> transpose(m);
+    for (unsigned long u = 0; u < n; ++u) {
+        for (unsigned long i = node_array_[u]; i < node_array_[u + 1]; ++i) {
+            unsigned long v = edge_array_[i];
+            if (position[v] == node_array_[v + 1]) {
+                throw std::runtime_error("corrupt CSR: node " + std::to_string(v) +
+                                         " is the neighbour of more nodes than its degree");
+            }
+            transpose[position[v]++] = u;
+        }
+    }
+    std::vector<long> balance(n, 0);
+    for (unsigned long u = 0; u < n; ++u) {
+        for (unsigned long i = node_array_[u]; i < node_array_[u + 1]; ++i) {
+            if (balance[edge_array_[i]]++ != 0) {
+                throw std::runtime_error("corrupt CSR: node " + std::to_string(u) + " has neighbour " +
+                                         std::to_string(edge_array_[i]) + " more than once");
+            }
+        }
+        //the lists have the same length, so they match if no neighbour of the transpose is missing
+        for (unsigned long i = node_array_[u]; i < node_array_[u + 1]; ++i) {
+            if (balance[transpose[i]]-- == 0) {
+                throw std::runtime_error("corrupt CSR: edge (" + std::to_string(transpose[i]) + ", " +
+                                         std::to_string(u) + ") has no reverse");
+            }
+        }
+    }
+}
+
+/**
+ * Writes the graph to a versioned .tcsr file that can later be mapped with csr_graph(filename).
+ *
+ * @param filename The path of the file to write.
+ */
+template<typename Vertex>
+void tcount::basic_csr_graph<Vertex>::save(const char* filename) const {
+    FILE *file = fopen(filename, "wb");
+    if (file == nullptr) {
+        throw std::runtime_error(std::string("cannot open ") + filename + " for writing");
+    }
+
+    csr_file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CSR_MAGIC, sizeof(CSR_MAGIC));
+    header.version = CSR_VERSION;
+    header.flags = (sorted ? CSR_SORTED : 0) | (labels_ != nullptr ? CSR_HAS_LABELS : 0);
+    header.nodes = n;
+    header.edge_entries = m;
+    header.node_offset = sizeof(header);
+    header.edge_offset = header.node_offset + (n + 1) * sizeof(unsigned long long);
+    header.label_offset = header.edge_offset + m * sizeof(unsigned long long);
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    //widen through a buffer so the file layout does not depend on sizeof(unsigned long)
+    std::vector<unsigned long long> buffer;
+    auto write_array = [&](const auto* data, unsigned long long count) {
+        const unsigned long long block = 1u << 20;
+        for (unsigned long long i = 0; ok && i < count; i += block) {
+            unsigned long long len = std::min(block, count - i);
+            buffer.assign(data + i, data + i + len);
+            ok = fwrite(buffer.data(), sizeof(unsigned long long), len, file) == len;
+        }
+    };
+
+    write_array(node_array_, n + 1);
+    write_array(edge_array_, m);
+    if (labels_ != nullptr) {
+        write_array(labels_, n);
+    }
+
+    if (fclose(file) != 0 || !ok) {
+        throw std::runtime_error(std::string("failed writing ") + filename);
+    }
+}
+
+/**
+ * @return True if the file starts with the .tcsr magic number.
+ */
+template<typename Vertex>
+bool tcount::basic_csr_graph<Vertex>::is_csr_file(const char* filename) {
+    FILE *file = fopen(filename, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    char magic[sizeof(CSR_MAGIC)];
+    bool match = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                 memcmp(magic, CSR_MAGIC, sizeof(CSR_MAGIC)) == 0;
+    fclose(file);
+
+    return match;
+}
+
+/**
+ * @return The bytes of the arrays held in memory, not counting any read from a mapped file.
+ */
+template<typename Vertex>
+size_t tcount::basic_csr_graph<Vertex>::memory_bytes() const {
+    return node_storage.size() * sizeof(unsigned long) + edge_storage.size() * sizeof(Vertex) +
+           label_storage.size() * sizeof(unsigned long);
+}
+
+/**
+ * @param nodes The number of nodes of a graph relabelled to 0..n-1.
+ * @return Whether every id of a graph that size can be stored as a Vertex.
+ */
+template<typename Vertex>
+bool tcount::basic_csr_graph<Vertex>::fits(unsigned long nodes) {
+    return nodes == 0 || nodes - 1 <= static_cast<unsigned long>(std::numeric_limits<Vertex>::max());
+}
+
+template class tcount::basic_csr_graph<unsigned int>;
+template class tcount::basic_csr_graph<unsigned long>;
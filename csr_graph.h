@@ -0,0 +1,149 @@
+//
+// A compressed sparse row (CSR) graph that is either held in memory or mapped straight from a
+// binary .tcsr file.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_CSR_GRAPH_H
+#define TRIANGLECOUNTINGAPI_CSR_GRAPH_H
+
+#include <memory>
+#include <vector>
+#include "edge_list_reader.h"
+#include "mapped_file.h"
+
+namespace tcount {
+    /*
+     * Layout of a .tcsr file, all integers little endian:
+     *
+     *   header         64 bytes, see csr_file_header
+     *   node array     (nodes + 1) x uint64, offsets into the edge array
+     *   edge array     edge_entries x uint64, both directions of every undirected edge
+     *   label array    nodes x uint64, original node ids (only if CSR_HAS_LABELS is set)
+     *
+     * Every array starts at the byte offset recorded in the header. Mapping a file only checks the
+     * header; csr_graph::verify checks the arrays.
+     */
+    const char CSR_MAGIC[8] = {'T', 'C', 'S', 'R', 'G', 'R', 'P', 'H'};
+    const unsigned int CSR_VERSION = 1;
+    const unsigned int CSR_SORTED = 1u << 0;
+    const unsigned int CSR_HAS_LABELS = 1u << 1;
+
+    struct csr_file_header {
+        char magic[8];
+        unsigned int version;
+        unsigned int flags;
+        unsigned long long nodes;
+        unsigned long long edge_entries;
+        unsigned long long node_offset;
+        unsigned long long edge_offset;
+        unsigned long long label_offset;
+        unsigned long long reserved;
+    };
+
+    /*
+     * Vertex is the type of the neighbour ids in the edge array. A graph relabelled to 0..n-1 with
+     * fewer than 2^32 nodes fits in unsigned int, which halves the edge array and doubles the
+     * number of ids in every SIMD register. Offsets and labels stay unsigned long, as the number of
+     * edges and the original ids are not bounded by n. The .tcsr format is 64 bit whatever Vertex is.
+     */
+    template<typename Vertex>
+    class basic_csr_graph {
+        template<typename> friend class basic_csr_graph;
+
+        std::vector<unsigned long> node_storage;
+        std::vector<Vertex> edge_storage;
+        std::vector<unsigned long> label_storage;
+        std::unique_ptr<mapped_file> mapping;
+
+        const unsigned long* node_array_;
+        const Vertex* edge_array_;
+        const unsigned long* labels_;
+        unsigned long n;
+        unsigned long m;
+        bool sorted;
+
+    public:
+        typedef Vertex vertex_type;
+
+        basic_csr_graph();
+        basic_csr_graph(std::vector<unsigned long> &&node_array, std::vector<Vertex> &&edge_array,
+                        std::vector<unsigned long> &&labels, bool sorted);
+        basic_csr_graph(basic_csr_graph<unsigned long> &&graph, unsigned int threads);
+        explicit basic_csr_graph(const char* filename);
+        basic_csr_graph(basic_csr_graph &&other) noexcept;
+        basic_csr_graph& operator=(basic_csr_graph &&other) noexcept;
+        basic_csr_graph(const basic_csr_graph&) = delete;
+        basic_csr_graph& operator=(const basic_csr_graph&) = delete;
+
+        unsigned long number_of_nodes() const;
+        unsigned long number_of_edges() const;
+        unsigned long size_of_edge_array() const;
+        const unsigned long* node_array() const;
+        const Vertex* edge_array() const;
+        const unsigned long* labels() const;
+        unsigned long degree(unsigned long u) const;
+        const Vertex* neighbours_begin(unsigned long u) const;
+        const Vertex* neighbours_end(unsigned long u) const;
+        unsigned long original_label(unsigned long u) const;
+        bool is_sorted() const;
+        bool is_mapped() const;
+        void sort_neighbours();
+        void verify(unsigned int threads = 0) const;
+        void save(const char* filename) const;
+        size_t memory_bytes() const;
+        template<typename Fn> void for_each_batch(Fn fn, size_t batch_size = 1u << 16) const;
+        template<typename Consumer> void feed(Consumer &consumer) const;
+
+        static bool fits(unsigned long nodes);
+        static bool is_csr_file(const char* filename);
+
+    private:
+        void reset_pointers();
+    };
+
+    typedef basic_csr_graph<unsigned long> csr_graph;
+    typedef basic_csr_graph<unsigned int> compact_csr_graph;
+}
+
+/**
+ * Calls fn(const edge* edges, size_t count) with every undirected edge exactly once, using the
+ * original node labels, in batches of at most batch_size edges.
+ */
+template<typename Vertex>
+template<typename Fn>
+void tcount::basic_csr_graph<Vertex>::for_each_batch(Fn fn, size_t batch_size) const {
+    std::vector<edge> batch;
+    batch.reserve(batch_size);
+
+    for (unsigned long u = 0; u < n; ++u) {
+        for (unsigned long i = node_array_[u]; i < node_array_[u + 1]; ++i) {
+            unsigned long v = edge_array_[i];
+            if (u < v) {
+                batch.emplace_back(original_label(u), original_label(v));
+                if (batch.size() == batch_size) {
+                    fn(batch.data(), batch.size());
+                    batch.clear();
+                }
+            }
+        }
+    }
+
+    if (!batch.empty()) {
+        fn(batch.data(), batch.size());
+    }
+}
+
+/**
+ * Passes every undirected edge exactly once to consumer.add_edge(u, v), using the original node labels.
+ */
+template<typename Vertex>
+template<typename Consumer>
+void tcount::basic_csr_graph<Vertex>::feed(Consumer &consumer) const {
+    for_each_batch([&consumer](const edge* edges, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            consumer.add_edge(edges[i].first, edges[i].second);
+        }
+    });
+}
+
+#endif //TRIANGLECOUNTINGAPI_CSR_GRAPH_H
@@ -0,0 +1,167 @@
+//
+// DOULION sparsification as a stage in front of any triangle counting engine: every edge is kept
+// with probability p, and a count on the kept edges is scaled back up by 1 / p^3.
+//
+
+#include "doulion.h"
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include "parallel.h"
+#include "stats.h"
+
+namespace {
+    // lines or edge array entries per independently seeded chunk, fixed so that the kept edges
+    // depend only on the seed and not on the number of threads
+    const size_t CHUNK_BYTES = 1u << 20;
+    const size_t CHUNK_ENTRIES = 1u << 20;
+
+    std::mt19937_64 chunk_generator(unsigned long long seed, size_t chunk) {
+        //the last word keeps these streams apart from an engine given the same seed
+        std::seed_seq seq{static_cast<unsigned int>(seed), static_cast<unsigned int>(seed >> 32),
+                          static_cast<unsigned int>(chunk), static_cast<unsigned int>(chunk >> 32), 0x646f756cu};
+        return std::mt19937_64(seq);
+    }
+
+    std::vector<tcount::edge> join(std::vector<std::vector<tcount::edge>> &parts) {
+        size_t total = 0;
+        for (const auto &part: parts) {
+            total += part.size();
+        }
+        std::vector<tcount::edge> edges;
+        edges.reserve(total);
+        for (auto &part: parts) {
+            edges.insert(edges.end(), part.begin(), part.end());
+            std::vector<tcount::edge>().swap(part);
+        }
+        return edges;
+    }
+}
+
+/**
+ * @param p The probability of keeping each edge, in (0, 1].
+ * @param seed The seed of the coin flips, so a run can be reproduced.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ */
+tcount::doulion::doulion(double p, unsigned long long seed, unsigned int threads) {
+    if (!(p > 0.0 && p <= 1.0)) {
+        throw std::invalid_argument("doulion probability must be in (0, 1]");
+    }
+    this->p = p;
+    this->seed = seed;
+    this->threads = threads == 0 ? default_threads() : threads;
+}
+
+double tcount::doulion::probability() const {
+    return p;
+}
+
+/**
+ * @param triangles A triangle count, exact or estimated, of the sparsified graph.
+ * @return The estimated triangle count of the whole graph.
+ */
+double tcount::doulion::scale(double triangles) const {
+    return triangles / (p * p * p);
+}
+
+/**
+ * Sparsifies a text edge list or a .tcsr file.
+ *
+ * @param filename The path of the input.
+ * @return The kept edges, in file order.
+ */
+std::vector<tcount::edge> tcount::doulion::sparsify(const char* filename) const {
+    if (csr_graph::is_csr_file(filename)) {
+        return sparsify(csr_graph(filename));
+    }
+
+    mapped_file file(filename);
+    file.advise_sequential();
+    return sparsify_text(file.data(), file.data() + file.size());
+}
+
+/**
+ * Keeps every line of a text edge list with probability p. Instead of a coin flip per line, the
+ * number of lines to the next kept one is drawn from a geometric distribution, and the lines in
+ * between are stepped over with memchr without being parsed.
+ *
+ * @param begin The start of the edge list.
+ * @param end The end of the edge list.
+ * @return The edges on the kept lines, in file order.
+ */
+std::vector<tcount::edge> tcount::doulion::sparsify_text(const char* begin, const char* end) const {
+    //the skipped lines are never parsed, so sparsifying text is part of loading it
+    stats::phase_timer timer(stats::phase::load);
+    size_t chunks = (static_cast<size_t>(end - begin) + CHUNK_BYTES - 1) / CHUNK_BYTES;
+    std::vector<std::vector<edge>> parts(chunks);
+
+    parallel_for_dynamic(0, chunks, 1, threads, [&](unsigned int, size_t lo, size_t hi) {
+        for (size_t chunk = lo; chunk < hi; ++chunk) {
+            //the chunk owns every line that starts inside its bytes
+            const char* p_lo = chunk == 0 ? begin : next_line(begin + chunk * CHUNK_BYTES - 1, end);
+            const char* p_hi = chunk + 1 == chunks ? end : next_line(begin + (chunk + 1) * CHUNK_BYTES - 1, end);
+
+            std::mt19937_64 mt = chunk_generator(seed, chunk);
+            std::geometric_distribution<unsigned long> skip(p);
+            parts[chunk].reserve(static_cast<size_t>(p * static_cast<double>(p_hi - p_lo) / 16));
+
+            unsigned long u, v;
+            bool is_edge;
+            const char* line = p_lo;
+            while (line < p_hi) {
+                for (unsigned long k = skip(mt); k > 0 && line < p_hi; --k) {
+                    line = next_line(line, p_hi);
+                }
+                if (line >= p_hi) {
+                    break;
+                }
+                line = parse_edge_line(line, p_hi, u, v, is_edge);
+                if (is_edge) {
+                    parts[chunk].emplace_back(u, v);
+                }
+            }
+        }
+    });
+
+    std::vector<edge> kept = join(parts);
+    stats::add(stats::counter::edges_ingested, kept.size());
+    return kept;
+}
+
+/**
+ * Keeps every undirected edge of a CSR with probability p, skipping through the edge array with
+ * geometric jumps. Each edge is kept or dropped through the entry in the list of its lower end.
+ *
+ * @param graph The graph to sparsify.
+ * @return The kept edges with their original labels, ordered as in the edge array.
+ */
+std::vector<tcount::edge> tcount::doulion::sparsify(const csr_graph &graph) const {
+    stats::phase_timer timer(stats::phase::preprocess);
+    const unsigned long* node_array = graph.node_array();
+    const unsigned long* edge_array = graph.edge_array();
+    unsigned long n = graph.number_of_nodes();
+    unsigned long entries = graph.size_of_edge_array();
+
+    size_t chunks = (entries + CHUNK_ENTRIES - 1) / CHUNK_ENTRIES;
+    std::vector<std::vector<edge>> parts(chunks);
+
+    parallel_for_dynamic(0, chunks, 1, threads, [&](unsigned int, size_t lo, size_t hi) {
+        for (size_t chunk = lo; chunk < hi; ++chunk) {
+            std::mt19937_64 mt = chunk_generator(seed, chunk);
+            std::geometric_distribution<unsigned long> skip(p);
+
+            unsigned long first = chunk * CHUNK_ENTRIES;
+            unsigned long last = std::min<unsigned long>(entries, first + CHUNK_ENTRIES);
+            for (unsigned long i = first + skip(mt); i < last; i += skip(mt) + 1) {
+                auto u = static_cast<unsigned long>(std::upper_bound(node_array, node_array + n + 1, i) - node_array - 1);
+                unsigned long v = edge_array[i];
+                if (u < v) {
+                    parts[chunk].emplace_back(graph.original_label(u), graph.original_label(v));
+                }
+            }
+        }
+    });
+
+    return join(parts);
+}
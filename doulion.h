@@ -0,0 +1,29 @@
+//
+// DOULION sparsification as a stage in front of any triangle counting engine: every edge is kept
+// with probability p, and a count on the kept edges is scaled back up by 1 / p^3.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_DOULION_H
+#define TRIANGLECOUNTINGAPI_DOULION_H
+
+#include <vector>
+#include "csr_graph.h"
+#include "edge_list_reader.h"
+
+namespace tcount {
+    class doulion {
+        double p;
+        unsigned long long seed;
+        unsigned int threads;
+
+    public:
+        doulion(double p, unsigned long long seed, unsigned int threads = 0);
+        double probability() const;
+        double scale(double triangles) const;
+        std::vector<edge> sparsify(const char* filename) const;
+        std::vector<edge> sparsify_text(const char* begin, const char* end) const;
+        std::vector<edge> sparsify(const csr_graph &graph) const;
+    };
+}
+
+#endif //TRIANGLECOUNTINGAPI_DOULION_H
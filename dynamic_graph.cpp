@@ -0,0 +1,363 @@
+//
+// An undirected graph that keeps its exact triangle count, and optionally the triangle count of
+// every vertex, up to date as edges are inserted and deleted.
+//
+
+#include "dynamic_graph.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include "intersection.h"
+#include "parallel.h"
+
+namespace {
+    // an undirected edge between two vertices as one sortable key, lower vertex in the high bits
+    unsigned long long edge_key(unsigned int a, unsigned int b) {
+        return a < b ? (static_cast<unsigned long long>(a) << 32) | b
+                     : (static_cast<unsigned long long>(b) << 32) | a;
+    }
+
+    unsigned int high(unsigned long long key) {
+        return static_cast<unsigned int>(key >> 32);
+    }
+
+    unsigned int low(unsigned long long key) {
+        return static_cast<unsigned int>(key);
+    }
+}
+
+/**
+ * @param per_vertex Whether to also keep the triangle count of every vertex.
+ * @param threads The number of threads batches are applied with, or 0 to use every hardware thread.
+ */
+tcount::dynamic_graph::dynamic_graph(bool per_vertex, unsigned int threads) {
+    this->per_vertex = per_vertex;
+    this->threads = threads == 0 ? default_threads() : threads;
+    this->triangles = 0;
+    this->edges = 0;
+}
+
+/**
+ * Inserts the edge e = (u, v), adding the triangles it closes to the count. Costs one intersection
+ * of the neighbour lists of u and v.
+ *
+ * @param u The node u of the edge e
+ * @param v The node v of the edge e
+ * @return False if e is a self loop or was already in the graph.
+ */
+bool tcount::dynamic_graph::insert_edge(unsigned long u, unsigned long v) {
+    if (u == v) {
+        return false;
+    }
+    unsigned int a = vertex(u), b = vertex(v);
+    if (adjacent(a, b)) {
+        return false;
+    }
+
+    const std::vector<unsigned int> &na = adjacency[a], &nb = adjacency[b];
+    unsigned long closed = intersection_count(na.data(), na.size(), nb.data(), nb.size());
+    triangles += closed;
+
+    if (per_vertex && closed > 0) {
+        vertex_triangles_[a] += closed;
+        vertex_triangles_[b] += closed;
+        for (size_t i = 0, j = 0; i < na.size() && j < nb.size();) {
+            if (na[i] < nb[j]) {
+                ++i;
+            }
+            else if (nb[j] < na[i]) {
+                ++j;
+            }
+            else {
+                vertex_triangles_[na[i]] += 1;
+                ++i;
+                ++j;
+            }
+        }
+    }
+
+    adjacency[a].insert(std::lower_bound(adjacency[a].begin(), adjacency[a].end(), b), b);
+    adjacency[b].insert(std::lower_bound(adjacency[b].begin(), adjacency[b].end(), a), a);
+    edges += 1;
+
+    return true;
+}
+
+/**
+ * Deletes the edge e = (u, v), taking the triangles it was part of off the count. Costs one
+ * intersection of the neighbour lists of u and v.
+ *
+ * @param u The node u of the edge e
+ * @param v The node v of the edge e
+ * @return False if e was not in the graph.
+ */
+bool tcount::dynamic_graph::remove_edge(unsigned long u, unsigned long v) {
+    auto iu = index.find(u), iv = index.find(v);
+    if (iu == index.end() || iv == index.end() || !adjacent(iu->second, iv->second)) {
+        return false;
+    }
+    unsigned int a = iu->second, b = iv->second;
+
+    adjacency[a].erase(std::lower_bound(adjacency[a].begin(), adjacency[a].end(), b));
+    adjacency[b].erase(std::lower_bound(adjacency[b].begin(), adjacency[b].end(), a));
+    edges -= 1;
+
+    const std::vector<unsigned int> &na = adjacency[a], &nb = adjacency[b];
+    unsigned long opened = intersection_count(na.data(), na.size(), nb.data(), nb.size());
+    triangles -= opened;
+
+    if (per_vertex && opened > 0) {
+        vertex_triangles_[a] -= opened;
+        vertex_triangles_[b] -= opened;
+        for (size_t i = 0, j = 0; i < na.size() && j < nb.size();) {
+            if (na[i] < nb[j]) {
+                ++i;
+            }
+            else if (nb[j] < na[i]) {
+                ++j;
+            }
+            else {
+                vertex_triangles_[na[i]] -= 1;
+                ++i;
+                ++j;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Applies a batch of deletions and then a batch of insertions, in parallel. Self loops, repeated
+ * edges, insertions of edges already in the graph and deletions of edges not in it are ignored.
+ *
+ * Every edge of the batch costs one intersection. A triangle with more than one edge in the batch
+ * is counted only from the first of those edges in key order, so the threads never need to agree
+ * on anything.
+ *
+ * @param insertions The edges to insert.
+ * @param deletions The edges to delete.
+ */
+void tcount::dynamic_graph::apply(const std::vector<edge> &insertions, const std::vector<edge> &deletions) {
+    std::vector<unsigned long long> removed = batch_keys(deletions, true);
+    //the triangles through deleted edges are counted before the edges go
+    triangles -= count_batch(removed, -1);
+    update_lists(removed, false);
+    edges -= removed.size();
+
+    std::vector<unsigned long long> added = batch_keys(insertions, false);
+    //and the triangles through inserted edges once they are all in
+    update_lists(added, true);
+    triangles += count_batch(added, 1);
+    edges += added.size();
+}
+
+/**
+ * @return True if the edge (u, v) is in the graph.
+ */
+bool tcount::dynamic_graph::has_edge(unsigned long u, unsigned long v) const {
+    auto iu = index.find(u), iv = index.find(v);
+    return iu != index.end() && iv != index.end() && adjacent(iu->second, iv->second);
+}
+
+unsigned long long tcount::dynamic_graph::number_of_triangles() const {
+    return triangles;
+}
+
+/**
+ * @return The number of triangles u is part of.
+ */
+unsigned long long tcount::dynamic_graph::vertex_triangles(unsigned long u) const {
+    if (!per_vertex) {
+        throw std::logic_error("per vertex triangle counts were not enabled");
+    }
+    auto iu = index.find(u);
+    return iu == index.end() ? 0 : vertex_triangles_[iu->second];
+}
+
+/**
+ * @return The number of vertices that have ever had an edge.
+ */
+unsigned long tcount::dynamic_graph::number_of_nodes() const {
+    return labels.size();
+}
+
+unsigned long long tcount::dynamic_graph::number_of_edges() const {
+    return edges;
+}
+
+/**
+ * @return The vertex of an original id, added to the graph if it is new.
+ */
+unsigned int tcount::dynamic_graph::vertex(unsigned long id) {
+    auto it = index.find(id);
+    if (it != index.end()) {
+        return it->second;
+    }
+
+    if (labels.size() >= 0xffffffffu) {
+        throw std::length_error("dynamic_graph supports at most 2^32 - 1 vertices");
+    }
+    auto a = static_cast<unsigned int>(labels.size());
+    index.emplace(id, a);
+    labels.push_back(id);
+    adjacency.emplace_back();
+    if (per_vertex) {
+        vertex_triangles_.push_back(0);
+    }
+    return a;
+}
+
+bool tcount::dynamic_graph::adjacent(unsigned int a, unsigned int b) const {
+    //search the shorter list
+    const std::vector<unsigned int> &list = adjacency[a].size() <= adjacency[b].size() ? adjacency[a] : adjacency[b];
+    unsigned int other = adjacency[a].size() <= adjacency[b].size() ? b : a;
+    return std::binary_search(list.begin(), list.end(), other);
+}
+
+/**
+ * Turns a batch of edges into sorted, unique edge keys, keeping only the edges whose presence in
+ * the graph is present: true for deletions, false for insertions.
+ */
+std::vector<unsigned long long> tcount::dynamic_graph::batch_keys(const std::vector<edge> &batch, bool present) {
+    std::vector<unsigned long long> keys;
+    keys.reserve(batch.size());
+    for (const auto &e: batch) {
+        if (e.first == e.second) {
+            continue;
+        }
+        if (present) {
+            //an edge to an unknown vertex cannot be deleted
+            auto iu = index.find(e.first), iv = index.find(e.second);
+            if (iu != index.end() && iv != index.end()) {
+                keys.push_back(edge_key(iu->second, iv->second));
+            }
+        }
+        else {
+            keys.push_back(edge_key(vertex(e.first), vertex(e.second)));
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::vector<char> keep(keys.size());
+    parallel_for_dynamic(0, keys.size(), 1024, threads, [&](unsigned int, size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) {
+            keep[i] = adjacent(high(keys[i]), low(keys[i])) == present;
+        }
+    });
+
+    size_t size = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (keep[i]) {
+            keys[size++] = keys[i];
+        }
+    }
+    keys.resize(size);
+    return keys;
+}
+
+/**
+ * Inserts or deletes a batch of edges in the neighbour lists. Each vertex's list is merged with all
+ * of its changes at once, by one thread.
+ */
+void tcount::dynamic_graph::update_lists(const std::vector<unsigned long long> &keys, bool insert) {
+    //both directions of every edge, grouped by vertex
+    std::vector<unsigned long long> changes;
+    changes.reserve(keys.size() * 2);
+    for (unsigned long long key: keys) {
+        changes.push_back(key);
+        changes.push_back((key << 32) | (key >> 32));
+    }
+    std::sort(changes.begin(), changes.end());
+
+    std::vector<size_t> groups;
+    for (size_t i = 0; i < changes.size(); ++i) {
+        if (i == 0 || high(changes[i]) != high(changes[i - 1])) {
+            groups.push_back(i);
+        }
+    }
+    groups.push_back(changes.size());
+
+    parallel_for_dynamic(0, groups.size() - 1, 64, threads, [&](unsigned int, size_t lo, size_t hi) {
+        std::vector<unsigned int> neighbours, merged;
+        for (size_t g = lo; g < hi; ++g) {
+            std::vector<unsigned int> &list = adjacency[high(changes[groups[g]])];
+            neighbours.clear();
+            for (size_t i = groups[g]; i < groups[g + 1]; ++i) {
+                neighbours.push_back(low(changes[i]));
+            }
+
+            merged.clear();
+            if (insert) {
+                std::merge(list.begin(), list.end(), neighbours.begin(), neighbours.end(), std::back_inserter(merged));
+            }
+            else {
+                std::set_difference(list.begin(), list.end(), neighbours.begin(), neighbours.end(),
+                                    std::back_inserter(merged));
+            }
+            list.assign(merged.begin(), merged.end());
+        }
+    });
+}
+
+/**
+ * Counts the triangles through the edges of a batch in the current graph, each once, and adds
+ * sign times each triangle to the counts of its vertices.
+ *
+ * @param keys The batch, sorted. Every edge must be in the graph.
+ * @param sign 1 for insertions, -1 for deletions.
+ * @return The number of triangles.
+ */
+long long tcount::dynamic_graph::count_batch(const std::vector<unsigned long long> &keys, long long sign) {
+    std::vector<unsigned long long> totals(threads, 0);
+    // per thread triangle vertices, applied to the per vertex counts afterwards
+    std::vector<std::vector<unsigned int>> touched(per_vertex ? threads : 0);
+
+    //is the edge (x, w) in the batch at a position before i
+    auto earlier = [&keys](unsigned int x, unsigned int w, size_t i) {
+        auto it = std::lower_bound(keys.begin(), keys.begin() + i, edge_key(x, w));
+        return it != keys.begin() + i && *it == edge_key(x, w);
+    };
+
+    parallel_for_dynamic(0, keys.size(), 256, threads, [&](unsigned int t, size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) {
+            unsigned int a = high(keys[i]), b = low(keys[i]);
+            const std::vector<unsigned int> &na = adjacency[a], &nb = adjacency[b];
+
+            for (size_t x = 0, y = 0; x < na.size() && y < nb.size();) {
+                if (na[x] < nb[y]) {
+                    ++x;
+                }
+                else if (nb[y] < na[x]) {
+                    ++y;
+                }
+                else {
+                    unsigned int w = na[x];
+                    if (!earlier(a, w, i) && !earlier(b, w, i)) {
+                        totals[t] += 1;
+                        if (per_vertex) {
+                            touched[t].push_back(a);
+                            touched[t].push_back(b);
+                            touched[t].push_back(w);
+                        }
+                    }
+                    ++x;
+                    ++y;
+                }
+            }
+        }
+    });
+
+    for (const auto &list: touched) {
+        for (unsigned int w: list) {
+            vertex_triangles_[w] += sign;
+        }
+    }
+
+    unsigned long long total = 0;
+    for (unsigned long long t: totals) {
+        total += t;
+    }
+    return static_cast<long long>(total);
+}
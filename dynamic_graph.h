@@ -0,0 +1,48 @@
+//
+// An undirected graph that keeps its exact triangle count, and optionally the triangle count of
+// every vertex, up to date as edges are inserted and deleted.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_DYNAMIC_GRAPH_H
+#define TRIANGLECOUNTINGAPI_DYNAMIC_GRAPH_H
+
+#include <unordered_map>
+#include <vector>
+#include "edge_list_reader.h"
+
+namespace tcount {
+    class dynamic_graph {
+        // original id -> vertex, and back
+        std::unordered_map<unsigned long, unsigned int> index;
+        std::vector<unsigned long> labels;
+        // sorted neighbour lists
+        std::vector<std::vector<unsigned int>> adjacency;
+        // empty unless per vertex counts were asked for
+        std::vector<unsigned long long> vertex_triangles_;
+
+        bool per_vertex;
+        unsigned int threads;
+        unsigned long long triangles;
+        unsigned long long edges;
+
+    public:
+        explicit dynamic_graph(bool per_vertex = false, unsigned int threads = 0);
+        bool insert_edge(unsigned long u, unsigned long v);
+        bool remove_edge(unsigned long u, unsigned long v);
+        void apply(const std::vector<edge> &insertions, const std::vector<edge> &deletions);
+        bool has_edge(unsigned long u, unsigned long v) const;
+        unsigned long long number_of_triangles() const;
+        unsigned long long vertex_triangles(unsigned long u) const;
+        unsigned long number_of_nodes() const;
+        unsigned long long number_of_edges() const;
+
+    private:
+        unsigned int vertex(unsigned long id);
+        bool adjacent(unsigned int a, unsigned int b) const;
+        std::vector<unsigned long long> batch_keys(const std::vector<edge> &batch, bool present);
+        void update_lists(const std::vector<unsigned long long> &keys, bool insert);
+        long long count_batch(const std::vector<unsigned long long> &keys, long long sign);
+    };
+}
+
+#endif //TRIANGLECOUNTINGAPI_DYNAMIC_GRAPH_H
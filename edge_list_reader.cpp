@@ -0,0 +1,167 @@
+//
+// A memory mapped, multi-threaded reader for whitespace separated edge list files.
+//
+
+#include "edge_list_reader.h"
+
+#include <cstring>
+
+/**
+ * @return A pointer to the first character after the next newline at or after p, or end if there is none.
+ */
+const char* tcount::next_line(const char* p, const char* end) {
+    const void* newline = memchr(p, '\n', static_cast<size_t>(end - p));
+    return newline == nullptr ? end : static_cast<const char*>(newline) + 1;
+}
+
+/**
+ * Parses a single line of an edge list. Lines starting with '#' or '%' are comments, and anything
+ * after the second node id (such as an edge weight) is ignored.
+ *
+ * @param p The start of the line.
+ * @param end The end of the buffer.
+ * @param u Set to the node u of the edge if the line holds one.
+ * @param v Set to the node v of the edge if the line holds one.
+ * @param is_edge Set to true if the line held an edge, false if it was blank, a comment or malformed.
+ * @return The start of the next line.
+ */
+const char* tcount::parse_edge_line(const char* p, const char* end, unsigned long &u, unsigned long &v, bool &is_edge) {
+    is_edge = false;
+
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        ++p;
+    }
+    if (p == end || *p < '0' || *p > '9') {
+        return p < end && *p == '\n' ? p + 1 : next_line(p, end);
+    }
+
+    unsigned long x = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        x = x * 10 + static_cast<unsigned long>(*p - '0');
+        ++p;
+    }
+
+    while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) {
+        ++p;
+    }
+    if (p == end || *p < '0' || *p > '9') {
+        return next_line(p, end);
+    }
+
+    unsigned long y = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        y = y * 10 + static_cast<unsigned long>(*p - '0');
+        ++p;
+    }
+
+    u = x;
+    v = y;
+    is_edge = true;
+
+    return p < end && *p == '\n' ? p + 1 : next_line(p, end);
+}
+
+/**
+ * Parses every edge in [begin, end) and appends them to out in order.
+ * begin must be the start of a line.
+ */
+void tcount::parse_edges(const char* begin, const char* end, std::vector<edge> &out) {
+    //a typical SNAP line is around 16 bytes
+    out.reserve(out.size() + static_cast<size_t>(end - begin) / 16);
+
+    unsigned long u = 0, v = 0;
+    bool is_edge;
+    const char* p = begin;
+    while (p < end) {
+        p = parse_edge_line(p, end, u, v, is_edge);
+        if (is_edge) {
+            out.emplace_back(u, v);
+        }
+    }
+}
+
+/**
+ * Splits [begin, end) into the specified number of roughly equal parts that all start on a line boundary.
+ *
+ * @return parts + 1 boundaries, the first being begin and the last being end. Parts may be empty.
+ */
+std::vector<const char*> tcount::split_lines(const char* begin, const char* end, unsigned long parts) {
+    if (parts == 0) {
+        parts = 1;
+    }
+
+    std::vector<const char*> bounds(parts + 1);
+    auto length = static_cast<size_t>(end - begin);
+
+    bounds[0] = begin;
+    for (unsigned long i = 1; i < parts; ++i) {
+        const char* guess = begin + length / parts * i;
+        const char* bound = guess <= bounds[i - 1] ? bounds[i - 1] : next_line(guess - 1, end);
+        bounds[i] = bound;
+    }
+    bounds[parts] = end;
+
+    return bounds;
+}
+
+/**
+ * Maps the specified edge list file for reading.
+ *
+ * @param filename The path of the edge list.
+ * @param threads The number of threads to parse with, or 0 to use every hardware thread.
+ */
+tcount::edge_list_reader::edge_list_reader(const char* filename, unsigned int threads) : file(filename) {
+    this->threads = threads == 0 ? default_threads() : threads;
+    this->chunk_bytes = 8u << 20;
+    file.advise_sequential();
+}
+
+size_t tcount::edge_list_reader::size() const {
+    return file.size();
+}
+
+const char* tcount::edge_list_reader::data() const {
+    return file.data();
+}
+
+unsigned int tcount::edge_list_reader::number_of_threads() const {
+    return threads;
+}
+
+/**
+ * Sets how many bytes each thread parses per batch in for_each_batch. Larger chunks mean fewer,
+ * larger batches and more memory held at once.
+ */
+void tcount::edge_list_reader::set_chunk_bytes(size_t bytes) {
+    this->chunk_bytes = bytes == 0 ? 1 : bytes;
+}
+
+/**
+ * Parses the whole file at once.
+ *
+ * @return Every edge in the file, in file order.
+ */
+std::vector<tcount::edge> tcount::edge_list_reader::read_edges() {
+    stats::phase_timer timer(stats::phase::load);
+    const char* begin = file.data();
+    auto bounds = split_lines(begin, begin + file.size(), threads);
+
+    std::vector<std::vector<edge>> parts(threads);
+    parallel_run(threads, [&](unsigned int t) {
+        parse_edges(bounds[t], bounds[t + 1], parts[t]);
+    });
+
+    std::vector<size_t> offsets(threads + 1, 0);
+    for (unsigned int t = 0; t < threads; ++t) {
+        offsets[t + 1] = offsets[t] + parts[t].size();
+    }
+
+    std::vector<edge> edges(offsets[threads]);
+    parallel_run(threads, [&](unsigned int t) {
+        std::copy(parts[t].begin(), parts[t].end(), edges.begin() + offsets[t]);
+        std::vector<edge>().swap(parts[t]);
+    });
+    stats::add(stats::counter::edges_ingested, edges.size());
+
+    return edges;
+}
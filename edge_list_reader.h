@@ -0,0 +1,117 @@
+//
+// A memory mapped, multi-threaded reader for whitespace separated edge list files.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_EDGE_LIST_READER_H
+#define TRIANGLECOUNTINGAPI_EDGE_LIST_READER_H
+
+#include <future>
+#include <utility>
+#include <vector>
+#include "mapped_file.h"
+#include "parallel.h"
+#include "stats.h"
+
+namespace tcount {
+    typedef std::pair<unsigned long, unsigned long> edge;
+
+    const char* next_line(const char* p, const char* end);
+    const char* parse_edge_line(const char* p, const char* end, unsigned long &u, unsigned long &v, bool &is_edge);
+    void parse_edges(const char* begin, const char* end, std::vector<edge> &out);
+    std::vector<const char*> split_lines(const char* begin, const char* end, unsigned long parts);
+
+    class edge_list_reader {
+        mapped_file file;
+        unsigned int threads;
+        size_t chunk_bytes;
+
+    public:
+        explicit edge_list_reader(const char* filename, unsigned int threads = 0);
+        size_t size() const;
+        const char* data() const;
+        unsigned int number_of_threads() const;
+        void set_chunk_bytes(size_t bytes);
+        std::vector<edge> read_edges();
+        template<typename Fn> void for_each_batch(Fn fn);
+        template<typename Consumer> void feed(Consumer &consumer);
+    };
+}
+
+/**
+ * Parses the file one window at a time, each window being split over all threads, and calls
+ * fn(const edge* edges, size_t count) for every parsed batch in file order. The next window is
+ * parsed in the background while fn consumes the current one, so fn need not be thread safe.
+ */
+template<typename Fn>
+void tcount::edge_list_reader::for_each_batch(Fn fn) {
+    const char* begin = file.data();
+    const char* end = begin + file.size();
+    size_t window_bytes = chunk_bytes * threads;
+
+    auto parse_window = [this](const char* lo, const char* hi) {
+        auto bounds = split_lines(lo, hi, threads);
+        std::vector<std::vector<edge>> parts(bounds.size() - 1);
+        parallel_run(static_cast<unsigned int>(parts.size()), [&](unsigned int t) {
+            parse_edges(bounds[t], bounds[t + 1], parts[t]);
+        });
+        return parts;
+    };
+
+    auto window_end = [&](const char* lo) {
+        if (static_cast<size_t>(end - lo) <= window_bytes) {
+            return end;
+        }
+        return next_line(lo + window_bytes, end);
+    };
+
+    const char* lo = begin;
+    if (lo == end) {
+        return;
+    }
+    const char* hi = window_end(lo);
+    auto pending = std::async(std::launch::async, parse_window, lo, hi);
+
+    while (true) {
+        std::vector<std::vector<edge>> parts;
+        {
+            //only the wait for the parser counts as loading, fn times itself
+            stats::phase_timer timer(stats::phase::load);
+            parts = pending.get();
+            for (const auto &part: parts) {
+                stats::add(stats::counter::edges_ingested, part.size());
+            }
+        }
+        lo = hi;
+        bool more = lo < end;
+        if (more) {
+            hi = window_end(lo);
+            pending = std::async(std::launch::async, parse_window, lo, hi);
+        }
+
+        for (const auto &part: parts) {
+            if (!part.empty()) {
+                fn(part.data(), part.size());
+            }
+        }
+
+        if (!more) {
+            break;
+        }
+    }
+}
+
+/**
+ * Reads every edge in the file and passes it to consumer.add_edge(u, v), in file order.
+ *
+ * @param consumer Any object with an add_edge(unsigned long, unsigned long) method.
+ */
+template<typename Consumer>
+void tcount::edge_list_reader::feed(Consumer &consumer) {
+    for_each_batch([&consumer](const edge* edges, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            consumer.add_edge(edges[i].first, edges[i].second);
+        }
+    });
+}
+
+#endif //TRIANGLECOUNTINGAPI_EDGE_LIST_READER_H
@@ -0,0 +1,174 @@
+//
+// Synthetic graph generators: R-MAT, Erdos-Renyi G(n, m) and a power law configuration model.
+//
+
+#include "generators.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include "parallel.h"
+
+namespace {
+    // edges are drawn in this many independently seeded blocks, so the graph for a seed is the same
+    // whatever the number of threads
+    const unsigned int GENERATOR_BLOCKS = 256;
+
+    unsigned long long block_seed(unsigned long long seed, unsigned int block) {
+        return seed ^ (0x9e3779b97f4a7c15ull * (block + 1));
+    }
+
+    // rounds of the id permutation; each is a bijection on scale bit ids, keyed by the seed
+    const unsigned int PERMUTATION_ROUNDS = 3;
+
+    // a random looking bijection on [0, 2^scale): adding a key and multiplying by an odd constant
+    // are bijective modulo 2^scale, and so is x ^ (x >> s) on scale bit values
+    unsigned long permute_id(unsigned long x, unsigned int scale, const unsigned long long* keys) {
+        unsigned long long mask = (1ull << scale) - 1;
+        unsigned int shift = scale / 2 + 1;
+        for (unsigned int r = 0; r < PERMUTATION_ROUNDS; ++r) {
+            x = static_cast<unsigned long>(((x + keys[r]) * 0xbf58476d1ce4e5b9ull) & mask);
+            x ^= x >> shift;
+        }
+        return x;
+    }
+
+    // calls fn(mt, first, last) for every block of the edge range [0, edges)
+    template<typename Fn>
+    void for_each_block(unsigned long edges, unsigned long long seed, unsigned int threads, Fn fn) {
+        if (threads == 0) {
+            threads = tcount::default_threads();
+        }
+        tcount::parallel_for_dynamic(0, GENERATOR_BLOCKS, 1, threads, [&](unsigned int, size_t lo, size_t hi) {
+            for (size_t b = lo; b < hi; ++b) {
+                std::mt19937_64 mt(block_seed(seed, static_cast<unsigned int>(b)));
+                fn(mt, edges / GENERATOR_BLOCKS * b + std::min<size_t>(b, edges % GENERATOR_BLOCKS),
+                   edges / GENERATOR_BLOCKS * (b + 1) + std::min<size_t>(b + 1, edges % GENERATOR_BLOCKS));
+            }
+        });
+    }
+}
+
+/**
+ * Generates a recursive matrix (R-MAT) graph: every edge picks one quadrant of the adjacency
+ * matrix by the given probabilities, then recurses into it once per bit of the node ids. The ids
+ * are then randomly permuted, as in Graph500, so that the degree of a node says nothing about its id.
+ * The permutation is a keyed bijective mix of the id bits rather than a shuffled table, so it takes
+ * no memory whatever the scale.
+ *
+ * The edges are returned as drawn, so they include self loops and duplicates, which build_csr drops.
+ *
+ * @param scale The graph has 2^scale node ids.
+ * @param edges The number of edges to draw.
+ * @param seed The random seed.
+ * @param parameters The quadrant probabilities.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @return The edges.
+ */
+std::vector<tcount::edge> tcount::generate_rmat(unsigned int scale, unsigned long edges, unsigned long long seed,
+                                                rmat_parameters parameters, unsigned int threads) {
+    if (scale == 0 || scale > 40) {
+        throw std::invalid_argument("the R-MAT scale must be between 1 and 40");
+    }
+    double ab = parameters.a + parameters.b;
+    double abc = ab + parameters.c;
+    if (parameters.a < 0 || parameters.b < 0 || parameters.c < 0 || abc > 1.0) {
+        throw std::invalid_argument("the R-MAT probabilities must be non-negative and sum to at most 1");
+    }
+
+    std::vector<edge> out(edges);
+    for_each_block(edges, seed, threads, [&](std::mt19937_64 &mt, size_t first, size_t last) {
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        for (size_t i = first; i < last; ++i) {
+            unsigned long u = 0, v = 0;
+            for (unsigned int bit = 0; bit < scale; ++bit) {
+                double r = dist(mt);
+                u = (u << 1) | (r >= ab ? 1ul : 0ul);
+                v = (v << 1) | ((r >= parameters.a && r < ab) || r >= abc ? 1ul : 0ul);
+            }
+            out[i] = edge(u, v);
+        }
+    });
+
+    std::mt19937_64 mt(seed);
+    unsigned long long keys[PERMUTATION_ROUNDS];
+    for (unsigned long long &key: keys) {
+        key = mt();
+    }
+    for_each_block(edges, seed, threads, [&](std::mt19937_64 &, size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            out[i] = edge(permute_id(out[i].first, scale, keys), permute_id(out[i].second, scale, keys));
+        }
+    });
+
+    return out;
+}
+
+/**
+ * Generates an Erdos-Renyi G(n, m) graph, every edge joining two nodes drawn uniformly at random.
+ * Self loops and duplicates are returned as drawn, and build_csr drops them, which for sparse
+ * graphs removes very few edges.
+ *
+ * @param nodes The number of nodes.
+ * @param edges The number of edges to draw.
+ * @param seed The random seed.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @return The edges.
+ */
+std::vector<tcount::edge> tcount::generate_erdos_renyi(unsigned long nodes, unsigned long edges,
+                                                       unsigned long long seed, unsigned int threads) {
+    if (nodes < 2) {
+        throw std::invalid_argument("an Erdos-Renyi graph needs at least two nodes");
+    }
+
+    std::vector<edge> out(edges);
+    for_each_block(edges, seed, threads, [&](std::mt19937_64 &mt, size_t first, size_t last) {
+        std::uniform_int_distribution<unsigned long> dist(0, nodes - 1);
+        for (size_t i = first; i < last; ++i) {
+            unsigned long u = dist(mt);
+            out[i] = edge(u, dist(mt));
+        }
+    });
+    return out;
+}
+
+/**
+ * Generates a graph with a power law degree distribution through the configuration model: every
+ * node draws a degree d >= min_degree with P(d) ~ d^-exponent, capped at nodes - 1, and the
+ * resulting half edges are paired uniformly at random. Pairs that make a self loop or repeat an
+ * edge are returned as they are and dropped by build_csr (the erased configuration model).
+ *
+ * @param nodes The number of nodes.
+ * @param exponent The power law exponent, greater than 1; real networks mostly lie in (2, 3).
+ * @param min_degree The smallest degree drawn.
+ * @param seed The random seed.
+ * @return The edges.
+ */
+std::vector<tcount::edge> tcount::generate_power_law(unsigned long nodes, double exponent, unsigned long min_degree,
+                                                     unsigned long long seed) {
+    if (nodes < 2 || exponent <= 1.0 || min_degree == 0) {
+        throw std::invalid_argument("a power law graph needs at least two nodes, an exponent above 1 and a "
+                                    "positive minimum degree");
+    }
+
+    std::mt19937_64 mt(seed);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    std::vector<unsigned long> stubs;
+    for (unsigned long u = 0; u < nodes; ++u) {
+        //inverse transform of the continuous power law, rounded down
+        double d = std::floor(min_degree * std::pow(1.0 - dist(mt), -1.0 / (exponent - 1.0)));
+        unsigned long degree = d >= static_cast<double>(nodes - 1) ? nodes - 1 : static_cast<unsigned long>(d);
+        stubs.insert(stubs.end(), degree, u);
+    }
+    if (stubs.size() % 2 != 0) {
+        stubs.pop_back();
+    }
+    std::shuffle(stubs.begin(), stubs.end(), mt);
+
+    std::vector<edge> out(stubs.size() / 2);
+    for (size_t i = 0; i < out.size(); ++i) {
+        out[i] = edge(stubs[2 * i], stubs[2 * i + 1]);
+    }
+    return out;
+}
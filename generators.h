@@ -0,0 +1,27 @@
+//
+// Synthetic graph generators: R-MAT, Erdos-Renyi G(n, m) and a power law configuration model.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_GENERATORS_H
+#define TRIANGLECOUNTINGAPI_GENERATORS_H
+
+#include <vector>
+#include "edge_list_reader.h"
+
+namespace tcount {
+    // the R-MAT quadrant probabilities; d = 1 - a - b - c
+    struct rmat_parameters {
+        double a = 0.57;
+        double b = 0.19;
+        double c = 0.19;
+    };
+
+    std::vector<edge> generate_rmat(unsigned int scale, unsigned long edges, unsigned long long seed,
+                                    rmat_parameters parameters = rmat_parameters(), unsigned int threads = 0);
+    std::vector<edge> generate_erdos_renyi(unsigned long nodes, unsigned long edges, unsigned long long seed,
+                                           unsigned int threads = 0);
+    std::vector<edge> generate_power_law(unsigned long nodes, double exponent, unsigned long min_degree,
+                                         unsigned long long seed);
+}
+
+#endif //TRIANGLECOUNTINGAPI_GENERATORS_H
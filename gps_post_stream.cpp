@@ -7,6 +7,10 @@
 #include <chrono>
 #include <cfloat>
 #include <iostream>
+#include <tuple>
+#include <vector>
+#include "parallel.h"
+#include "stats.h"
 
 /**
  * The constructor for initializing a gps post stream object with a reservoir size
@@ -34,7 +38,11 @@ tcount::gps_post_stream::gps_post_stream(unsigned long res_size) {
 }
 
 tcount::gps_post_stream::~gps_post_stream() {
-    delete (mt, dist, g_res, weight_table, res);
+    delete mt;
+    delete dist;
+    delete g_res;
+    delete weight_table;
+    delete res;
 }
 
 /**
@@ -70,6 +78,7 @@ void tcount::gps_post_stream::add_edge(unsigned long u, unsigned long v) {
         auto k_star = res->top();
         this->z_star = std::max(this->z_star, std::get<2>(k_star));
         res->pop();
+        stats::add(stats::counter::reservoir_evictions, 1);
 
         //cleanup
 
@@ -87,54 +96,62 @@ void tcount::gps_post_stream::add_edge(unsigned long u, unsigned long v) {
 }
 
 /**
- * Computes a triangle estimation based on the edges sampled so far.
+ * Computes a triangle estimation based on the edges sampled so far. The reservoir is only read, so
+ * its edges are split between threads, each summing the estimates of the triangles it finds.
  *
+ * @param threads The number of threads, or 0 to use every hardware thread.
  * @return An estimation of the number of triangles of the graph stream seen so far.
  */
-unsigned long long tcount::gps_post_stream::compute_triangle_count() {
-    unsigned long long N_t = 0;
-
-    //iterate over the edges in the priority queue
-    while (!res->empty()) {
-        auto edge = res->top();
-        unsigned long v1, v2;
-        std::tie(v1, v2, std::ignore) = edge;
-
-        //calculate q value for edge
-        double q  = std::min(1.0, (*weight_table)[std::make_pair(v1, v2)] / this->z_star);
-
-        auto canditate = v1;
-        auto other = v2;
-        if((*g_res)[v2].size() < (*g_res)[v1].size()) {
-            canditate = v2;
-            other = v1;
+unsigned long long tcount::gps_post_stream::compute_triangle_count(unsigned int threads) const {
+    if (threads == 0) {
+        threads = default_threads();
+    }
+    stats::phase_timer timer(stats::phase::estimate);
+
+    //every edge in the reservoir is in the weight table both ways round; keep it once, with its q
+    std::vector<std::tuple<unsigned long, unsigned long, double>> edges;
+    edges.reserve(weight_table->size() / 2);
+    for (const auto &entry: *weight_table) {
+        if (entry.first.first < entry.first.second) {
+            edges.emplace_back(entry.first.first, entry.first.second, std::min(1.0, entry.second / this->z_star));
         }
+    }
 
-        //iterate over neighbours of v1.
-        for(auto v3: (*g_res)[canditate]) {
-            auto k1 = std::make_pair(canditate, v3);
-            //calculate q1 for new edge
-            double q1 = std::min(1.0, (*weight_table)[k1] / this->z_star);
-
-            //if a triangle can be formed from the wedge
-            if((*g_res)[other].find(v3) != (*g_res)[other].end()) {
-                auto k2 = std::make_pair(other, v3);
-                //calculate q2 from the 3rd edge
-                double q2 = std::min(1.0, (*weight_table)[k2] / this->z_star);
-
-                //calculate triangle estimation incrementation
-                double long N_k = 1.0 / (q * q1 * q2);
+    //the estimates are fractional, so they are summed in double and only rounded at the end
+    std::vector<double> sums(threads, 0.0);
+
+    parallel_for_dynamic(0, edges.size(), 1024, threads, [&](unsigned int t, size_t lo, size_t hi) {
+        for (size_t k = lo; k < hi; ++k) {
+            unsigned long v1, v2;
+            double q;
+            std::tie(v1, v2, q) = edges[k];
+
+            //iterate over the neighbours of the endpoint of smaller degree
+            const auto* canditate = &g_res->at(v1);
+            const auto* other = &g_res->at(v2);
+            unsigned long canditate_node = v1, other_node = v2;
+            if (other->size() < canditate->size()) {
+                std::swap(canditate, other);
+                std::swap(canditate_node, other_node);
+            }
 
-                N_t += N_k;
+            for (auto v3: *canditate) {
+                //if a triangle can be formed from the wedge
+                if (other->find(v3) != other->end()) {
+                    double q1 = std::min(1.0, weight_table->at(std::make_pair(canditate_node, v3)) / this->z_star);
+                    double q2 = std::min(1.0, weight_table->at(std::make_pair(other_node, v3)) / this->z_star);
+                    sums[t] += 1.0 / (q * q1 * q2);
+                }
             }
         }
+    });
 
-        res->pop();
+    //every triangle was found once from each of its edges
+    double N_t = 0.0;
+    for (double sum: sums) {
+        N_t += sum;
     }
-
-    N_t = N_t / 3;
-
-    return N_t;
+    return static_cast<unsigned long long>(N_t / 3);
 }
 
 /**
@@ -47,8 +47,10 @@ namespace tcount {
     public:
         explicit gps_post_stream(unsigned long res_size);
         ~gps_post_stream();
+        gps_post_stream(const gps_post_stream&) = delete;
+        gps_post_stream& operator=(const gps_post_stream&) = delete;
         void add_edge(unsigned long u, unsigned long v);
-        unsigned long long compute_triangle_count();
+        unsigned long long compute_triangle_count(unsigned int threads = 0) const;
     private:
         double weight(unsigned long u, unsigned long v);
     };
@@ -0,0 +1,449 @@
+//
+// Graph priority sampling over a fixed capacity reservoir. Every array is allocated up front, so
+// add_edge never touches the heap allocator.
+//
+
+#include "gps_reservoir.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include "parallel.h"
+#include "stats.h"
+
+const unsigned int tcount::gps_reservoir::NIL;
+
+namespace {
+    unsigned long long mix(unsigned long long x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        return x;
+    }
+
+    unsigned long long edge_hash(unsigned long a, unsigned long b) {
+        return mix(mix(a) ^ b);
+    }
+
+    size_t table_size(size_t entries) {
+        //at most half full
+        size_t size = 16;
+        while (size < entries * 2) {
+            size *= 2;
+        }
+        return size;
+    }
+}
+
+/**
+ * The constructor for a reservoir of res_size edges, seeded from the clock.
+ *
+ * @param res_size The desired size of the reservoir.
+ */
+tcount::gps_reservoir::gps_reservoir(unsigned long res_size)
+        : gps_reservoir(res_size, static_cast<unsigned long long>(
+                  std::chrono::system_clock::now().time_since_epoch().count())) {
+}
+
+/**
+ * @param res_size The desired size of the reservoir.
+ * @param seed The seed of the edge priorities, so a run can be reproduced.
+ */
+tcount::gps_reservoir::gps_reservoir(unsigned long res_size, unsigned long long seed)
+        : mt(seed), dist(std::nextafter(0.0, DBL_MAX), std::nextafter(1.0, DBL_MAX)) {
+    //two adjacency entries per slot must stay below NIL
+    if (res_size >= (1ul << 31)) {
+        throw std::invalid_argument("reservoir size must be below 2^31 edges");
+    }
+
+    this->capacity = static_cast<unsigned int>(res_size);
+    this->size_ = 0;
+    this->z_star = 0.0;
+    this->in_stream_triangles = 0.0;
+    this->in_stream_variance = 0.0;
+
+    source.resize(capacity);
+    target.resize(capacity);
+    weights.resize(capacity);
+    ranks.resize(capacity);
+    covariance.resize(capacity);
+    heap.resize(capacity);
+    heap_position.resize(capacity);
+    next.resize(capacity * 2ul);
+    previous.resize(capacity * 2ul);
+    edge_table.assign(table_size(capacity), NIL);
+    vertex_table.assign(table_size(capacity * 2ul), vertex_entry{0, NIL, 0});
+}
+
+/**
+ * Samples an edge e = (u, v). Self loops and edges already in the reservoir are ignored.
+ *
+ * @param u The node u of the edge e
+ * @param v The node v of the edge e
+ */
+void tcount::gps_reservoir::add_edge(unsigned long u, unsigned long v) {
+    if (u == v) {
+        return;
+    }
+    unsigned long a = std::min(u, v), b = std::max(u, v);
+    if (find_edge(a, b) != NIL) {
+        return;
+    }
+
+    double w_k = 9.0 * (double) close_triangles(a, b) + 1.0;
+    double r_k = w_k / dist(mt);
+
+    if (size_ < capacity) {
+        unsigned int slot = size_++;
+        heap[slot] = slot;
+        weights[slot] = w_k;
+        ranks[slot] = r_k;
+        covariance[slot] = 0.0;
+        insert(slot, a, b);
+        sift_up(slot);
+        return;
+    }
+
+    //the lowest rank of the reservoir plus the new edge leaves, and raises z*
+    stats::add(stats::counter::reservoir_evictions, 1);
+    if (capacity == 0 || r_k <= ranks[heap[0]]) {
+        z_star = std::max(z_star, r_k);
+        return;
+    }
+    unsigned int slot = heap[0];
+    z_star = std::max(z_star, ranks[slot]);
+    remove(slot);
+
+    //the new edge takes over the slot at the root of the heap
+    weights[slot] = w_k;
+    ranks[slot] = r_k;
+    covariance[slot] = 0.0;
+    insert(slot, a, b);
+    sift_down(0);
+}
+
+/**
+ * Computes a triangle estimation based on the edges sampled so far. The reservoir is left as it
+ * is, so this can be called again later in the stream.
+ *
+ * @return An estimation of the number of triangles of the graph stream seen so far.
+ */
+unsigned long long tcount::gps_reservoir::compute_triangle_count() const {
+    return static_cast<unsigned long long>(post_stream_estimate().triangles);
+}
+
+/**
+ * The in-stream estimate, kept up to date by add_edge. Every triangle is counted when its last edge
+ * arrives, weighted by the inclusion probabilities its other two edges had at that moment.
+ *
+ * @return The estimated number of triangles of the stream so far, and the variance of the estimate.
+ */
+tcount::gps_estimate tcount::gps_reservoir::in_stream_estimate() const {
+    return gps_estimate{in_stream_triangles, in_stream_variance};
+}
+
+/**
+ * The post-stream estimate: every triangle in the reservoir, weighted by the current inclusion
+ * probabilities of its three edges. Only reads the reservoir, so the edges can be split between
+ * threads.
+ *
+ * Triangles that share an edge k are correlated through it. With A(k) and B(k) the sums of the
+ * estimates and of their squares over the triangles through k, their covariances add
+ * (1 - q(k)) * (A(k)^2 - B(k)) to the variance.
+ *
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @return The estimated number of triangles of the stream so far, and the variance of the estimate.
+ */
+tcount::gps_estimate tcount::gps_reservoir::post_stream_estimate(unsigned int threads) const {
+    if (threads == 0) {
+        threads = default_threads();
+    }
+    stats::phase_timer timer(stats::phase::estimate);
+
+    // per thread sums of A(k), B(k) - A(k) and (1 - q(k)) * (A(k)^2 - B(k))
+    std::vector<double> sums(threads * 3, 0.0);
+
+    parallel_for_dynamic(0, size_, 1024, threads, [&](unsigned int t, size_t lo, size_t hi) {
+        double* sum = sums.data() + t * 3;
+        for (size_t slot = lo; slot < hi; ++slot) {
+            double q = inclusion_probability(static_cast<unsigned int>(slot));
+
+            unsigned int a_cell = find_vertex(source[slot]);
+            unsigned int b_cell = find_vertex(target[slot]);
+            unsigned long other = target[slot];
+            unsigned int head = vertex_table[a_cell].head;
+            if (vertex_table[b_cell].degree < vertex_table[a_cell].degree) {
+                other = source[slot];
+                head = vertex_table[b_cell].head;
+            }
+
+            double A_k = 0.0, B_k = 0.0;
+            for (unsigned int entry = head; entry != NIL; entry = next[entry]) {
+                unsigned long third = neighbour(entry);
+                unsigned int closing = find_edge(std::min(other, third), std::max(other, third));
+                if (closing != NIL) {
+                    double S = 1.0 / (q * inclusion_probability(entry / 2) * inclusion_probability(closing));
+                    A_k += S;
+                    B_k += S * S;
+                }
+            }
+
+            sum[0] += A_k;
+            sum[1] += B_k - A_k;
+            sum[2] += (1.0 - q) * (A_k * A_k - B_k);
+        }
+    });
+
+    gps_estimate estimate{0.0, 0.0};
+    for (unsigned int t = 0; t < threads; ++t) {
+        //every triangle was found once from each of its edges
+        estimate.triangles += sums[t * 3] / 3;
+        estimate.variance += sums[t * 3 + 1] / 3 + sums[t * 3 + 2];
+    }
+    return estimate;
+}
+
+/**
+ * @return Every edge in the reservoir with its current inclusion probability, for combining with
+ * other reservoirs through estimate_union.
+ */
+std::vector<tcount::sampled_edge> tcount::gps_reservoir::sample() const {
+    std::vector<sampled_edge> edges(size_);
+    for (unsigned int slot = 0; slot < size_; ++slot) {
+        edges[slot] = sampled_edge{source[slot], target[slot], inclusion_probability(slot)};
+    }
+    return edges;
+}
+
+/**
+ * @return The number of edges in the reservoir.
+ */
+unsigned long tcount::gps_reservoir::size() const {
+    return size_;
+}
+
+/**
+ * @return z*, the highest rank of any edge that has left the reservoir or was never let in.
+ */
+double tcount::gps_reservoir::threshold() const {
+    return z_star;
+}
+
+unsigned long tcount::gps_reservoir::neighbour(unsigned int entry) const {
+    return (entry & 1) ? source[entry / 2] : target[entry / 2];
+}
+
+/**
+ * @return The slot of the edge (a, b) with a < b, or NIL.
+ */
+unsigned int tcount::gps_reservoir::find_edge(unsigned long a, unsigned long b) const {
+    size_t mask = edge_table.size() - 1;
+    for (size_t cell = edge_hash(a, b) & mask; edge_table[cell] != NIL; cell = (cell + 1) & mask) {
+        unsigned int slot = edge_table[cell];
+        if (source[slot] == a && target[slot] == b) {
+            return slot;
+        }
+    }
+    return NIL;
+}
+
+/**
+ * @return The cell of the vertex in vertex_table, or NIL if it has no edges in the reservoir.
+ */
+unsigned int tcount::gps_reservoir::find_vertex(unsigned long id) const {
+    size_t mask = vertex_table.size() - 1;
+    for (size_t cell = mix(id) & mask; vertex_table[cell].head != NIL; cell = (cell + 1) & mask) {
+        if (vertex_table[cell].id == id) {
+            return static_cast<unsigned int>(cell);
+        }
+    }
+    return NIL;
+}
+
+/**
+ * Finds the triangles the arriving edge (a, b) closes in the reservoir and adds them to the
+ * in-stream estimate and its variance.
+ *
+ * @return The number of triangles the edge closes.
+ */
+unsigned long tcount::gps_reservoir::close_triangles(unsigned long a, unsigned long b) {
+    unsigned int a_cell = find_vertex(a);
+    unsigned int b_cell = find_vertex(b);
+    if (a_cell == NIL || b_cell == NIL) {
+        return 0;
+    }
+
+    //walk the list of the lower degree end
+    unsigned long other = b;
+    unsigned int head = vertex_table[a_cell].head;
+    if (vertex_table[b_cell].degree < vertex_table[a_cell].degree) {
+        other = a;
+        head = vertex_table[b_cell].head;
+    }
+
+    unsigned long completed_triangles = 0;
+    for (unsigned int entry = head; entry != NIL; entry = next[entry]) {
+        unsigned long third = neighbour(entry);
+        unsigned int k2 = find_edge(std::min(other, third), std::max(other, third));
+        if (k2 == NIL) {
+            continue;
+        }
+        completed_triangles += 1;
+
+        unsigned int k1 = entry / 2;
+        double q1 = inclusion_probability(k1);
+        double q2 = inclusion_probability(k2);
+        double S = 1.0 / (q1 * q2);
+
+        in_stream_triangles += S;
+        in_stream_variance += S * (S - 1.0)
+                              + 2.0 * S * ((1.0 / q1 - 1.0) * covariance[k1] + (1.0 / q2 - 1.0) * covariance[k2]);
+        covariance[k1] += 1.0 / q2;
+        covariance[k2] += 1.0 / q1;
+    }
+    return completed_triangles;
+}
+
+double tcount::gps_reservoir::inclusion_probability(unsigned int slot) const {
+    return z_star == 0.0 ? 1.0 : std::min(1.0, weights[slot] / z_star);
+}
+
+void tcount::gps_reservoir::insert(unsigned int slot, unsigned long a, unsigned long b) {
+    source[slot] = a;
+    target[slot] = b;
+
+    size_t mask = edge_table.size() - 1;
+    size_t cell = edge_hash(a, b) & mask;
+    while (edge_table[cell] != NIL) {
+        cell = (cell + 1) & mask;
+    }
+    edge_table[cell] = slot;
+
+    link(a, slot * 2);
+    link(b, slot * 2 + 1);
+}
+
+/**
+ * Takes the edge in slot out of the edge table and the adjacency lists. The slot stays in the heap,
+ * to be reused by the caller.
+ */
+void tcount::gps_reservoir::remove(unsigned int slot) {
+    size_t mask = edge_table.size() - 1;
+    size_t cell = edge_hash(source[slot], target[slot]) & mask;
+    while (edge_table[cell] != slot) {
+        cell = (cell + 1) & mask;
+    }
+    erase_edge(static_cast<unsigned int>(cell));
+
+    unlink(source[slot], slot * 2);
+    unlink(target[slot], slot * 2 + 1);
+}
+
+void tcount::gps_reservoir::link(unsigned long id, unsigned int entry) {
+    size_t mask = vertex_table.size() - 1;
+    size_t cell = mix(id) & mask;
+    while (vertex_table[cell].head != NIL && vertex_table[cell].id != id) {
+        cell = (cell + 1) & mask;
+    }
+
+    vertex_entry &vertex = vertex_table[cell];
+    vertex.id = id;
+    next[entry] = vertex.head;
+    previous[entry] = NIL;
+    if (vertex.head != NIL) {
+        previous[vertex.head] = entry;
+    }
+    vertex.head = entry;
+    vertex.degree += 1;
+}
+
+void tcount::gps_reservoir::unlink(unsigned long id, unsigned int entry) {
+    unsigned int cell = find_vertex(id);
+    vertex_entry &vertex = vertex_table[cell];
+
+    if (previous[entry] != NIL) {
+        next[previous[entry]] = next[entry];
+    }
+    else {
+        vertex.head = next[entry];
+    }
+    if (next[entry] != NIL) {
+        previous[next[entry]] = previous[entry];
+    }
+
+    vertex.degree -= 1;
+    if (vertex.degree == 0) {
+        erase_vertex(cell);
+    }
+}
+
+/**
+ * Empties a cell of edge_table, shifting back any later entry of the probe run that would
+ * otherwise no longer be found.
+ */
+void tcount::gps_reservoir::erase_edge(unsigned int cell) {
+    size_t mask = edge_table.size() - 1;
+    size_t hole = cell;
+    for (size_t i = (hole + 1) & mask; edge_table[i] != NIL; i = (i + 1) & mask) {
+        size_t home = edge_hash(source[edge_table[i]], target[edge_table[i]]) & mask;
+        //move i into the hole unless its home lies cyclically in (hole, i]
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            edge_table[hole] = edge_table[i];
+            hole = i;
+        }
+    }
+    edge_table[hole] = NIL;
+}
+
+void tcount::gps_reservoir::erase_vertex(unsigned int cell) {
+    size_t mask = vertex_table.size() - 1;
+    size_t hole = cell;
+    for (size_t i = (hole + 1) & mask; vertex_table[i].head != NIL; i = (i + 1) & mask) {
+        size_t home = mix(vertex_table[i].id) & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            vertex_table[hole] = vertex_table[i];
+            hole = i;
+        }
+    }
+    vertex_table[hole] = vertex_entry{0, NIL, 0};
+}
+
+void tcount::gps_reservoir::sift_up(unsigned int position) {
+    unsigned int slot = heap[position];
+    while (position > 0) {
+        unsigned int parent = (position - 1) / 2;
+        if (ranks[heap[parent]] <= ranks[slot]) {
+            break;
+        }
+        heap[position] = heap[parent];
+        heap_position[heap[position]] = position;
+        position = parent;
+    }
+    heap[position] = slot;
+    heap_position[slot] = position;
+}
+
+void tcount::gps_reservoir::sift_down(unsigned int position) {
+    unsigned int slot = heap[position];
+    while (true) {
+        unsigned long child = 2ul * position + 1;
+        if (child >= size_) {
+            break;
+        }
+        if (child + 1 < size_ && ranks[heap[child + 1]] < ranks[heap[child]]) {
+            child += 1;
+        }
+        if (ranks[slot] <= ranks[heap[child]]) {
+            break;
+        }
+        heap[position] = heap[child];
+        heap_position[heap[position]] = position;
+        position = static_cast<unsigned int>(child);
+    }
+    heap[position] = slot;
+    heap_position[slot] = position;
+}
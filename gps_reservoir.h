@@ -0,0 +1,94 @@
+//
+// Graph priority sampling over a fixed capacity reservoir. Every array is allocated up front, so
+// add_edge never touches the heap allocator.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_GPS_RESERVOIR_H
+#define TRIANGLECOUNTINGAPI_GPS_RESERVOIR_H
+
+#include <random>
+#include <vector>
+
+namespace tcount {
+    struct gps_estimate {
+        double triangles;
+        double variance;
+    };
+
+    // an edge of a GPS sample with its inclusion probability, u < v
+    struct sampled_edge {
+        unsigned long u;
+        unsigned long v;
+        double q;
+    };
+
+    class gps_reservoir {
+        struct vertex_entry {
+            unsigned long id;
+            // first adjacency entry of the vertex, NIL for an empty table cell
+            unsigned int head;
+            unsigned int degree;
+        };
+
+        std::mt19937_64 mt;
+        std::uniform_real_distribution<double> dist;
+
+        // slot -> edge, with source < target
+        std::vector<unsigned long> source;
+        std::vector<unsigned long> target;
+        std::vector<double> weights;
+        std::vector<double> ranks;
+        // in-stream: the sum of 1 / q(partner) over the triangles the edge has helped close
+        std::vector<double> covariance;
+
+        // min-heap of slots by rank, and slot -> position in the heap
+        std::vector<unsigned int> heap;
+        std::vector<unsigned int> heap_position;
+
+        // adjacency entry 2 * slot is in the list of source[slot], 2 * slot + 1 in the list of target[slot]
+        std::vector<unsigned int> next;
+        std::vector<unsigned int> previous;
+
+        // open addressing, linear probing, backward shift deletion
+        std::vector<unsigned int> edge_table;
+        std::vector<vertex_entry> vertex_table;
+
+        unsigned int capacity;
+        unsigned int size_;
+        double z_star;
+
+        // in-stream estimates, updated as the edges arrive
+        double in_stream_triangles;
+        double in_stream_variance;
+
+    public:
+        static const unsigned int NIL = ~0u;
+
+        explicit gps_reservoir(unsigned long res_size);
+        gps_reservoir(unsigned long res_size, unsigned long long seed);
+        void add_edge(unsigned long u, unsigned long v);
+        unsigned long long compute_triangle_count() const;
+        gps_estimate in_stream_estimate() const;
+        gps_estimate post_stream_estimate(unsigned int threads = 1) const;
+        std::vector<sampled_edge> sample() const;
+        unsigned long size() const;
+        double threshold() const;
+
+    private:
+        unsigned long neighbour(unsigned int entry) const;
+        unsigned int find_edge(unsigned long a, unsigned long b) const;
+        unsigned int find_vertex(unsigned long id) const;
+        unsigned long close_triangles(unsigned long a, unsigned long b);
+        double inclusion_probability(unsigned int slot) const;
+        void insert(unsigned int slot, unsigned long a, unsigned long b);
+        void remove(unsigned int slot);
+        void link(unsigned long id, unsigned int entry);
+        void unlink(unsigned long id, unsigned int entry);
+        void erase_edge(unsigned int cell);
+        void erase_vertex(unsigned int cell);
+        void sift_up(unsigned int position);
+        void sift_down(unsigned int position);
+    };
+}
+
+#endif //TRIANGLECOUNTINGAPI_GPS_RESERVOIR_H
@@ -0,0 +1,440 @@
+//
+// Graph priority sampling spread over several reservoirs, each fed its own hash partition of the
+// edges on its own thread, and the combination of GPS samples into one estimate.
+//
+
+#include "gps_sharded.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include "csr_builder.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include "stats.h"
+
+namespace {
+    // the bytes of an edge in a sample file: u, v and q
+    const unsigned long long SAMPLE_RECORD_BYTES = 2 * sizeof(unsigned long long) + sizeof(double);
+
+    // the union of GPS samples as a symmetric graph over relabelled vertices
+    struct union_graph {
+        // relabelled edges, u < v, with the probability the union includes each
+        std::vector<tcount::edge> edges;
+        std::vector<double> q;
+        // new id -> original id
+        std::vector<unsigned long> labels;
+        // both directions of every edge with its probability, each list sorted by neighbour
+        std::vector<unsigned long> node_array;
+        std::vector<std::pair<unsigned long, double>> adjacency;
+    };
+
+    // joins samples of disjoint edge streams and relabels their vertices 0 to n - 1; an edge found
+    // in more than one sample means the streams overlapped, and is rejected
+    union_graph build_union(std::vector<tcount::sampled_edge> sample, unsigned int threads) {
+        for (auto &e: sample) {
+            if (e.v < e.u) {
+                std::swap(e.u, e.v);
+            }
+        }
+        std::sort(sample.begin(), sample.end(), [](const tcount::sampled_edge &x, const tcount::sampled_edge &y) {
+            return x.u < y.u || (x.u == y.u && x.v < y.v);
+        });
+
+        //drop self loops and refuse repeated edges
+        size_t size = 0;
+        for (size_t i = 0; i < sample.size(); ++i) {
+            if (sample[i].u == sample[i].v) {
+                continue;
+            }
+            if (size > 0 && sample[size - 1].u == sample[i].u && sample[size - 1].v == sample[i].v) {
+                throw std::invalid_argument("edge (" + std::to_string(sample[i].u) + ", " +
+                                            std::to_string(sample[i].v) + ") is in more than one sample; "
+                                            "only samples of disjoint edge streams can be combined");
+            }
+            sample[size++] = sample[i];
+        }
+        sample.resize(size);
+
+        union_graph graph;
+        std::vector<tcount::edge> &edges = graph.edges;
+        edges.resize(size);
+        graph.q.resize(size);
+        for (size_t i = 0; i < size; ++i) {
+            edges[i] = tcount::edge(sample[i].u, sample[i].v);
+            graph.q[i] = sample[i].q;
+        }
+        graph.labels = tcount::relabel_edges(edges, threads);
+        unsigned long n = graph.labels.size();
+
+        std::vector<unsigned long> &node_array = graph.node_array;
+        node_array.assign(n + 1, 0);
+        for (const auto &e: edges) {
+            node_array[e.first + 1] += 1;
+            node_array[e.second + 1] += 1;
+        }
+        for (unsigned long u = 0; u < n; ++u) {
+            node_array[u + 1] += node_array[u];
+        }
+        std::vector<std::pair<unsigned long, double>> &adjacency = graph.adjacency;
+        adjacency.resize(size * 2);
+        std::vector<unsigned long> position(node_array.begin(), node_array.end() - 1);
+        for (size_t i = 0; i < size; ++i) {
+            adjacency[position[edges[i].first]++] = std::make_pair(edges[i].second, sample[i].q);
+            adjacency[position[edges[i].second]++] = std::make_pair(edges[i].first, sample[i].q);
+        }
+        tcount::parallel_for_dynamic(0, n, 1024, threads, [&](unsigned int, size_t lo, size_t hi) {
+            for (size_t u = lo; u < hi; ++u) {
+                std::sort(adjacency.begin() + node_array[u], adjacency.begin() + node_array[u + 1]);
+            }
+        });
+
+        return graph;
+    }
+}
+
+/**
+ * Splits a reservoir of res_size edges between number_of_shards reservoirs, so the sharded sample
+ * takes as much memory as a single one would.
+ *
+ * @param res_size The total size of the reservoirs.
+ * @param number_of_shards The number of reservoirs, and of threads feeding them.
+ * @param seed The seed every shard's own seed is drawn from.
+ */
+tcount::gps_sharded::gps_sharded(unsigned long res_size, unsigned int number_of_shards, unsigned long long seed) {
+    number_of_shards = std::max(number_of_shards, 1u);
+
+    std::mt19937_64 seeds(seed);
+    shards.reserve(number_of_shards);
+    for (unsigned int i = 0; i < number_of_shards; ++i) {
+        shards.emplace_back(res_size / number_of_shards + (i < res_size % number_of_shards ? 1 : 0), seeds());
+    }
+}
+
+/**
+ * Samples an edge e = (u, v) into the reservoir of its partition, on the calling thread.
+ *
+ * @param u The node u of the edge e
+ * @param v The node v of the edge e
+ */
+void tcount::gps_sharded::add_edge(unsigned long u, unsigned long v) {
+    shards[shard_of(u, v)].add_edge(u, v);
+}
+
+/**
+ * Samples a batch of edges, with one thread per shard. The batch is partitioned once: every thread
+ * hashes a slice of it and counts the edges of each shard, and then copies its slice into the range
+ * of every shard, after those of the slices before it. Each shard then reads only its own range,
+ * so each reservoir still sees its edges in stream order.
+ *
+ * @param edges The edges, in stream order.
+ * @param count The number of edges.
+ */
+void tcount::gps_sharded::add_edges(const edge* edges, size_t count) {
+    stats::phase_timer timer(stats::phase::estimate);
+    unsigned int parts = number_of_shards();
+    if (parts == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            shards[0].add_edge(edges[i].first, edges[i].second);
+        }
+        return;
+    }
+
+    owners.resize(count);
+    partitioned.resize(count);
+    //offsets[t * parts + s] is where slice t starts writing the edges of shard s
+    std::vector<size_t> offsets(parts * parts, 0);
+    auto slice = [&](unsigned int t) {
+        return count / parts * t + std::min<size_t>(t, count % parts);
+    };
+
+    parallel_run(parts, [&](unsigned int t) {
+        size_t* counts = offsets.data() + t * parts;
+        for (size_t i = slice(t); i < slice(t + 1); ++i) {
+            owners[i] = shard_of(edges[i].first, edges[i].second);
+            counts[owners[i]] += 1;
+        }
+    });
+
+    std::vector<size_t> starts(parts + 1, 0);
+    size_t position = 0;
+    for (unsigned int s = 0; s < parts; ++s) {
+        starts[s] = position;
+        for (unsigned int t = 0; t < parts; ++t) {
+            size_t slice_count = offsets[t * parts + s];
+            offsets[t * parts + s] = position;
+            position += slice_count;
+        }
+    }
+    starts[parts] = position;
+
+    parallel_run(parts, [&](unsigned int t) {
+        size_t* next = offsets.data() + t * parts;
+        for (size_t i = slice(t); i < slice(t + 1); ++i) {
+            partitioned[next[owners[i]]++] = edges[i];
+        }
+    });
+
+    parallel_run(parts, [&](unsigned int s) {
+        for (size_t i = starts[s]; i < starts[s + 1]; ++i) {
+            shards[s].add_edge(partitioned[i].first, partitioned[i].second);
+        }
+    });
+}
+
+unsigned int tcount::gps_sharded::number_of_shards() const {
+    return static_cast<unsigned int>(shards.size());
+}
+
+const tcount::gps_reservoir& tcount::gps_sharded::shard(unsigned int i) const {
+    return shards[i];
+}
+
+/**
+ * @return The edges of every shard with their inclusion probabilities.
+ */
+std::vector<tcount::sampled_edge> tcount::gps_sharded::sample() const {
+    std::vector<sampled_edge> edges;
+    for (const auto &reservoir: shards) {
+        std::vector<sampled_edge> part = reservoir.sample();
+        edges.insert(edges.end(), part.begin(), part.end());
+    }
+    return edges;
+}
+
+/**
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @return The triangle estimate of the union of the shards, see estimate_union.
+ */
+tcount::gps_estimate tcount::gps_sharded::estimate(unsigned int threads) const {
+    return estimate_union(sample(), threads);
+}
+
+unsigned int tcount::gps_sharded::shard_of(unsigned long u, unsigned long v) const {
+    unsigned long long x = std::min(u, v) * 0x9e3779b97f4a7c15ull ^ std::max(u, v);
+    x ^= x >> 31;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 29;
+    return static_cast<unsigned int>(x % shards.size());
+}
+
+/**
+ * The post-stream GPS estimate over the union of several samples: the shards of a gps_sharded, or
+ * reservoirs filled from disjoint parts of an edge stream, such as a shard_of style partition or
+ * different days. Every triangle whose three edges are in the union counts 1 / (q1 q2 q3),
+ * wherever its edges were sampled, and the variance is estimated as in
+ * gps_reservoir::post_stream_estimate.
+ *
+ * Each q is only the inclusion probability of an edge within its own stream, so samples of
+ * overlapping streams cannot be combined this way: an edge kept by one of them would be weighted
+ * as if no other sample could have taken it. An edge found in more than one sample is rejected.
+ *
+ * @param sample The edges of every sample with their inclusion probabilities.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @return The estimated number of triangles, and the variance of the estimate.
+ * @throws std::invalid_argument If an edge is in more than one sample.
+ */
+tcount::gps_estimate tcount::estimate_union(std::vector<sampled_edge> sample, unsigned int threads) {
+    if (threads == 0) {
+        threads = default_threads();
+    }
+    stats::phase_timer timer(stats::phase::estimate);
+
+    union_graph graph = build_union(std::move(sample), threads);
+    const auto &node_array = graph.node_array;
+    const auto &adjacency = graph.adjacency;
+    const auto &edges = graph.edges;
+    size_t size = edges.size();
+
+    // per thread sums of A(k), B(k) - A(k) and (1 - q(k)) * (A(k)^2 - B(k))
+    std::vector<double> sums(threads * 3, 0.0);
+
+    parallel_for_dynamic(0, size, 1024, threads, [&](unsigned int t, size_t lo, size_t hi) {
+        double* sum = sums.data() + t * 3;
+        for (size_t k = lo; k < hi; ++k) {
+            double q = graph.q[k];
+            auto a = adjacency.begin() + node_array[edges[k].first];
+            auto a_end = adjacency.begin() + node_array[edges[k].first + 1];
+            auto b = adjacency.begin() + node_array[edges[k].second];
+            auto b_end = adjacency.begin() + node_array[edges[k].second + 1];
+
+            double A_k = 0.0, B_k = 0.0;
+            while (a != a_end && b != b_end) {
+                if (a->first < b->first) {
+                    ++a;
+                }
+                else if (b->first < a->first) {
+                    ++b;
+                }
+                else {
+                    double S = 1.0 / (q * a->second * b->second);
+                    A_k += S;
+                    B_k += S * S;
+                    ++a;
+                    ++b;
+                }
+            }
+
+            sum[0] += A_k;
+            sum[1] += B_k - A_k;
+            sum[2] += (1.0 - q) * (A_k * A_k - B_k);
+        }
+    });
+
+    gps_estimate estimate{0.0, 0.0};
+    for (unsigned int t = 0; t < threads; ++t) {
+        //every triangle was found once from each of its edges
+        estimate.triangles += sums[t * 3] / 3;
+        estimate.variance += sums[t * 3 + 1] / 3 + sums[t * 3 + 2];
+    }
+    return estimate;
+}
+
+/**
+ * Per vertex post-stream estimates over the union of GPS samples of disjoint edge streams, as in
+ * estimate_union. Every triangle whose three edges are in the union adds 1 / (q1 q2 q3) to each of
+ * its vertices: found from each of its edges, it is credited to the vertex opposite, so every
+ * vertex gets it once. Each estimate is unbiased, as the global one is.
+ *
+ * The sample only holds some of the edges of a vertex, so the degrees are left at 0 for the caller
+ * to fill in if it knows them.
+ *
+ * @param sample The edges of every sample with their inclusion probabilities.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @return The original id and estimated triangle count of every vertex with a sampled edge.
+ * @throws std::invalid_argument If an edge is in more than one sample.
+ */
+tcount::vertex_counts tcount::estimate_vertex_triangles(std::vector<sampled_edge> sample, unsigned int threads) {
+    if (threads == 0) {
+        threads = default_threads();
+    }
+    stats::phase_timer timer(stats::phase::estimate);
+
+    union_graph graph = build_union(std::move(sample), threads);
+    const auto &node_array = graph.node_array;
+    const auto &adjacency = graph.adjacency;
+    const auto &edges = graph.edges;
+    unsigned long n = graph.labels.size();
+
+    std::vector<std::vector<double>> local_estimates(threads);
+
+    parallel_for_dynamic(0, edges.size(), 1024, threads, [&](unsigned int t, size_t lo, size_t hi) {
+        std::vector<double> &estimates = local_estimates[t];
+        if (estimates.empty()) {
+            estimates.assign(n, 0.0);
+        }
+        for (size_t k = lo; k < hi; ++k) {
+            double q = graph.q[k];
+            auto a = adjacency.begin() + node_array[edges[k].first];
+            auto a_end = adjacency.begin() + node_array[edges[k].first + 1];
+            auto b = adjacency.begin() + node_array[edges[k].second];
+            auto b_end = adjacency.begin() + node_array[edges[k].second + 1];
+
+            while (a != a_end && b != b_end) {
+                if (a->first < b->first) {
+                    ++a;
+                }
+                else if (b->first < a->first) {
+                    ++b;
+                }
+                else {
+                    estimates[a->first] += 1.0 / (q * a->second * b->second);
+                    ++a;
+                    ++b;
+                }
+            }
+        }
+    });
+
+    vertex_counts counts;
+    counts.ids = std::move(graph.labels);
+    counts.degrees.assign(n, 0);
+    counts.triangles.assign(n, 0.0);
+    for (const auto &estimates: local_estimates) {
+        for (unsigned long u = 0; u < estimates.size(); ++u) {
+            counts.triangles[u] += estimates[u];
+        }
+    }
+    return counts;
+}
+
+/**
+ * Writes a GPS sample so that it can be combined with samples taken elsewhere.
+ *
+ * @param filename The path of the file to write.
+ * @param sample The edges with their inclusion probabilities.
+ */
+void tcount::save_sample(const char* filename, const std::vector<sampled_edge> &sample) {
+    FILE *file = fopen(filename, "wb");
+    if (file == nullptr) {
+        throw std::runtime_error(std::string("cannot open ") + filename + " for writing");
+    }
+
+    sample_file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SAMPLE_MAGIC, sizeof(SAMPLE_MAGIC));
+    header.version = SAMPLE_VERSION;
+    header.edges = sample.size();
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (size_t i = 0; ok && i < sample.size(); ++i) {
+        unsigned long long ends[2] = {sample[i].u, sample[i].v};
+        ok = fwrite(ends, sizeof(ends), 1, file) == 1 && fwrite(&sample[i].q, sizeof(double), 1, file) == 1;
+    }
+
+    if (fclose(file) != 0 || !ok) {
+        throw std::runtime_error(std::string("failed writing ") + filename);
+    }
+}
+
+/**
+ * Reads a GPS sample written by save_sample. The file is mapped and the edge count in its header
+ * checked against its size before anything is allocated.
+ *
+ * @param filename The path of the sample file.
+ * @return The edges with their inclusion probabilities.
+ * @throws std::runtime_error If the file is not a sample file, is truncated or corrupt, or holds
+ *                            an edge with a probability outside (0, 1].
+ */
+std::vector<tcount::sampled_edge> tcount::load_sample(const char* filename) {
+    mapped_file file(filename);
+
+    sample_file_header header;
+    if (file.size() < sizeof(header)) {
+        throw std::runtime_error(std::string(filename) + " is not a GPS sample file");
+    }
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, SAMPLE_MAGIC, sizeof(SAMPLE_MAGIC)) != 0) {
+        throw std::runtime_error(std::string(filename) + " is not a GPS sample file");
+    }
+    if (header.version != SAMPLE_VERSION) {
+        throw std::runtime_error(std::string(filename) + " has unsupported sample version " +
+                                 std::to_string(header.version));
+    }
+
+    //the header must account for exactly the records that follow it
+    std::string corrupt = std::string(filename) + " is truncated or corrupt";
+    unsigned long long records = (file.size() - sizeof(header)) / SAMPLE_RECORD_BYTES;
+    if (header.edges != records || sizeof(header) + records * SAMPLE_RECORD_BYTES != file.size()) {
+        throw std::runtime_error(corrupt);
+    }
+
+    std::vector<sampled_edge> sample(header.edges);
+    const char* record = file.data() + sizeof(header);
+    for (size_t i = 0; i < sample.size(); ++i, record += SAMPLE_RECORD_BYTES) {
+        unsigned long long ends[2];
+        memcpy(ends, record, sizeof(ends));
+        memcpy(&sample[i].q, record + sizeof(ends), sizeof(double));
+        sample[i].u = ends[0];
+        sample[i].v = ends[1];
+        //a probability of 0 would weigh its triangles infinitely, and one above 1 negatively
+        if (!(sample[i].q > 0.0 && sample[i].q <= 1.0)) {
+            throw std::runtime_error(std::string(filename) + " holds an edge with inclusion probability " +
+                                     std::to_string(sample[i].q) + ", outside (0, 1]");
+        }
+    }
+    return sample;
+}
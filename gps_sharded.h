@@ -0,0 +1,56 @@
+//
+// Graph priority sampling spread over several reservoirs, each fed its own hash partition of the
+// edges on its own thread, and the combination of GPS samples into one estimate.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_GPS_SHARDED_H
+#define TRIANGLECOUNTINGAPI_GPS_SHARDED_H
+
+#include <vector>
+#include "edge_list_reader.h"
+#include "gps_reservoir.h"
+#include "vertex_triangles.h"
+
+namespace tcount {
+    /*
+     * Layout of a GPS sample file, all integers little endian:
+     *
+     *   header         24 bytes, see sample_file_header
+     *   edges          edges x (uint64 u, uint64 v, float64 q)
+     */
+    const char SAMPLE_MAGIC[8] = {'T', 'G', 'P', 'S', 'S', 'M', 'P', 'L'};
+    const unsigned int SAMPLE_VERSION = 1;
+
+    struct sample_file_header {
+        char magic[8];
+        unsigned int version;
+        unsigned int reserved;
+        unsigned long long edges;
+    };
+
+    class gps_sharded {
+        std::vector<gps_reservoir> shards;
+        // the shard of every edge of a batch, and the batch regrouped by shard, kept between batches
+        std::vector<unsigned int> owners;
+        std::vector<edge> partitioned;
+
+    public:
+        gps_sharded(unsigned long res_size, unsigned int number_of_shards, unsigned long long seed);
+        void add_edge(unsigned long u, unsigned long v);
+        void add_edges(const edge* edges, size_t count);
+        unsigned int number_of_shards() const;
+        const gps_reservoir& shard(unsigned int i) const;
+        std::vector<sampled_edge> sample() const;
+        gps_estimate estimate(unsigned int threads = 0) const;
+
+    private:
+        unsigned int shard_of(unsigned long u, unsigned long v) const;
+    };
+
+    gps_estimate estimate_union(std::vector<sampled_edge> sample, unsigned int threads = 0);
+    vertex_counts estimate_vertex_triangles(std::vector<sampled_edge> sample, unsigned int threads = 0);
+    void save_sample(const char* filename, const std::vector<sampled_edge> &sample);
+    std::vector<sampled_edge> load_sample(const char* filename);
+}
+
+#endif //TRIANGLECOUNTINGAPI_GPS_SHARDED_H
@@ -0,0 +1,182 @@
+//
+// Dense neighbour bitmaps for the highest degree nodes of a CSR, so that intersections against
+// a hub become bit tests or AND+popcount instead of walking its long neighbour list.
+//
+
+#include "hub_index.h"
+
+#include <algorithm>
+#include "intersection.h"
+#include "parallel.h"
+#include "stats.h"
+
+const unsigned int tcount::hub_index::NOT_A_HUB;
+const unsigned long tcount::hub_index::MIN_AUTO_DEGREE;
+
+tcount::hub_index::hub_index() {
+    this->words = 0;
+    this->threshold_ = 0;
+}
+
+/**
+ * Builds a bitmap of n bits for every node with at least threshold neighbours. The neighbour ids
+ * may be 32 or 64 bit, as in a compact or a full width graph.
+ *
+ * @param node_array The n + 1 offsets of the CSR.
+ * @param edge_array The neighbour lists of the CSR.
+ * @param n The number of nodes.
+ * @param threshold The degree at which a node becomes a hub.
+ * @param threads The number of threads to fill the bitmaps with, or 0 to use every hardware thread.
+ */
+template<typename Vertex>
+tcount::hub_index::hub_index(const unsigned long* node_array, const Vertex* edge_array, unsigned long n,
+                             unsigned long threshold, unsigned int threads) {
+    stats::phase_timer timer(stats::phase::preprocess);
+    this->words = (n + 63) / 64;
+    this->threshold_ = std::max(threshold, 1ul);
+
+    std::vector<unsigned long> hubs;
+    for (unsigned long u = 0; u < n; ++u) {
+        if (node_array[u + 1] - node_array[u] >= threshold_) {
+            hubs.push_back(u);
+        }
+    }
+    if (hubs.empty()) {
+        return;
+    }
+
+    this->slot.assign(n, NOT_A_HUB);
+    this->bits.assign(hubs.size() * words, 0);
+    for (unsigned long i = 0; i < hubs.size(); ++i) {
+        slot[hubs[i]] = static_cast<unsigned int>(i);
+    }
+
+    parallel_for_dynamic(0, hubs.size(), 1, threads == 0 ? default_threads() : threads,
+                         [&](unsigned int, size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) {
+            unsigned long long* row = bits.data() + i * words;
+            for (unsigned long e = node_array[hubs[i]]; e < node_array[hubs[i] + 1]; ++e) {
+                row[edge_array[e] >> 6] |= 1ull << (edge_array[e] & 63);
+            }
+        }
+    });
+}
+
+/**
+ * Picks the hub threshold automatically from the degree distribution: the highest degree nodes
+ * are made hubs, most connected first, for as long as their bitmaps fit in memory_budget. Nodes
+ * below MIN_AUTO_DEGREE are never worth a bitmap.
+ *
+ * @param node_array The n + 1 offsets of the CSR.
+ * @param n The number of nodes.
+ * @param memory_budget The most memory the bitmaps may take, in bytes.
+ * @return A threshold for the hub_index constructor.
+ */
+unsigned long tcount::hub_index::choose_threshold(const unsigned long* node_array, unsigned long n, size_t memory_budget) {
+    size_t row_bytes = std::max<size_t>(1, (n + 63) / 64 * sizeof(unsigned long long));
+    size_t max_hubs = memory_budget / row_bytes;
+
+    std::vector<unsigned long> degrees;
+    unsigned long max_degree = 0;
+    for (unsigned long u = 0; u < n; ++u) {
+        unsigned long d = node_array[u + 1] - node_array[u];
+        max_degree = std::max(max_degree, d);
+        if (d >= MIN_AUTO_DEGREE) {
+            degrees.push_back(d);
+        }
+    }
+
+    if (max_hubs == 0 || degrees.empty()) {
+        return max_degree + 1;
+    }
+    if (degrees.size() <= max_hubs) {
+        return MIN_AUTO_DEGREE;
+    }
+
+    std::nth_element(degrees.begin(), degrees.begin() + (max_hubs - 1), degrees.end(), std::greater<unsigned long>());
+    unsigned long threshold = degrees[max_hubs - 1];
+    auto at_threshold = static_cast<size_t>(std::count_if(degrees.begin(), degrees.end(),
+                                                          [threshold](unsigned long d) { return d >= threshold; }));
+
+    //ties at the cut off would push the index over budget
+    return at_threshold > max_hubs ? threshold + 1 : threshold;
+}
+
+bool tcount::hub_index::empty() const {
+    return slot.empty();
+}
+
+bool tcount::hub_index::is_hub(unsigned long u) const {
+    return !slot.empty() && slot[u] != NOT_A_HUB;
+}
+
+/**
+ * @return True if v is a neighbour of the hub.
+ */
+bool tcount::hub_index::contains(unsigned long hub, unsigned long v) const {
+    const unsigned long long* row = bits.data() + slot[hub] * words;
+    return (row[v >> 6] >> (v & 63)) & 1;
+}
+
+/**
+ * Counts |a intersect b| where a and b belong to nodes u and v, using the bitmap of whichever is a
+ * hub. b must be the whole neighbour list of v. a may be a part of the neighbour list of u, as long
+ * as it holds every neighbour of u that b contains; for example the forward algorithm passes the
+ * part of N+(u) after v, since nothing before v can be in N+(v).
+ *
+ * @return |a intersect b|
+ */
+template<typename Vertex>
+unsigned long tcount::hub_index::intersection_count(unsigned long u, const Vertex* a, size_t a_size,
+                                                    unsigned long v, const Vertex* b, size_t b_size) const {
+    unsigned int u_slot = slot.empty() ? NOT_A_HUB : slot[u];
+    unsigned int v_slot = slot.empty() ? NOT_A_HUB : slot[v];
+
+    if (u_slot == NOT_A_HUB && v_slot == NOT_A_HUB) {
+        return tcount::intersection_count(a, a_size, b, b_size);
+    }
+
+    if (u_slot != NOT_A_HUB && v_slot != NOT_A_HUB && words <= std::min(a_size, b_size)) {
+        return popcount_and(bits.data() + u_slot * words, bits.data() + v_slot * words, words);
+    }
+
+    //walk the shorter list whose partner has a bitmap
+    unsigned long count = 0;
+    if (v_slot != NOT_A_HUB && (u_slot == NOT_A_HUB || a_size <= b_size)) {
+        const unsigned long long* row = bits.data() + v_slot * words;
+        for (size_t i = 0; i < a_size; ++i) {
+            count += (row[a[i] >> 6] >> (a[i] & 63)) & 1;
+        }
+    }
+    else {
+        const unsigned long long* row = bits.data() + u_slot * words;
+        for (size_t i = 0; i < b_size; ++i) {
+            count += (row[b[i] >> 6] >> (b[i] & 63)) & 1;
+        }
+    }
+    return count;
+}
+
+unsigned long tcount::hub_index::number_of_hubs() const {
+    return bits.size() / std::max<size_t>(words, 1);
+}
+
+unsigned long tcount::hub_index::threshold() const {
+    return threshold_;
+}
+
+/**
+ * @return The memory taken by the bitmaps and the node to bitmap table, in bytes.
+ */
+size_t tcount::hub_index::memory_bytes() const {
+    return bits.size() * sizeof(unsigned long long) + slot.size() * sizeof(unsigned int);
+}
+
+template tcount::hub_index::hub_index(const unsigned long* node_array, const unsigned int* edge_array, unsigned long n,
+                                      unsigned long threshold, unsigned int threads);
+template tcount::hub_index::hub_index(const unsigned long* node_array, const unsigned long* edge_array, unsigned long n,
+                                      unsigned long threshold, unsigned int threads);
+template unsigned long tcount::hub_index::intersection_count(unsigned long u, const unsigned int* a, size_t a_size,
+                                                             unsigned long v, const unsigned int* b, size_t b_size) const;
+template unsigned long tcount::hub_index::intersection_count(unsigned long u, const unsigned long* a, size_t a_size,
+                                                             unsigned long v, const unsigned long* b, size_t b_size) const;
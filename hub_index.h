@@ -0,0 +1,42 @@
+//
+// Dense neighbour bitmaps for the highest degree nodes of a CSR, so that intersections against
+// a hub become bit tests or AND+popcount instead of walking its long neighbour list.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_HUB_INDEX_H
+#define TRIANGLECOUNTINGAPI_HUB_INDEX_H
+
+#include <cstddef>
+#include <vector>
+
+namespace tcount {
+    class hub_index {
+        // node -> row of its bitmap in bits, or NOT_A_HUB
+        std::vector<unsigned int> slot;
+        std::vector<unsigned long long> bits;
+        size_t words;
+        unsigned long threshold_;
+
+    public:
+        static const unsigned int NOT_A_HUB = ~0u;
+        static const unsigned long MIN_AUTO_DEGREE = 1024;
+
+        hub_index();
+        template<typename Vertex>
+        hub_index(const unsigned long* node_array, const Vertex* edge_array, unsigned long n,
+                  unsigned long threshold, unsigned int threads = 0);
+        static unsigned long choose_threshold(const unsigned long* node_array, unsigned long n, size_t memory_budget);
+
+        bool empty() const;
+        bool is_hub(unsigned long u) const;
+        bool contains(unsigned long hub, unsigned long v) const;
+        template<typename Vertex>
+        unsigned long intersection_count(unsigned long u, const Vertex* a, size_t a_size,
+                                         unsigned long v, const Vertex* b, size_t b_size) const;
+        unsigned long number_of_hubs() const;
+        unsigned long threshold() const;
+        size_t memory_bytes() const;
+    };
+}
+
+#endif //TRIANGLECOUNTINGAPI_HUB_INDEX_H
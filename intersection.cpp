@@ -0,0 +1,432 @@
+//
+// Kernels that count the size of the intersection of two sorted, duplicate free neighbour lists.
+// The fastest kernel the CPU supports is picked at runtime.
+//
+// The SIMD kernels compare a block of W elements of a against a block of W elements of b by
+// rotating the b block W times, then advance whichever block has the smaller maximum (or both if
+// they are equal). Since neither list holds duplicates an element of a matches at most one element
+// of b, so the number of matching lanes is the number of common elements in the block pair.
+// Whatever is left when either list has fewer than W elements remaining is merged by the scalar loop.
+//
+
+#include "intersection.h"
+
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TCOUNT_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+    //above this size ratio a binary search per element of the shorter list beats walking the longer one
+    const size_t GALLOPING_RATIO = 32;
+
+    tcount::simd_level active_level = tcount::detected_simd_level();
+
+    template<typename T>
+    unsigned long merge_count(const T* a, size_t a_size, const T* b, size_t b_size) {
+        unsigned long count = 0;
+        size_t i = 0, j = 0;
+        while (i < a_size && j < b_size) {
+            if (a[i] == b[j]) {
+                count += 1;
+                ++i;
+                ++j;
+            }
+            else if (a[i] < b[j]) {
+                ++i;
+            }
+            else {
+                ++j;
+            }
+        }
+        return count;
+    }
+
+    template<typename T>
+    unsigned long galloping_count(const T* small, size_t small_size, const T* large, size_t large_size) {
+        unsigned long count = 0;
+        size_t lo = 0;
+        for (size_t i = 0; i < small_size && lo < large_size; ++i) {
+            T x = small[i];
+
+            //exponential search: everything before lo is smaller than x, large[pos] is not (if it exists)
+            size_t pos = lo, step = 1;
+            while (pos < large_size && large[pos] < x) {
+                lo = pos + 1;
+                pos += step;
+                step *= 2;
+            }
+            size_t end = pos < large_size ? pos + 1 : large_size;
+
+            lo = static_cast<size_t>(std::lower_bound(large + lo, large + end, x) - large);
+            if (lo < large_size && large[lo] == x) {
+                count += 1;
+                ++lo;
+            }
+        }
+        return count;
+    }
+
+#ifdef TCOUNT_X86_KERNELS
+    __attribute__((target("sse4.2,popcnt")))
+    unsigned long sse42_count(const unsigned int* a, size_t a_size, const unsigned int* b, size_t b_size) {
+        unsigned long count = 0;
+        size_t i = 0, j = 0;
+        while (i + 4 <= a_size && j + 4 <= b_size) {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+
+            __m128i match = _mm_cmpeq_epi32(va, vb);
+            for (int r = 1; r < 4; ++r) {
+                vb = _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1));
+                match = _mm_or_si128(match, _mm_cmpeq_epi32(va, vb));
+            }
+            count += __builtin_popcount(static_cast<unsigned int>(_mm_movemask_ps(_mm_castsi128_ps(match))));
+
+            unsigned int a_max = a[i + 3], b_max = b[j + 3];
+            i += a_max <= b_max ? 4 : 0;
+            j += b_max <= a_max ? 4 : 0;
+        }
+        return count + merge_count(a + i, a_size - i, b + j, b_size - j);
+    }
+
+    __attribute__((target("sse4.2,popcnt")))
+    unsigned long sse42_count(const unsigned long long* a, size_t a_size, const unsigned long long* b, size_t b_size) {
+        unsigned long count = 0;
+        size_t i = 0, j = 0;
+        while (i + 2 <= a_size && j + 2 <= b_size) {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+
+            __m128i match = _mm_cmpeq_epi64(va, vb);
+            vb = _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2));
+            match = _mm_or_si128(match, _mm_cmpeq_epi64(va, vb));
+            count += __builtin_popcount(static_cast<unsigned int>(_mm_movemask_pd(_mm_castsi128_pd(match))));
+
+            unsigned long long a_max = a[i + 1], b_max = b[j + 1];
+            i += a_max <= b_max ? 2 : 0;
+            j += b_max <= a_max ? 2 : 0;
+        }
+        return count + merge_count(a + i, a_size - i, b + j, b_size - j);
+    }
+
+    __attribute__((target("avx2,popcnt")))
+    unsigned long avx2_count(const unsigned int* a, size_t a_size, const unsigned int* b, size_t b_size) {
+        const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+        unsigned long count = 0;
+        size_t i = 0, j = 0;
+        while (i + 8 <= a_size && j + 8 <= b_size) {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+
+            __m256i match = _mm256_cmpeq_epi32(va, vb);
+            for (int r = 1; r < 8; ++r) {
+                vb = _mm256_permutevar8x32_epi32(vb, rotate);
+                match = _mm256_or_si256(match, _mm256_cmpeq_epi32(va, vb));
+            }
+            count += __builtin_popcount(static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(match))));
+
+            unsigned int a_max = a[i + 7], b_max = b[j + 7];
+            i += a_max <= b_max ? 8 : 0;
+            j += b_max <= a_max ? 8 : 0;
+        }
+        return count + merge_count(a + i, a_size - i, b + j, b_size - j);
+    }
+
+    __attribute__((target("avx2,popcnt")))
+    unsigned long avx2_count(const unsigned long long* a, size_t a_size, const unsigned long long* b, size_t b_size) {
+        unsigned long count = 0;
+        size_t i = 0, j = 0;
+        while (i + 4 <= a_size && j + 4 <= b_size) {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+
+            __m256i match = _mm256_cmpeq_epi64(va, vb);
+            for (int r = 1; r < 4; ++r) {
+                vb = _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(0, 3, 2, 1));
+                match = _mm256_or_si256(match, _mm256_cmpeq_epi64(va, vb));
+            }
+            count += __builtin_popcount(static_cast<unsigned int>(_mm256_movemask_pd(_mm256_castsi256_pd(match))));
+
+            unsigned long long a_max = a[i + 3], b_max = b[j + 3];
+            i += a_max <= b_max ? 4 : 0;
+            j += b_max <= a_max ? 4 : 0;
+        }
+        return count + merge_count(a + i, a_size - i, b + j, b_size - j);
+    }
+
+    //the AVX-512 intrinsics fill the lanes their mask leaves out from an undefined register, which
+    //GCC 12 reports as uninitialized once they are inlined
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+    __attribute__((target("avx512f,popcnt")))
+    unsigned long avx512_count(const unsigned int* a, size_t a_size, const unsigned int* b, size_t b_size) {
+        unsigned long count = 0;
+        size_t i = 0, j = 0;
+        while (i + 16 <= a_size && j + 16 <= b_size) {
+            __m512i va = _mm512_loadu_si512(a + i);
+            __m512i vb = _mm512_loadu_si512(b + j);
+
+            __mmask16 match = _mm512_cmpeq_epi32_mask(va, vb);
+            for (int r = 1; r < 16; ++r) {
+                vb = _mm512_alignr_epi32(vb, vb, 1);
+                match = static_cast<__mmask16>(match | _mm512_cmpeq_epi32_mask(va, vb));
+            }
+            count += __builtin_popcount(static_cast<unsigned int>(match));
+
+            unsigned int a_max = a[i + 15], b_max = b[j + 15];
+            i += a_max <= b_max ? 16 : 0;
+            j += b_max <= a_max ? 16 : 0;
+        }
+        return count + merge_count(a + i, a_size - i, b + j, b_size - j);
+    }
+
+    __attribute__((target("avx512f,popcnt")))
+    unsigned long avx512_count(const unsigned long long* a, size_t a_size, const unsigned long long* b, size_t b_size) {
+        unsigned long count = 0;
+        size_t i = 0, j = 0;
+        while (i + 8 <= a_size && j + 8 <= b_size) {
+            __m512i va = _mm512_loadu_si512(a + i);
+            __m512i vb = _mm512_loadu_si512(b + j);
+
+            __mmask8 match = _mm512_cmpeq_epi64_mask(va, vb);
+            for (int r = 1; r < 8; ++r) {
+                vb = _mm512_alignr_epi64(vb, vb, 1);
+                match = static_cast<__mmask8>(match | _mm512_cmpeq_epi64_mask(va, vb));
+            }
+            count += __builtin_popcount(static_cast<unsigned int>(match));
+
+            unsigned long long a_max = a[i + 7], b_max = b[j + 7];
+            i += a_max <= b_max ? 8 : 0;
+            j += b_max <= a_max ? 8 : 0;
+        }
+        return count + merge_count(a + i, a_size - i, b + j, b_size - j);
+    }
+
+    __attribute__((target("popcnt")))
+    unsigned long popcnt_and(const unsigned long long* a, const unsigned long long* b, size_t words) {
+        //four accumulators so consecutive popcnts do not wait on each other
+        unsigned long long c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+        size_t i = 0;
+        for (; i + 4 <= words; i += 4) {
+            c0 += __builtin_popcountll(a[i] & b[i]);
+            c1 += __builtin_popcountll(a[i + 1] & b[i + 1]);
+            c2 += __builtin_popcountll(a[i + 2] & b[i + 2]);
+            c3 += __builtin_popcountll(a[i + 3] & b[i + 3]);
+        }
+        for (; i < words; ++i) {
+            c0 += __builtin_popcountll(a[i] & b[i]);
+        }
+        return c0 + c1 + c2 + c3;
+    }
+
+    //popcount of each byte through a nibble lookup table in vpshufb, summed by vpsadbw
+    __attribute__((target("avx2,popcnt")))
+    unsigned long avx2_popcount_and(const unsigned long long* a, const unsigned long long* b, size_t words) {
+        const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i low_nibbles = _mm256_set1_epi8(0x0f);
+        __m256i total = _mm256_setzero_si256();
+
+        size_t i = 0;
+        for (; i + 4 <= words; i += 4) {
+            __m256i x = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                         _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+            __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(x, low_nibbles));
+            __m256i hi = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(x, 4), low_nibbles));
+            total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+        }
+
+        unsigned long long count = static_cast<unsigned long long>(_mm256_extract_epi64(total, 0)) +
+                                   static_cast<unsigned long long>(_mm256_extract_epi64(total, 1)) +
+                                   static_cast<unsigned long long>(_mm256_extract_epi64(total, 2)) +
+                                   static_cast<unsigned long long>(_mm256_extract_epi64(total, 3));
+        for (; i < words; ++i) {
+            count += __builtin_popcountll(a[i] & b[i]);
+        }
+        return count;
+    }
+
+    __attribute__((target("avx512f,avx512vpopcntdq,popcnt")))
+    unsigned long avx512_popcount_and(const unsigned long long* a, const unsigned long long* b, size_t words) {
+        __m512i total = _mm512_setzero_si512();
+
+        size_t i = 0;
+        for (; i + 8 <= words; i += 8) {
+            __m512i x = _mm512_and_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+            total = _mm512_add_epi64(total, _mm512_popcnt_epi64(x));
+        }
+
+        unsigned long long count = static_cast<unsigned long long>(_mm512_reduce_add_epi64(total));
+        for (; i < words; ++i) {
+            count += __builtin_popcountll(a[i] & b[i]);
+        }
+        return count;
+    }
+#pragma GCC diagnostic pop
+
+    bool has_vpopcntdq() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512vpopcntdq");
+    }
+
+    const bool vpopcntdq = has_vpopcntdq();
+#endif
+
+    template<typename T>
+    unsigned long dispatch_count(const T* a, size_t a_size, const T* b, size_t b_size) {
+        if (a_size > b_size) {
+            std::swap(a, b);
+            std::swap(a_size, b_size);
+        }
+        if (a_size == 0) {
+            return 0;
+        }
+        if (b_size / a_size >= GALLOPING_RATIO) {
+            return galloping_count(a, a_size, b, b_size);
+        }
+
+        switch (active_level) {
+#ifdef TCOUNT_X86_KERNELS
+            case tcount::simd_level::avx512:
+                return avx512_count(a, a_size, b, b_size);
+            case tcount::simd_level::avx2:
+                return avx2_count(a, a_size, b, b_size);
+            case tcount::simd_level::sse42:
+                return sse42_count(a, a_size, b, b_size);
+#endif
+            default:
+                return merge_count(a, a_size, b, b_size);
+        }
+    }
+}
+
+/**
+ * @return The widest instruction set the CPU supports that there is a kernel for.
+ */
+tcount::simd_level tcount::detected_simd_level() {
+#ifdef TCOUNT_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return simd_level::avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return simd_level::avx2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return simd_level::sse42;
+    }
+#endif
+    return simd_level::scalar;
+}
+
+tcount::simd_level tcount::active_simd_level() {
+    return active_level;
+}
+
+/**
+ * Forces the kernels used by intersection_count, for example to benchmark them against each other.
+ * A level above the detected one is lowered to the detected one. Not thread safe.
+ */
+void tcount::set_simd_level(simd_level level) {
+    active_level = std::min(level, detected_simd_level());
+}
+
+const char* tcount::simd_level_name(simd_level level) {
+    switch (level) {
+        case simd_level::avx512:
+            return "avx512";
+        case simd_level::avx2:
+            return "avx2";
+        case simd_level::sse42:
+            return "sse4.2";
+        default:
+            return "scalar";
+    }
+}
+
+/**
+ * Counts the elements two sorted, duplicate free lists have in common. Very lopsided pairs are
+ * galloped, everything else goes to the widest SIMD kernel the CPU supports.
+ *
+ * @param a The first list.
+ * @param a_size The length of the first list.
+ * @param b The second list.
+ * @param b_size The length of the second list.
+ * @return |a intersect b|
+ */
+unsigned long tcount::intersection_count(const unsigned int* a, size_t a_size, const unsigned int* b, size_t b_size) {
+    return dispatch_count(a, a_size, b, b_size);
+}
+
+unsigned long tcount::intersection_count(const unsigned long long* a, size_t a_size, const unsigned long long* b, size_t b_size) {
+    return dispatch_count(a, a_size, b, b_size);
+}
+
+unsigned long tcount::intersection_count(const unsigned long* a, size_t a_size, const unsigned long* b, size_t b_size) {
+    //unsigned long is a distinct type from both fixed width types, so route it by size
+    if (sizeof(unsigned long) == sizeof(unsigned long long)) {
+        return dispatch_count(reinterpret_cast<const unsigned long long*>(a), a_size,
+                              reinterpret_cast<const unsigned long long*>(b), b_size);
+    }
+    return dispatch_count(reinterpret_cast<const unsigned int*>(a), a_size,
+                          reinterpret_cast<const unsigned int*>(b), b_size);
+}
+
+/**
+ * The plain merge loop, kept for comparison.
+ */
+unsigned long tcount::intersection_count_merge(const unsigned int* a, size_t a_size, const unsigned int* b, size_t b_size) {
+    return merge_count(a, a_size, b, b_size);
+}
+
+unsigned long tcount::intersection_count_merge(const unsigned long long* a, size_t a_size, const unsigned long long* b, size_t b_size) {
+    return merge_count(a, a_size, b, b_size);
+}
+
+/**
+ * Galloping (exponential search) intersection, for when one list is much shorter than the other.
+ */
+unsigned long tcount::intersection_count_galloping(const unsigned int* a, size_t a_size, const unsigned int* b, size_t b_size) {
+    return a_size <= b_size ? galloping_count(a, a_size, b, b_size) : galloping_count(b, b_size, a, a_size);
+}
+
+unsigned long tcount::intersection_count_galloping(const unsigned long long* a, size_t a_size, const unsigned long long* b, size_t b_size) {
+    return a_size <= b_size ? galloping_count(a, a_size, b, b_size) : galloping_count(b, b_size, a, a_size);
+}
+
+/**
+ * Counts the bits set in both of two bitmaps, using AVX-512 VPOPCNTDQ, an AVX2 nibble lookup or
+ * the popcnt instruction, whichever is the widest the CPU and the active level allow.
+ *
+ * @param a The first bitmap.
+ * @param b The second bitmap.
+ * @param words The length of both bitmaps in 64 bit words.
+ * @return popcount(a & b)
+ */
+unsigned long tcount::popcount_and(const unsigned long long* a, const unsigned long long* b, size_t words) {
+#ifdef TCOUNT_X86_KERNELS
+    //the vector kernels only pay off once there are a few registers worth of words
+    if (active_level == simd_level::avx512 && vpopcntdq && words >= 32) {
+        return avx512_popcount_and(a, b, words);
+    }
+    if (active_level >= simd_level::avx2 && words >= 32) {
+        return avx2_popcount_and(a, b, words);
+    }
+    if (active_level != simd_level::scalar) {
+        return popcnt_and(a, b, words);
+    }
+#endif
+    unsigned long count = 0;
+    for (size_t i = 0; i < words; ++i) {
+        unsigned long long x = a[i] & b[i];
+        while (x != 0) {
+            x &= x - 1;
+            count += 1;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,36 @@
+//
+// Kernels that count the size of the intersection of two sorted, duplicate free neighbour lists.
+// The fastest kernel the CPU supports is picked at runtime.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_INTERSECTION_H
+#define TRIANGLECOUNTINGAPI_INTERSECTION_H
+
+#include <cstddef>
+
+namespace tcount {
+    enum class simd_level {
+        scalar,
+        sse42,
+        avx2,
+        avx512
+    };
+
+    simd_level detected_simd_level();
+    simd_level active_simd_level();
+    void set_simd_level(simd_level level);
+    const char* simd_level_name(simd_level level);
+
+    unsigned long intersection_count(const unsigned int* a, size_t a_size, const unsigned int* b, size_t b_size);
+    unsigned long intersection_count(const unsigned long* a, size_t a_size, const unsigned long* b, size_t b_size);
+    unsigned long intersection_count(const unsigned long long* a, size_t a_size, const unsigned long long* b, size_t b_size);
+
+    unsigned long intersection_count_merge(const unsigned int* a, size_t a_size, const unsigned int* b, size_t b_size);
+    unsigned long intersection_count_merge(const unsigned long long* a, size_t a_size, const unsigned long long* b, size_t b_size);
+    unsigned long intersection_count_galloping(const unsigned int* a, size_t a_size, const unsigned int* b, size_t b_size);
+    unsigned long intersection_count_galloping(const unsigned long long* a, size_t a_size, const unsigned long long* b, size_t b_size);
+
+    unsigned long popcount_and(const unsigned long long* a, const unsigned long long* b, size_t words);
+}
+
+#endif //TRIANGLECOUNTINGAPI_INTERSECTION_H
@@ -3,130 +3,598 @@
 #include <chrono>
 #include <thread>
 #include <stack>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <boost/functional/hash.hpp>
 #include "gps_post_stream.h"
+#include "gps_reservoir.h"
+#include "gps_sharded.h"
+#include "parallel.h"
 #include "adjacency_list_graph.h"
 #include "sampler.h"
 #include "sampler_edge_array.h"
+#include "edge_list_reader.h"
+#include "csr_graph.h"
+#include "oriented_graph.h"
+#include "csr_builder.h"
+#include "doulion.h"
+#include "counting_engine.h"
+#include "vertex_triangles.h"
+#include "truss.h"
+#include "out_of_core.h"
+#include "reorder.h"
+#include "wedge_sampler.h"
+#include "stats.h"
+#include <fstream>
 #include <iomanip>
+#include <cmath>
+
+struct cli_options {
+    // 0 = every hardware thread
+    unsigned int threads = 0;
+    bool hubs = false;
+    // 0 = chosen from the degree distribution
+    unsigned long hub_threshold = 0;
+    bool has_seed = false;
+    unsigned long long seed = 0;
+    // 0 = no running estimates
+    unsigned long report_every = 0;
+    // where to write the GPS sample, empty for nowhere
+    std::string sample_out;
+    // where to write per vertex triangle counts, empty for nowhere
+    std::string vertex_out;
+    tcount::counting_engine engine = tcount::counting_engine::automatic;
+    // 0 = count in memory, otherwise the bytes of edges the out-of-core count may hold
+    size_t memory_budget = 0;
+    std::string temp_dir = ".";
+    tcount::vertex_order order = tcount::vertex_order::original;
+    // print the phase timings and counters to stderr as JSON when the run ends
+    bool stats_json = false;
+    // 0 = a fixed number of samples, otherwise sample until this relative error is reached
+    double relative_error = 0;
+    double confidence = 0.95;
+    // check every array of a .tcsr input before using it
+    bool verify = false;
+};
+
+/**
+ * @return The seed given with --seed, or one taken from the clock.
+ */
+unsigned long long random_seed(const cli_options &options) {
+    if (options.has_seed) {
+        return options.seed;
+    }
+    return static_cast<unsigned long long>(std::chrono::system_clock::now().time_since_epoch().count());
+}
 
-void gps_example(const char* filename, long res_size) {
-    tcount::gps_post_stream gps_stream(res_size);
+/**
+ * @return The graph renumbered by the ordering given with --order, or the graph itself.
+ */
+tcount::csr_graph apply_order(tcount::csr_graph &&graph, const cli_options &options) {
+    if (options.order == tcount::vertex_order::original) {
+        return std::move(graph);
+    }
+    return tcount::reorder(graph, options.order, options.threads);
+}
 
-    FILE *file = fopen(filename, "r");
+void report_hubs(const tcount::hub_index &hubs) {
+    std::cerr << "hub index: " << hubs.number_of_hubs() << " hubs of degree >= " << hubs.threshold() << ", "
+              << hubs.memory_bytes() / (1024.0 * 1024.0) << " MiB" << std::endl;
+}
+
+/**
+ * Counts the triangles of an oriented graph exactly with the engine asked for, with hub bitmaps if
+ * they were asked for too.
+ */
+template<typename Vertex>
+unsigned long long count_oriented(const tcount::basic_oriented_graph<Vertex> &oriented, const cli_options &options) {
+    if (!options.hubs || (options.engine != tcount::counting_engine::automatic &&
+                          options.engine != tcount::counting_engine::forward)) {
+        return tcount::count_triangles(oriented, options.engine, options.threads);
+    }
 
-    unsigned long x, y;
-    while (fscanf(file, "%lu %lu\n", &x, &y) != EOF) {
-        //edge_stream.push_back(std::make_tuple(x, y));
-        gps_stream.add_edge(x, y);
+    unsigned long threshold = options.hub_threshold;
+    if (threshold == 0) {
+        threshold = tcount::hub_index::choose_threshold(oriented.node_array(), oriented.number_of_nodes(),
+                                                        oriented.number_of_edges() * sizeof(Vertex) / 2);
     }
+    tcount::hub_index hubs(oriented.node_array(), oriented.edge_array(), oriented.number_of_nodes(),
+                           threshold, options.threads);
+    report_hubs(hubs);
 
-    std::cout << gps_stream.compute_triangle_count() << std::endl;
+    return tcount::count_triangles(oriented, tcount::counting_engine::forward, options.threads, &hubs);
 }
 
-void forward_example(const char* filename) {
-    tcount::adjacency_list_graph g;
+/**
+ * Orients a graph, with 32 bit ranks unless it is too large for them, releases the CSR and counts
+ * the triangles exactly.
+ */
+unsigned long long count_csr(tcount::csr_graph &&graph, const cli_options &options) {
+    if (tcount::compact_oriented_graph::fits(graph.number_of_nodes())) {
+        tcount::compact_oriented_graph oriented(graph);
+        graph = tcount::csr_graph();
+        return count_oriented(oriented, options);
+    }
 
-    FILE *file = fopen(filename, "r");
+    tcount::oriented_graph oriented(graph);
+    graph = tcount::csr_graph();
+    return count_oriented(oriented, options);
+}
 
-    unsigned long x, y;
-    while (fscanf(file, "%lu %lu\n", &x, &y) != EOF) {
-        g[x].push_back(y);
-        g[y].push_back(x);
+/**
+ * Calls fn with the graph, narrowed to 32 bit ids if it has fewer than 2^32 nodes. The samplers
+ * read nothing but the edge array once it is built, so this halves what they read and lets the
+ * intersections use the 32 bit kernels. Relabel the graph first, as the ids are narrowed as they are.
+ */
+template<typename Fn>
+void with_compact_ids(tcount::csr_graph &&graph, const cli_options &options, Fn fn) {
+    if (tcount::compact_csr_graph::fits(graph.number_of_nodes())) {
+        fn(tcount::compact_csr_graph(std::move(graph), options.threads));
+        return;
     }
+    fn(std::move(graph));
+}
 
-    std::cout << tcount::forward(g) << std::endl;
+/**
+ * Maps a .tcsr file, checking its arrays first if --verify was given.
+ */
+tcount::csr_graph map_csr(const char* filename, const cli_options &options) {
+    tcount::csr_graph graph(filename);
+    if (options.verify) {
+        graph.verify(options.threads);
+    }
+    return graph;
 }
 
-void doulion_example_forward(const char* filename, double p) {
-    tcount::adjacency_list_graph g;
+/**
+ * @return The graph of the input, mapped if it is a .tcsr file and built if it is a text edge list.
+ */
+tcount::csr_graph load_graph(const char* filename, const cli_options &options) {
+    if (tcount::csr_graph::is_csr_file(filename)) {
+        return map_csr(filename, options);
+    }
+    tcount::edge_list_reader reader(filename, options.threads);
+    return tcount::build_csr(reader.read_edges(), options.threads);
+}
 
-    FILE *file = fopen(filename, "r");
+/**
+ * Calls fn(edges, count) for every batch of edges in the input, which is either a text edge list
+ * or a .tcsr file.
+ */
+template<typename Fn>
+void for_each_edge_batch(const char* filename, const cli_options &options, Fn fn) {
+    if (tcount::csr_graph::is_csr_file(filename)) {
+        tcount::csr_graph graph = map_csr(filename, options);
+        graph.for_each_batch(fn);
+    }
+    else {
+        tcount::edge_list_reader reader(filename);
+        reader.for_each_batch(fn);
+    }
+}
+
+/**
+ * Passes every edge in the input, either a text edge list or a .tcsr file, to consumer.add_edge.
+ */
+template<typename Consumer>
+void feed_edges(const char* filename, const cli_options &options, Consumer &consumer) {
+    for_each_edge_batch(filename, options, [&consumer](const tcount::edge* edges, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            consumer.add_edge(edges[i].first, edges[i].second);
+        }
+    });
+}
 
-    unsigned int seed = static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count());
-    std::mt19937 mt(seed);
-    std::uniform_real_distribution<double> dist(0.0, 1.0);
+void report_estimate(unsigned long edges, const char* kind, const tcount::gps_estimate &estimate) {
+    std::cerr << edges << " edges, " << kind << " estimate: " << estimate.triangles
+              << " +- " << std::sqrt(std::max(0.0, estimate.variance)) << std::endl;
+}
+
+/**
+ * @return The number of GPS shards: one per thread.
+ */
+unsigned int gps_shards(const cli_options &options) {
+    return options.threads == 0 ? tcount::default_threads() : options.threads;
+}
+
+void gps_example(const char* filename, long res_size, const cli_options &options) {
+    //feeding the reservoirs is sampling, so the stream counts as estimating
+    tcount::stats::phase_timer timer(tcount::stats::phase::estimate);
+    unsigned long edges_seen = 0;
+    tcount::gps_estimate estimate;
+    std::vector<tcount::sampled_edge> sample;
+    bool keep_sample = !options.sample_out.empty() || !options.vertex_out.empty();
+
+    //the reservoir only knows the degrees within its sample, so the clustering coefficients need
+    //the stream's own; an edge is counted the first time it is seen in either direction, as the
+    //reservoir and mode 1 see the graph, so this holds every distinct edge once
+    std::unordered_map<unsigned long, unsigned long> degrees;
+    std::unordered_set<tcount::edge, boost::hash<tcount::edge>> seen;
+    auto count_degrees = [&](const tcount::edge* edges, size_t count) {
+        if (!options.vertex_out.empty()) {
+            for (size_t i = 0; i < count; ++i) {
+                unsigned long u = std::min(edges[i].first, edges[i].second);
+                unsigned long v = std::max(edges[i].first, edges[i].second);
+                if (u != v && seen.emplace(u, v).second) {
+                    degrees[u] += 1;
+                    degrees[v] += 1;
+                }
+            }
+        }
+    };
+
+    if (gps_shards(options) == 1) {
+        tcount::gps_reservoir gps_stream(res_size, random_seed(options));
+
+        //the in-stream estimate is free to read, so it can be reported as often as asked for
+        for_each_edge_batch(filename, options, [&](const tcount::edge* edges, size_t count) {
+            count_degrees(edges, count);
+            for (size_t i = 0; i < count; ++i) {
+                gps_stream.add_edge(edges[i].first, edges[i].second);
+                edges_seen += 1;
+                if (options.report_every != 0 && edges_seen % options.report_every == 0) {
+                    report_estimate(edges_seen, "in-stream", gps_stream.in_stream_estimate());
+                }
+            }
+        });
+
+        estimate = gps_stream.post_stream_estimate(1);
+        if (options.report_every != 0) {
+            report_estimate(edges_seen, "in-stream", gps_stream.in_stream_estimate());
+        }
+        if (keep_sample) {
+            sample = gps_stream.sample();
+        }
+    }
+    else {
+        tcount::gps_sharded gps_stream(res_size, gps_shards(options), random_seed(options));
+
+        //in-stream estimates only see the triangles inside one shard, so report the union instead
+        for_each_edge_batch(filename, options, [&](const tcount::edge* edges, size_t count) {
+            count_degrees(edges, count);
+            gps_stream.add_edges(edges, count);
+            unsigned long before = edges_seen;
+            edges_seen += count;
+            if (options.report_every != 0 && edges_seen / options.report_every != before / options.report_every) {
+                report_estimate(edges_seen, "post-stream", gps_stream.estimate(gps_shards(options)));
+            }
+        });
+
+        estimate = gps_stream.estimate(gps_shards(options));
+        if (keep_sample) {
+            sample = gps_stream.sample();
+        }
+    }
 
-    unsigned long x, y;
-    while (fscanf(file, "%lu %lu\n", &x, &y) != EOF) {
-        if (dist(mt) < p) {
-            g[x].push_back(y);
-            g[y].push_back(x);
+    if (options.report_every != 0) {
+        report_estimate(edges_seen, "post-stream", estimate);
+    }
+    if (!options.sample_out.empty()) {
+        tcount::save_sample(options.sample_out.c_str(), sample);
+    }
+    if (!options.vertex_out.empty()) {
+        //with the edge list read, every vertex's degree is exact even though its triangles are not
+        tcount::vertex_counts counts = tcount::estimate_vertex_triangles(std::move(sample), gps_shards(options));
+        for (size_t i = 0; i < counts.ids.size(); ++i) {
+            counts.degrees[i] = degrees[counts.ids[i]];
         }
+        tcount::save_vertex_counts(options.vertex_out.c_str(), counts);
     }
 
-    unsigned long val = tcount::forward(g);
-    double e = 1.0 / (p*p*p);
-    double t = val * e;
+    std::cout << static_cast<unsigned long long>(estimate.triangles) << std::endl;
+}
 
-    std::cout << (unsigned long)t << std::endl;
+/**
+ * Combines GPS samples saved with --sample-out into one estimate. The samples must be of disjoint
+ * edge streams, for example each machine's own hash partition of the edges or different days; an
+ * edge found in more than one sample is an error, as the streams overlapped.
+ */
+void merge_samples_example(int count, char* filenames[], const cli_options &options) {
+    std::vector<tcount::sampled_edge> sample;
+    for (int i = 0; i < count; ++i) {
+        std::vector<tcount::sampled_edge> part = tcount::load_sample(filenames[i]);
+        sample.insert(sample.end(), part.begin(), part.end());
+    }
+
+    unsigned long sampled = sample.size();
+    if (!options.vertex_out.empty()) {
+        //the samples hold no degrees, so the clustering column is left at 0
+        tcount::save_vertex_counts(options.vertex_out.c_str(), tcount::estimate_vertex_triangles(sample, options.threads));
+    }
+    tcount::gps_estimate estimate = tcount::estimate_union(std::move(sample), options.threads);
+    report_estimate(sampled, "merged sample", estimate);
+    std::cout << static_cast<unsigned long long>(estimate.triangles) << std::endl;
 }
 
-long doulion_example_sampling(const char* filename, long samples, double p) {
-    tcount::sampler_edge_array sampler;
+/**
+ * Counts the triangles of every vertex in one pass, writes them to the --vertex-out file and prints
+ * the total.
+ */
+template<typename Vertex>
+void count_vertices(const tcount::basic_oriented_graph<Vertex> &oriented, const cli_options &options) {
+    tcount::vertex_counts counts = tcount::count_vertex_triangles(oriented, options.threads);
+    tcount::save_vertex_counts(options.vertex_out.c_str(), counts);
+
+    //every triangle is counted at each of its three vertices; the counts are whole numbers, so the
+    //sum is exact as long as it stays below 2^53
+    double total = 0;
+    for (double triangles: counts.triangles) {
+        total += triangles;
+    }
+    std::cout << static_cast<unsigned long long>(total / 3) << std::endl;
+}
 
-    FILE *file = fopen(filename, "r");
+/**
+ * Orients a graph, with 32 bit ranks unless it is too large for them, releases the CSR and counts
+ * the triangles of every vertex.
+ */
+void vertex_count_example(tcount::csr_graph &&graph, const cli_options &options) {
+    if (tcount::compact_oriented_graph::fits(graph.number_of_nodes())) {
+        tcount::compact_oriented_graph oriented(graph);
+        graph = tcount::csr_graph();
+        count_vertices(oriented, options);
+        return;
+    }
 
-    unsigned int seed = static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count());
-    std::mt19937 mt(seed);
-    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    tcount::oriented_graph oriented(graph);
+    graph = tcount::csr_graph();
+    count_vertices(oriented, options);
+}
 
-    unsigned long x, y;
-    while (fscanf(file, "%lu %lu\n", &x, &y) != EOF) {
-        if (dist(mt) < p) {
-            sampler.add_edge(x, y);
+void forward_example(const char* filename, const cli_options &options) {
+    if (options.memory_budget != 0) {
+        if (options.verify && tcount::csr_graph::is_csr_file(filename)) {
+            map_csr(filename, options);
         }
+        tcount::out_of_core_counter counter(options.memory_budget, options.temp_dir, options.threads);
+        std::cout << counter.count_triangles(filename) << std::endl;
+        std::cerr << counter.number_of_partitions() << " partitions, " << counter.bytes_written() / (1024.0 * 1024.0)
+                  << " MiB written, " << counter.bytes_read() / (1024.0 * 1024.0) << " MiB read" << std::endl;
+        return;
+    }
+
+    tcount::csr_graph graph = load_graph(filename, options);
+
+    if (!options.vertex_out.empty()) {
+        vertex_count_example(std::move(graph), options);
+        return;
+    }
+    std::cout << count_csr(std::move(graph), options) << std::endl;
+}
+
+/**
+ * @return The edges DOULION keeps from the input, checking a .tcsr input first if --verify was given.
+ */
+std::vector<tcount::edge> sparsify_input(const tcount::doulion &stage, const char* filename,
+                                         const cli_options &options) {
+    if (options.verify && tcount::csr_graph::is_csr_file(filename)) {
+        return stage.sparsify(map_csr(filename, options));
     }
-    sampler.build_edge_array(true);
+    return stage.sparsify(filename);
+}
+
+void doulion_example_forward(const char* filename, double p, const cli_options &options) {
+    tcount::doulion stage(p, random_seed(options), options.threads);
+
+    tcount::csr_graph graph = tcount::build_csr(sparsify_input(stage, filename, options), options.threads);
+    double t = stage.scale(count_csr(std::move(graph), options));
+
+    std::cout << std::fixed << std::setprecision(0) << t << std::endl;
+}
 
-    unsigned long val = sampler.sample_triangles(samples);
+double doulion_example_sampling(const char* filename, long samples, double p, const cli_options &options) {
+    tcount::doulion stage(p, random_seed(options), options.threads);
 
-    double e = 1.0 / (p*p*p);
-    double t = val * e;
+    double t = 0;
+    with_compact_ids(tcount::build_csr(sparsify_input(stage, filename, options), options.threads), options,
+                     [&](auto &&graph) {
+        tcount::basic_sampler_edge_array<typename std::decay_t<decltype(graph)>::vertex_type> sampler{std::move(graph)};
+        t = stage.scale(sampler.sample_triangles(samples, options.threads, random_seed(options)));
+    });
 
-    std::cout << (unsigned long)t << std::endl;
+    std::cout << std::fixed << std::setprecision(0) << t << std::endl;
 
     return t;
 }
 
-void doulion_example_gps(const char* filename, long res_size, double p) {
-    tcount::gps_post_stream gps(res_size);
+void doulion_example_gps(const char* filename, long res_size, double p, const cli_options &options) {
+    tcount::doulion stage(p, random_seed(options), options.threads);
+    tcount::gps_sharded gps(res_size, gps_shards(options), random_seed(options));
 
-    FILE *file = fopen(filename, "r");
+    std::vector<tcount::edge> kept = sparsify_input(stage, filename, options);
+    gps.add_edges(kept.data(), kept.size());
+    double t = stage.scale(gps.estimate(gps_shards(options)).triangles);
 
-    unsigned int seed = static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count());
-    std::mt19937 mt(seed);
-    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    std::cout << std::fixed << std::setprecision(0) << t << std::endl;
+}
 
-    unsigned long x, y;
-    while (fscanf(file, "%lu %lu\n", &x, &y) != EOF) {
-        if (dist(mt) < p) {
-            gps.add_edge(x, y);
-        }
+/**
+ * Samples a fixed number of triangles, or with --error until the confidence interval is that
+ * narrow, taking at most the given number of samples.
+ */
+template<typename Vertex>
+void sample_edge_array(tcount::basic_csr_graph<Vertex> &&graph, long samples, const cli_options &options) {
+    tcount::basic_sampler_edge_array<Vertex> sampler{std::move(graph)};
+    if (options.hubs) {
+        report_hubs(sampler.build_hub_index(options.hub_threshold));
+    }
+
+    if (options.relative_error == 0) {
+        std::cout << sampler.sample_triangles(samples, options.threads, random_seed(options)) << std::endl;
+        return;
     }
 
-    unsigned long val = static_cast<unsigned long>(gps.compute_triangle_count());
-    double e = 1.0 / (p*p*p);
-    double t = val * e;
+    tcount::sampling_target target;
+    target.relative_error = options.relative_error;
+    target.confidence = options.confidence;
+    target.max_samples = static_cast<unsigned long>(samples);
+    target.min_samples = std::min(target.min_samples, target.max_samples);
+    tcount::sampling_estimate estimate = sampler.sample_triangles(target, options.threads, random_seed(options));
 
-    std::cout << (unsigned long)t << std::endl;
+    std::cout << std::fixed << std::setprecision(0) << estimate.triangles << std::endl;
+    std::cerr << options.confidence * 100 << "% interval [" << estimate.lower << ", " << estimate.upper << "], "
+              << estimate.samples << " samples" << (estimate.converged ? "" : ", target not reached") << std::endl;
 }
 
-void sample_edge_array_exmaple(const char *filename, long samples) {
-    tcount::sampler_edge_array sampler;
+/**
+ * Samples a fixed number of wedges, or with --error until the confidence interval is that narrow,
+ * and prints the triangle estimate, with the transitivity it came from on stderr.
+ */
+template<typename Vertex>
+void sample_wedges(tcount::basic_csr_graph<Vertex> &&graph, long samples, const cli_options &options) {
+    tcount::basic_sampler_edge_array<Vertex> sampler{std::move(graph)};
+    tcount::basic_wedge_sampler<Vertex> wedges(sampler.graph());
+
+    if (options.relative_error == 0) {
+        tcount::wedge_estimate estimate = wedges.sample_wedges(samples, options.threads, random_seed(options));
+        std::cout << std::fixed << std::setprecision(0) << estimate.triangles << std::endl;
+        std::cerr << "transitivity " << estimate.transitivity << ", " << estimate.closed
+                  << " of " << estimate.samples << " wedges closed" << std::endl;
+        return;
+    }
+
+    tcount::sampling_target target;
+    target.relative_error = options.relative_error;
+    target.confidence = options.confidence;
+    target.max_samples = static_cast<unsigned long>(samples);
+    target.min_samples = std::min(target.min_samples, target.max_samples);
+    tcount::sampling_estimate estimate = wedges.sample_triangles(target, options.threads, random_seed(options));
+
+    std::cout << std::fixed << std::setprecision(0) << estimate.triangles << std::endl;
+    std::cerr << options.confidence * 100 << "% interval [" << estimate.lower << ", " << estimate.upper << "], "
+              << estimate.samples << " samples" << (estimate.converged ? "" : ", target not reached") << std::endl;
+    std::cerr << "transitivity " << 3 * estimate.triangles / wedges.number_of_wedges() << std::endl;
+}
 
-    FILE *file = fopen(filename, "r");
+void sample_edge_array_exmaple(const char *filename, long samples, const cli_options &options) {
+    with_compact_ids(apply_order(load_graph(filename, options), options), options, [&](auto &&graph) {
+        sample_edge_array(std::move(graph), samples, options);
+    });
+}
+
+void wedge_example(const char *filename, long samples, const cli_options &options) {
+    with_compact_ids(apply_order(load_graph(filename, options), options), options, [&](auto &&graph) {
+        sample_wedges(std::move(graph), samples, options);
+    });
+}
+
+void convert_example(const char *filename, const char *output, const cli_options &options) {
+    tcount::edge_list_reader reader(filename, options.threads);
+    tcount::csr_graph graph = apply_order(tcount::build_csr(reader.read_edges(), options.threads), options);
+    graph.save(output);
+
+    std::cout << graph.number_of_nodes() << " nodes, "
+              << graph.number_of_edges() << " edges written to " << output << std::endl;
+}
 
-    unsigned long x, y;
-    while (fscanf(file, "%lu %lu\n", &x, &y) != EOF) {
-        sampler.add_edge(x, y);
+/**
+ * Peels the k-truss decomposition of a graph and prints how many edges have each truss number,
+ * optionally writing every edge with its support and truss number to a text file.
+ */
+template<typename Vertex>
+void peel_truss(const tcount::basic_oriented_graph<Vertex> &oriented, const char *output, const cli_options &options) {
+    std::vector<unsigned int> truss = tcount::truss_decomposition(oriented, options.threads);
+
+    std::vector<unsigned long> edges_per_k;
+    for (unsigned int k: truss) {
+        if (k >= edges_per_k.size()) {
+            edges_per_k.resize(k + 1, 0);
+        }
+        edges_per_k[k] += 1;
+    }
+    for (unsigned int k = 2; k < edges_per_k.size(); ++k) {
+        if (edges_per_k[k] != 0) {
+            std::cout << k << " " << edges_per_k[k] << std::endl;
+        }
+    }
+
+    if (output != nullptr) {
+        std::vector<unsigned int> support = tcount::edge_support(oriented, options.threads);
+        std::ofstream out(output);
+        for (unsigned long u = 0; u < oriented.number_of_nodes(); ++u) {
+            for (unsigned long e = oriented.node_array()[u]; e < oriented.node_array()[u + 1]; ++e) {
+                out << oriented.original_label(u) << " " << oriented.original_label(oriented.edge_array()[e]) << " "
+                    << support[e] << " " << truss[e] << "\n";
+            }
+        }
     }
+}
 
-    sampler.build_edge_array(true);
+void truss_example(const char *filename, const char *output, const cli_options &options) {
+    tcount::csr_graph graph = load_graph(filename, options);
+    if (tcount::compact_oriented_graph::fits(graph.number_of_nodes())) {
+        tcount::compact_oriented_graph oriented(graph);
+        graph = tcount::csr_graph();
+        peel_truss(oriented, output, options);
+        return;
+    }
 
-    std::cout << sampler.sample_triangles(samples) << std::endl;
+    tcount::oriented_graph oriented(graph);
+    graph = tcount::csr_graph();
+    peel_truss(oriented, output, options);
 }
 
 int main(int argc,char* argv[]) {
+    //pull out --option=value flags, leaving the positional arguments where the modes expect them
+    cli_options options;
+    int positional = 0;
+    for (int i = 0; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg.compare(0, 10, "--threads=") == 0) {
+            options.threads = static_cast<unsigned int>(atoi(arg.c_str() + 10));
+        }
+        else if (arg.compare(0, 7, "--seed=") == 0) {
+            options.has_seed = true;
+            options.seed = std::stoull(arg.substr(7));
+        }
+        else if (arg.compare(0, 9, "--report=") == 0) {
+            options.report_every = std::stoul(arg.substr(9));
+        }
+        else if (arg.compare(0, 13, "--sample-out=") == 0) {
+            options.sample_out = arg.substr(13);
+        }
+        else if (arg.compare(0, 13, "--vertex-out=") == 0) {
+            options.vertex_out = arg.substr(13);
+        }
+        else if (arg.compare(0, 9, "--memory=") == 0) {
+            options.memory_budget = std::stoul(arg.substr(9)) * 1024 * 1024;
+        }
+        else if (arg.compare(0, 11, "--temp-dir=") == 0) {
+            options.temp_dir = arg.substr(11);
+        }
+        else if (arg.compare(0, 9, "--engine=") == 0) {
+            options.engine = tcount::parse_engine(arg.substr(9));
+        }
+        else if (arg.compare(0, 8, "--stats=") == 0) {
+            if (arg.substr(8) != "json") {
+                throw std::invalid_argument("unknown stats format " + arg.substr(8) + ", expected json");
+            }
+            options.stats_json = true;
+        }
+        else if (arg.compare(0, 8, "--error=") == 0) {
+            options.relative_error = std::stod(arg.substr(8));
+        }
+        else if (arg.compare(0, 13, "--confidence=") == 0) {
+            options.confidence = std::stod(arg.substr(13));
+        }
+        else if (arg == "--verify") {
+            options.verify = true;
+        }
+        else if (arg.compare(0, 8, "--order=") == 0) {
+            options.order = tcount::parse_order(arg.substr(8));
+        }
+        else if (arg.compare(0, 7, "--hubs=") == 0) {
+            options.hubs = true;
+            options.hub_threshold = arg.substr(7) == "auto" ? 0 : std::stoul(arg.substr(7));
+        }
+        else {
+            argv[positional++] = argv[i];
+        }
+    }
+    argc = positional;
+
     if(argc == 1) {
         std::cout << "No arguments entered." << std::endl;
         return 0;
@@ -138,39 +606,96 @@ int main(int argc,char* argv[]) {
      * 4 = doulion + Forward
      * 5 = doulion + edge
      * 6 = doulion + gps
+     * 7 = convert an edge list to a .tcsr file
+     * 8 = combine GPS samples written with --sample-out from disjoint edge streams
+     * 9 = k-truss decomposition: edges per truss number, and optionally "u v support k" per edge
+     *     written to a second file
+     * 10 = wedge sampling: the transitivity and the triangle count from closed wedges
+     *
+     * Operations 1 to 7, 9 and 10 accept either a text edge list or a .tcsr file as input.
+     *
+     * Options:
+     * --threads=N      number of threads for loading, the exact count, edge sampling and GPS shards
+     *                  (default: all hardware threads)
+     * --seed=N         fixed random seed, so sampling runs can be reproduced
+     * --engine=E       exact counting engine: forward, spgemm, matrix, or auto to pick from the
+     *                  graph's wedge and matrix sizes (default: auto; modes 1 and 4)
+     * --memory=N       count out of core, holding at most N MiB of edges, for graphs larger than
+     *                  RAM (mode 1)
+     * --temp-dir=D     where the out-of-core partitions are written (default: .)
+     * --hubs=N|auto    neighbour bitmaps for nodes of degree >= N, or a threshold chosen from the
+     *                  degree distribution (modes 1, 2 and 4; only the forward engine uses them)
+     * --order=O        renumber the nodes for cache locality before sampling: original, degree,
+     *                  rcm, hub or gorder (default: original; modes 2, 7 and 10, where the
+     *                  saved .tcsr keeps the original ids as its labels)
+     * --verify         check every array of a .tcsr input before using it, in O(m log d); mapped
+     *                  files are otherwise trusted to have been written by mode 7
+     * --stats=json     print the time spent loading, building, preprocessing, counting and
+     *                  estimating, and the hot path counters, to stderr as one JSON object
+     *                  (zeros if built with -DTCOUNT_STATS=OFF)
+     * --error=E        sample until the confidence interval is within a relative error E of the
+     *                  estimate, taking at most the given number of samples; the interval and
+     *                  the samples used are printed to stderr (modes 2 and 10)
+     * --confidence=C   the confidence level of that interval (default: 0.95)
+     * --report=N       print the running estimate every N edges to stderr (mode 3)
+     * --sample-out=F   write the GPS sample to F, to be combined with others by mode 8 (mode 3)
+     * --vertex-out=F   write the triangle count and local clustering coefficient of every vertex
+     *                  to F as binary columns, exact (mode 1) or estimated (modes 3 and 8);
+     *                  mode 3 keeps every distinct edge in memory to count the degrees
      */
     else if(argc >= 2) {
         std::string operation(argv[1]);
 
         if(operation == "1") {
-            forward_example(argv[2]);
+            forward_example(argv[2], options);
         }
 
         else if(operation == "2") {
             long number_of_samples = atol(argv[3]);
-            sample_edge_array_exmaple(argv[2], number_of_samples);
+            sample_edge_array_exmaple(argv[2], number_of_samples, options);
         }
 
         else if(operation == "3") {
             long res_size = atol(argv[3]);
-            gps_example(argv[2], res_size);
+            gps_example(argv[2], res_size, options);
         }
 
         else if(operation == "4") {
             double p = atof(argv[3]);
-            doulion_example_forward(argv[2], p);
+            doulion_example_forward(argv[2], p, options);
         }
 
         else if(operation == "5") {
             double p = atof(argv[4]);
             long number_of_samples = atol(argv[3]);
-            doulion_example_sampling(argv[2], number_of_samples, p);
+            doulion_example_sampling(argv[2], number_of_samples, p, options);
         }
 
         else if(operation == "6") {
             double p = atof(argv[4]);
             long res_size = atol(argv[3]);
-            doulion_example_gps(argv[2], res_size, p);
+            doulion_example_gps(argv[2], res_size, p, options);
+        }
+
+        else if(operation == "7") {
+            convert_example(argv[2], argv[3], options);
+        }
+
+        else if(operation == "8") {
+            merge_samples_example(argc - 2, argv + 2, options);
+        }
+
+        else if(operation == "9") {
+            truss_example(argv[2], argc >= 4 ? argv[3] : nullptr, options);
+        }
+
+        else if(operation == "10") {
+            long number_of_samples = atol(argv[3]);
+            wedge_example(argv[2], number_of_samples, options);
+        }
+
+        if (options.stats_json) {
+            tcount::stats::write_json(std::cerr);
         }
     }
 
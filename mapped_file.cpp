@@ -0,0 +1,109 @@
+//
+// A read-only memory mapping of a whole file.
+//
+
+#include "mapped_file.h"
+
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Maps the whole of the specified file into memory for reading.
+ *
+ * @param filename The path of the file to map.
+ */
+tcount::mapped_file::mapped_file(const char* filename) {
+    this->data_ = nullptr;
+    this->size_ = 0;
+
+#ifdef _WIN32
+    this->file_handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL, nullptr);
+    this->mapping_handle = nullptr;
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error(std::string("cannot open ") + filename);
+    }
+
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file_handle, &file_size);
+    this->size_ = static_cast<size_t>(file_size.QuadPart);
+    if (size_ == 0) {
+        return;
+    }
+
+    this->mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle == nullptr) {
+        CloseHandle(file_handle);
+        throw std::runtime_error(std::string("cannot map ") + filename);
+    }
+    this->data_ = static_cast<const char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("cannot open ") + filename);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error(std::string("cannot stat ") + filename);
+    }
+    this->size_ = static_cast<size_t>(st.st_size);
+
+    if (size_ > 0) {
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error(std::string("cannot map ") + filename);
+        }
+        this->data_ = static_cast<const char*>(p);
+    }
+
+    //the mapping stays valid after the descriptor is closed
+    close(fd);
+#endif
+}
+
+tcount::mapped_file::~mapped_file() {
+#ifdef _WIN32
+    if (data_ != nullptr) {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_handle != nullptr) {
+        CloseHandle(mapping_handle);
+    }
+    CloseHandle(file_handle);
+#else
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+}
+
+const char* tcount::mapped_file::data() const {
+    return data_;
+}
+
+size_t tcount::mapped_file::size() const {
+    return size_;
+}
+
+/**
+ * Hints to the kernel that the mapping will be read front to back, so that it can read ahead aggressively.
+ */
+void tcount::mapped_file::advise_sequential() const {
+#ifndef _WIN32
+    if (data_ != nullptr) {
+        madvise(const_cast<char*>(data_), size_, MADV_SEQUENTIAL);
+    }
+#endif
+}
@@ -0,0 +1,30 @@
+//
+// A read-only memory mapping of a whole file.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_MAPPED_FILE_H
+#define TRIANGLECOUNTINGAPI_MAPPED_FILE_H
+
+#include <cstddef>
+
+namespace tcount {
+    class mapped_file {
+        const char* data_;
+        size_t size_;
+#ifdef _WIN32
+        void* file_handle;
+        void* mapping_handle;
+#endif
+
+    public:
+        explicit mapped_file(const char* filename);
+        ~mapped_file();
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+        const char* data() const;
+        size_t size() const;
+        void advise_sequential() const;
+    };
+}
+
+#endif //TRIANGLECOUNTINGAPI_MAPPED_FILE_H
@@ -0,0 +1,154 @@
+//
+// Triangle counting as linear algebra: with L the degree oriented adjacency matrix, the number of
+// triangles is sum((L L) .* L), computed one row at a time with the product masked by L so that
+// it is never materialised.
+//
+
+#include "masked_spgemm.h"
+
+#include "parallel.h"
+#include "stats.h"
+
+namespace {
+    // rows claimed by a thread at a time, the grain of the parallel loop; the accumulators are
+    // reused across the rows of a block
+    const size_t ROW_BLOCK = 64;
+    // the automatic choice only uses hash accumulators when a bitmap over every node would be
+    // larger than this, and then only for rows short enough that the table stays in L1
+    const unsigned long DENSE_MAX_NODES = 1ul << 25;
+    const unsigned long HASH_MAX_ROW = 1024;
+    const unsigned long EMPTY = ~0ul;
+
+    // the slots for a row of the given length, a power of two at most half full
+    unsigned long hash_slots(unsigned long length) {
+        unsigned long slots = 16;
+        while (slots < length * 2) {
+            slots *= 2;
+        }
+        return slots;
+    }
+
+    unsigned long hash_slot(unsigned long v, unsigned long mask) {
+        return static_cast<unsigned long>((v * 0x9e3779b97f4a7c15ull) >> 32) & mask;
+    }
+}
+
+/**
+ * Counts the triangles of an oriented graph with a masked sparse matrix product. Row u of L L is
+ * accumulated only at the columns of row u of L: the out neighbours of u are loaded into an
+ * accumulator, and every out neighbour v of every out neighbour w of u is looked up in it. Each
+ * triangle u < w < v is found once.
+ *
+ * The accumulator is either a bitmap over every node or, for short rows of very large graphs, a
+ * small open addressing table. Each thread keeps both for all the rows it is given, clearing only
+ * what a row set. The bitmap takes n / 8 bytes per thread and is not tiled by column range: with
+ * 2^20 and 2^22 column tiles, the binary searches that find each tile's part of every out
+ * neighbour list cost more than the misses they saved, 10 to 30% slower from 2^18 to 2^25 nodes.
+ *
+ * @param g The oriented graph, L.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @param accumulator Which accumulator to use, or automatic to choose per row.
+ * @return The number of triangles.
+ */
+template<typename Vertex>
+unsigned long long tcount::masked_spgemm(const basic_oriented_graph<Vertex> &g, unsigned int threads,
+                                         spgemm_accumulator accumulator) {
+    if (threads == 0) {
+        threads = default_threads();
+    }
+    stats::phase_timer timer(stats::phase::count);
+
+    const unsigned long* node_array = g.node_array();
+    const Vertex* edge_array = g.edge_array();
+    unsigned long n = g.number_of_nodes();
+
+    std::vector<unsigned long long> totals(threads, 0);
+    std::vector<std::vector<unsigned long>> tables(threads);
+    std::vector<std::vector<unsigned long long>> bitmaps(threads);
+
+    parallel_for_dynamic(0, n, ROW_BLOCK, threads, [&](unsigned int t, size_t lo, size_t hi) {
+        std::vector<unsigned long> &table = tables[t];
+        std::vector<unsigned long long> &bitmap = bitmaps[t];
+        unsigned long long T = 0;
+        stats::local_counters counters;
+
+        for (size_t u = lo; u < hi; ++u) {
+            const Vertex* row = edge_array + node_array[u];
+            unsigned long length = node_array[u + 1] - node_array[u];
+            if (length < 2) {
+                continue;
+            }
+            //nothing past the last column of the mask can count
+            unsigned long last = row[length - 1];
+
+            bool hash = accumulator == spgemm_accumulator::hash ||
+                        (accumulator == spgemm_accumulator::automatic && n > DENSE_MAX_NODES &&
+                         length <= HASH_MAX_ROW);
+
+            if (hash) {
+                unsigned long slots = hash_slots(length);
+                unsigned long mask = slots - 1;
+                if (table.size() < slots) {
+                    table.resize(slots, EMPTY);
+                }
+                for (unsigned long i = 0; i < length; ++i) {
+                    unsigned long s = hash_slot(row[i], mask);
+                    while (table[s] != EMPTY) {
+                        s = (s + 1) & mask;
+                    }
+                    table[s] = row[i];
+                }
+
+                for (unsigned long i = 0; i + 1 < length; ++i) {
+                    unsigned long w = row[i];
+                    for (unsigned long e = node_array[w]; e < node_array[w + 1] && edge_array[e] <= last; ++e) {
+                        unsigned long v = edge_array[e];
+                        counters.add(stats::counter::elements_compared, 1);
+                        for (unsigned long s = hash_slot(v, mask); table[s] != EMPTY; s = (s + 1) & mask) {
+                            if (table[s] == v) {
+                                T += 1;
+                                break;
+                            }
+                        }
+                    }
+                }
+
+                std::fill(table.begin(), table.begin() + slots, EMPTY);
+            }
+            else {
+                if (bitmap.empty()) {
+                    bitmap.assign((n + 63) / 64, 0);
+                }
+                for (unsigned long i = 0; i < length; ++i) {
+                    bitmap[row[i] >> 6] |= 1ull << (row[i] & 63);
+                }
+
+                for (unsigned long i = 0; i + 1 < length; ++i) {
+                    unsigned long w = row[i];
+                    for (unsigned long e = node_array[w]; e < node_array[w + 1] && edge_array[e] <= last; ++e) {
+                        unsigned long v = edge_array[e];
+                        counters.add(stats::counter::elements_compared, 1);
+                        T += (bitmap[v >> 6] >> (v & 63)) & 1;
+                    }
+                }
+
+                for (unsigned long i = 0; i < length; ++i) {
+                    bitmap[row[i] >> 6] = 0;
+                }
+            }
+        }
+
+        totals[t] += T;
+    });
+
+    unsigned long long T = 0;
+    for (auto total: totals) {
+        T += total;
+    }
+    return T;
+}
+
+template unsigned long long tcount::masked_spgemm(const compact_oriented_graph &g, unsigned int threads,
+                                                  spgemm_accumulator accumulator);
+template unsigned long long tcount::masked_spgemm(const oriented_graph &g, unsigned int threads,
+                                                  spgemm_accumulator accumulator);
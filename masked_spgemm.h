@@ -0,0 +1,25 @@
+//
+// Triangle counting as linear algebra: with L the degree oriented adjacency matrix, the number of
+// triangles is sum((L L) .* L), computed one row at a time with the product masked by L so that
+// it is never materialised.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_MASKED_SPGEMM_H
+#define TRIANGLECOUNTINGAPI_MASKED_SPGEMM_H
+
+#include "oriented_graph.h"
+
+namespace tcount {
+    enum class spgemm_accumulator {
+        // dense, or hash for the short rows of graphs too large for a cache friendly bitmap
+        automatic,
+        hash,
+        dense
+    };
+
+    template<typename Vertex>
+    unsigned long long masked_spgemm(const basic_oriented_graph<Vertex> &g, unsigned int threads = 0,
+                                     spgemm_accumulator accumulator = spgemm_accumulator::automatic);
+}
+
+#endif //TRIANGLECOUNTINGAPI_MASKED_SPGEMM_H
@@ -0,0 +1,370 @@
+//
+// A degree oriented CSR graph, where every undirected edge is stored once from the endpoint of lower
+// degree rank to the endpoint of higher rank, and the exact forward algorithm that runs on it.
+//
+
+#include "oriented_graph.h"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+#include "intersection.h"
+#include "parallel.h"
+#include "stats.h"
+
+namespace {
+    template<typename Vertex>
+    unsigned long intersect(const tcount::hub_index* hubs, unsigned long u, const Vertex* a, size_t a_size,
+                            unsigned long v, const Vertex* b, size_t b_size) {
+        if (hubs != nullptr) {
+            return hubs->intersection_count(u, a, a_size, v, b, b_size);
+        }
+        return tcount::intersection_count(a, a_size, b, b_size);
+    }
+
+    template<typename Vertex>
+    unsigned long long forward_parallel(const tcount::basic_oriented_graph<Vertex> &g, unsigned int threads,
+                                        const tcount::hub_index* hubs) {
+        if (threads == 0) {
+            threads = tcount::default_threads();
+        }
+        tcount::stats::phase_timer timer(tcount::stats::phase::count);
+        if (threads == 1 && (hubs == nullptr || hubs->empty())) {
+            return tcount::forward_oriented(g);
+        }
+
+        const unsigned long* node_array = g.node_array();
+        const Vertex* edge_array = g.edge_array();
+        unsigned long n = g.number_of_nodes();
+
+        //written once per chunk, so there is no false sharing worth padding against
+        std::vector<unsigned long long> totals(threads, 0);
+
+        const size_t grain = 1024;
+        tcount::parallel_for_dynamic(0, g.number_of_edges(), grain, threads, [&](unsigned int thread_id, size_t lo, size_t hi) {
+            //source node of the first edge in the chunk
+            auto u = static_cast<unsigned long>(std::upper_bound(node_array, node_array + n + 1, lo) - node_array - 1);
+            unsigned long long T = 0;
+            tcount::stats::local_counters counters;
+
+            for (size_t e = lo; e < hi; ++e) {
+                while (node_array[u + 1] <= e) {
+                    ++u;
+                }
+
+                unsigned long v = edge_array[e];
+                T += intersect(hubs, u, edge_array + e + 1, node_array[u + 1] - e - 1,
+                               v, edge_array + node_array[v], node_array[v + 1] - node_array[v]);
+                counters.add(tcount::stats::counter::elements_compared,
+                             node_array[u + 1] - e - 1 + node_array[v + 1] - node_array[v]);
+            }
+            counters.add(tcount::stats::counter::intersections, hi - lo);
+
+            totals[thread_id] += T;
+        });
+
+        unsigned long long T = 0;
+        for (auto total: totals) {
+            T += total;
+        }
+
+        return T;
+    }
+}
+
+/**
+ * Relabels nodes 0..n-1 by their rank in (degree, index) order and builds the oriented CSR over the
+ * ranks, with every out neighbour list sorted and free of duplicates.
+ *
+ * @param n The number of nodes, indexed 0..n-1.
+ * @param degree degree(u) returns the degree of node u.
+ * @param neighbours neighbours(u, fn) calls fn(v) for every neighbour v of node u.
+ * @param label label(u) returns the original id of node u.
+ */
+template<typename Vertex>
+template<typename Degree, typename Neighbours, typename Label>
+void tcount::basic_oriented_graph<Vertex>::build(unsigned long n, Degree degree, Neighbours neighbours, Label label) {
+    //counting sort by degree, so ties keep index order
+    unsigned long max_degree = 0;
+    for (unsigned long u = 0; u < n; ++u) {
+        max_degree = std::max(max_degree, static_cast<unsigned long>(degree(u)));
+    }
+
+    std::vector<unsigned long> bucket(max_degree + 2, 0);
+    for (unsigned long u = 0; u < n; ++u) {
+        bucket[degree(u) + 1] += 1;
+    }
+    for (unsigned long d = 1; d < bucket.size(); ++d) {
+        bucket[d] += bucket[d - 1];
+    }
+
+    // node -> rank
+    std::vector<unsigned long> rank(n);
+    this->labels_.resize(n);
+    for (unsigned long u = 0; u < n; ++u) {
+        unsigned long r = bucket[degree(u)]++;
+        rank[u] = r;
+        labels_[r] = label(u);
+    }
+    std::vector<unsigned long>().swap(bucket);
+
+    //count the out degree of every rank, then fill
+    this->node_array_.assign(n + 1, 0);
+    for (unsigned long u = 0; u < n; ++u) {
+        unsigned long ru = rank[u];
+        neighbours(u, [&](unsigned long v) {
+            if (ru < rank[v]) {
+                node_array_[ru + 1] += 1;
+            }
+        });
+    }
+    for (unsigned long r = 0; r < n; ++r) {
+        node_array_[r + 1] += node_array_[r];
+    }
+
+    this->edge_array_.resize(node_array_[n]);
+    std::vector<unsigned long> next(node_array_.begin(), node_array_.end() - 1);
+    for (unsigned long u = 0; u < n; ++u) {
+        unsigned long ru = rank[u];
+        neighbours(u, [&](unsigned long v) {
+            if (ru < rank[v]) {
+                edge_array_[next[ru]++] = static_cast<Vertex>(rank[v]);
+            }
+        });
+    }
+    std::vector<unsigned long>().swap(next);
+    std::vector<unsigned long>().swap(rank);
+
+    //sort every list and squeeze out duplicate edges
+    unsigned long write = 0;
+    unsigned long begin = node_array_[0];
+    for (unsigned long r = 0; r < n; ++r) {
+        unsigned long end = node_array_[r + 1];
+        std::sort(edge_array_.begin() + begin, edge_array_.begin() + end);
+        auto last = std::unique(edge_array_.begin() + begin, edge_array_.begin() + end);
+
+        node_array_[r] = write;
+        write = static_cast<unsigned long>(
+                std::copy(edge_array_.begin() + begin, last, edge_array_.begin() + write) - edge_array_.begin());
+        begin = end;
+    }
+    node_array_[n] = write;
+    edge_array_.resize(write);
+    edge_array_.shrink_to_fit();
+}
+
+/**
+ * Builds the oriented graph from a CSR. Self loops and duplicate edges are dropped.
+ *
+ * @param g The undirected graph to orient.
+ */
+template<typename Vertex>
+template<typename CsrVertex>
+tcount::basic_oriented_graph<Vertex>::basic_oriented_graph(const basic_csr_graph<CsrVertex> &g) {
+    stats::phase_timer timer(stats::phase::preprocess);
+    build(g.number_of_nodes(),
+          [&g](unsigned long u) { return g.degree(u); },
+          [&g](unsigned long u, auto fn) {
+              for (auto p = g.neighbours_begin(u); p != g.neighbours_end(u); ++p) {
+                  fn(*p);
+              }
+          },
+          [&g](unsigned long u) { return g.original_label(u); });
+}
+
+/**
+ * Builds the oriented graph from an adjacency list. Self loops and duplicate edges are dropped.
+ *
+ * @param g The undirected graph to orient.
+ */
+template<typename Vertex>
+tcount::basic_oriented_graph<Vertex>::basic_oriented_graph(adjacency_list_graph &g) {
+    stats::phase_timer timer(stats::phase::preprocess);
+    // index -> node_id, node_id -> index
+    std::vector<unsigned long> ids;
+    std::vector<const std::vector<unsigned long>*> lists;
+    std::unordered_map<unsigned long, unsigned long> index(g.number_of_nodes());
+
+    ids.reserve(g.number_of_nodes());
+    lists.reserve(g.number_of_nodes());
+    for (auto &pair: g) {
+        index[pair.first] = ids.size();
+        ids.push_back(pair.first);
+        lists.push_back(&pair.second);
+    }
+
+    //translate the adjacency lists once so the builder never touches the hash map
+    std::vector<unsigned long> offsets(ids.size() + 1, 0);
+    for (unsigned long u = 0; u < ids.size(); ++u) {
+        offsets[u + 1] = offsets[u] + lists[u]->size();
+    }
+    std::vector<unsigned long> neighbour_index(offsets.back());
+    for (unsigned long u = 0; u < ids.size(); ++u) {
+        unsigned long i = offsets[u];
+        for (auto v: *lists[u]) {
+            neighbour_index[i++] = index[v];
+        }
+    }
+    index.clear();
+
+    build(ids.size(),
+          [&](unsigned long u) { return offsets[u + 1] - offsets[u]; },
+          [&](unsigned long u, auto fn) {
+              for (unsigned long i = offsets[u]; i < offsets[u + 1]; ++i) {
+                  fn(neighbour_index[i]);
+              }
+          },
+          [&](unsigned long u) { return ids[u]; });
+}
+
+template<typename Vertex>
+unsigned long tcount::basic_oriented_graph<Vertex>::number_of_nodes() const {
+    return node_array_.size() - 1;
+}
+
+/**
+ * @return The number of distinct undirected edges, each of which is stored once.
+ */
+template<typename Vertex>
+unsigned long tcount::basic_oriented_graph<Vertex>::number_of_edges() const {
+    return edge_array_.size();
+}
+
+template<typename Vertex>
+const unsigned long* tcount::basic_oriented_graph<Vertex>::node_array() const {
+    return node_array_.data();
+}
+
+template<typename Vertex>
+const Vertex* tcount::basic_oriented_graph<Vertex>::edge_array() const {
+    return edge_array_.data();
+}
+
+template<typename Vertex>
+unsigned long tcount::basic_oriented_graph<Vertex>::out_degree(unsigned long u) const {
+    return node_array_[u + 1] - node_array_[u];
+}
+
+template<typename Vertex>
+const Vertex* tcount::basic_oriented_graph<Vertex>::out_begin(unsigned long u) const {
+    return edge_array_.data() + node_array_[u];
+}
+
+template<typename Vertex>
+const Vertex* tcount::basic_oriented_graph<Vertex>::out_end(unsigned long u) const {
+    return edge_array_.data() + node_array_[u + 1];
+}
+
+/**
+ * @return The id that the node of rank u had in the input graph.
+ */
+template<typename Vertex>
+unsigned long tcount::basic_oriented_graph<Vertex>::original_label(unsigned long u) const {
+    return labels_[u];
+}
+
+/**
+ * @return The bytes taken by the node, edge and label arrays.
+ */
+template<typename Vertex>
+size_t tcount::basic_oriented_graph<Vertex>::memory_bytes() const {
+    return node_array_.size() * sizeof(unsigned long) + edge_array_.size() * sizeof(Vertex) +
+           labels_.size() * sizeof(unsigned long);
+}
+
+/**
+ * @param nodes The number of nodes of a graph.
+ * @return Whether every rank of a graph that size can be stored as a Vertex.
+ */
+template<typename Vertex>
+bool tcount::basic_oriented_graph<Vertex>::fits(unsigned long nodes) {
+    return nodes == 0 || nodes - 1 <= static_cast<unsigned long>(std::numeric_limits<Vertex>::max());
+}
+
+/**
+ * Counts the triangles of an oriented graph exactly. Every triangle u < v < w (by rank) is found
+ * once, as w in the intersection of the out neighbours of u and v.
+ *
+ * @param g The oriented graph.
+ * @return The number of triangles.
+ */
+template<typename Vertex>
+unsigned long long tcount::forward_oriented(const basic_oriented_graph<Vertex> &g) {
+    stats::phase_timer timer(stats::phase::count);
+    stats::local_counters counters;
+    unsigned long long T = 0;
+
+    for (unsigned long u = 0; u < g.number_of_nodes(); ++u) {
+        const Vertex* u_begin = g.out_begin(u);
+        const Vertex* u_end = g.out_end(u);
+
+        for (const Vertex* p = u_begin; p != u_end; ++p) {
+            //only the part of N+(u) after v can be in N+(v)
+            T += intersection_count(p + 1, static_cast<size_t>(u_end - p - 1), g.out_begin(*p), g.out_degree(*p));
+            counters.add(stats::counter::elements_compared, static_cast<size_t>(u_end - p - 1) + g.out_degree(*p));
+        }
+        counters.add(stats::counter::intersections, g.out_degree(u));
+    }
+
+    return T;
+}
+
+/**
+ * Counts the triangles of an oriented graph exactly on several threads.
+ *
+ * The work is split by oriented edge rather than by node: threads claim small chunks of the edge
+ * array, one intersection per edge, so the edges of a hub are spread over many chunks and no single
+ * thread is left with all of its work. Each thread counts into its own 64 bit total.
+ *
+ * @param g The oriented graph.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @return The number of triangles.
+ */
+template<typename Vertex>
+unsigned long long tcount::forward_oriented(const basic_oriented_graph<Vertex> &g, unsigned int threads) {
+    return forward_parallel(g, threads, nullptr);
+}
+
+/**
+ * Counts the triangles of an oriented graph exactly on several threads, intersecting against the
+ * bitmaps of its hubs where it can.
+ *
+ * @param g The oriented graph.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @param hubs Optional bitmaps of the out neighbours of the high out degree nodes of g.
+ * @return The number of triangles.
+ */
+template<typename Vertex>
+unsigned long long tcount::forward_oriented(const basic_oriented_graph<Vertex> &g, unsigned int threads, const hub_index* hubs) {
+    return forward_parallel(g, threads, hubs);
+}
+
+/**
+ * Orients a CSR graph and counts its triangles exactly, with 32 bit ranks whenever they fit.
+ *
+ * @param g The undirected graph.
+ * @return The number of triangles.
+ */
+template<typename Vertex>
+unsigned long long tcount::forward_oriented(const basic_csr_graph<Vertex> &g) {
+    if (compact_oriented_graph::fits(g.number_of_nodes())) {
+        return forward_oriented(compact_oriented_graph(g));
+    }
+    return forward_oriented(oriented_graph(g));
+}
+
+template class tcount::basic_oriented_graph<unsigned int>;
+template class tcount::basic_oriented_graph<unsigned long>;
+template tcount::basic_oriented_graph<unsigned int>::basic_oriented_graph(const compact_csr_graph &g);
+template tcount::basic_oriented_graph<unsigned int>::basic_oriented_graph(const csr_graph &g);
+template tcount::basic_oriented_graph<unsigned long>::basic_oriented_graph(const compact_csr_graph &g);
+template tcount::basic_oriented_graph<unsigned long>::basic_oriented_graph(const csr_graph &g);
+template unsigned long long tcount::forward_oriented(const compact_csr_graph &g);
+template unsigned long long tcount::forward_oriented(const csr_graph &g);
+template unsigned long long tcount::forward_oriented(const compact_oriented_graph &g);
+template unsigned long long tcount::forward_oriented(const oriented_graph &g);
+template unsigned long long tcount::forward_oriented(const compact_oriented_graph &g, unsigned int threads);
+template unsigned long long tcount::forward_oriented(const oriented_graph &g, unsigned int threads);
+template unsigned long long tcount::forward_oriented(const compact_oriented_graph &g, unsigned int threads,
+                                                     const hub_index* hubs);
+template unsigned long long tcount::forward_oriented(const oriented_graph &g, unsigned int threads, const hub_index* hubs);
@@ -0,0 +1,65 @@
+//
+// A degree oriented CSR graph, where every undirected edge is stored once from the endpoint of lower
+// degree rank to the endpoint of higher rank, and the exact forward algorithm that runs on it.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_ORIENTED_GRAPH_H
+#define TRIANGLECOUNTINGAPI_ORIENTED_GRAPH_H
+
+#include <vector>
+#include "adjacency_list_graph.h"
+#include "csr_graph.h"
+#include "hub_index.h"
+
+namespace tcount {
+    /*
+     * Vertex is the type of the ranks in the edge array. Ranks are 0..n-1, so any graph of fewer
+     * than 2^32 nodes fits in unsigned int, which halves the edge array and doubles the number of
+     * ids in every SIMD register. Offsets and labels stay unsigned long, as the number of edges
+     * and the original ids are not bounded by n.
+     */
+    template<typename Vertex>
+    class basic_oriented_graph {
+        std::vector<unsigned long> node_array_;
+        std::vector<Vertex> edge_array_;
+        std::vector<unsigned long> labels_;
+
+    public:
+        typedef Vertex vertex_type;
+
+        template<typename CsrVertex>
+        explicit basic_oriented_graph(const basic_csr_graph<CsrVertex> &g);
+        explicit basic_oriented_graph(adjacency_list_graph &g);
+        unsigned long number_of_nodes() const;
+        unsigned long number_of_edges() const;
+        const unsigned long* node_array() const;
+        const Vertex* edge_array() const;
+        unsigned long out_degree(unsigned long u) const;
+        const Vertex* out_begin(unsigned long u) const;
+        const Vertex* out_end(unsigned long u) const;
+        unsigned long original_label(unsigned long u) const;
+        size_t memory_bytes() const;
+
+        static bool fits(unsigned long nodes);
+
+    private:
+        template<typename Degree, typename Neighbours, typename Label>
+        void build(unsigned long n, Degree degree, Neighbours neighbours, Label label);
+    };
+
+    typedef basic_oriented_graph<unsigned long> oriented_graph;
+    typedef basic_oriented_graph<unsigned int> compact_oriented_graph;
+}
+
+namespace tcount {
+    template<typename Vertex>
+    unsigned long long forward_oriented(const basic_oriented_graph<Vertex> &g);
+    template<typename Vertex>
+    unsigned long long forward_oriented(const basic_oriented_graph<Vertex> &g, unsigned int threads);
+    template<typename Vertex>
+    unsigned long long forward_oriented(const basic_oriented_graph<Vertex> &g, unsigned int threads, const hub_index* hubs);
+    template<typename Vertex>
+    unsigned long long forward_oriented(const basic_csr_graph<Vertex> &g);
+}
+
+#endif //TRIANGLECOUNTINGAPI_ORIENTED_GRAPH_H
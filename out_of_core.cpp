@@ -0,0 +1,658 @@
+//
+// Exact triangle counting for graphs whose edges do not fit in memory: the degree oriented edges
+// are split into partitions on disk, and pairs of partitions are streamed through a fixed budget.
+//
+
+#include "out_of_core.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <queue>
+#include <stdexcept>
+#include "csr_graph.h"
+#include "edge_list_reader.h"
+#include "intersection.h"
+#include "parallel.h"
+#include "stats.h"
+
+namespace {
+    // smallest partition, in words, however small the budget
+    const size_t MIN_PARTITION_WORDS = 1u << 12;
+    // smallest run of the external sort of node ids, in words
+    const size_t MIN_RUN_WORDS = 1u << 12;
+    // smallest write buffer of a partition, in edges
+    const size_t MIN_BUFFER_PAIRS = 256;
+    // ranks are held in 32 bits up to this many nodes
+    const unsigned long RANK32_NODES = 1ul << 32;
+    // nodes of a partition claimed by a thread at a time
+    const size_t NODE_GRAIN = 256;
+
+    // text parsed per thread at a time, at most
+    const size_t MAX_CHUNK_BYTES = 8u << 20;
+    const size_t MIN_CHUNK_BYTES = 64u << 10;
+
+    // the reader holds two windows of parsed edges, each up to twice its text
+    const size_t READER_BYTES_PER_CHUNK = 4;
+
+    /**
+     * Calls fn(edges, count) for every batch of edges in a text edge list or a .tcsr file, without
+     * holding more than a window of them in memory.
+     */
+    template<typename Fn>
+    void for_each_input_batch(const char* filename, unsigned int threads, size_t chunk_bytes, Fn fn) {
+        if (tcount::csr_graph::is_csr_file(filename)) {
+            tcount::csr_graph graph(filename);
+            graph.for_each_batch(fn);
+        }
+        else {
+            tcount::edge_list_reader reader(filename, threads);
+            reader.set_chunk_bytes(chunk_bytes);
+            reader.for_each_batch(fn);
+        }
+    }
+
+    void write_words(FILE* file, const unsigned long* words, size_t count, const std::string &name) {
+        if (count != 0 && fwrite(words, sizeof(unsigned long), count, file) != count) {
+            fclose(file);
+            throw std::runtime_error("failed writing " + name);
+        }
+    }
+
+    void read_words(FILE* file, unsigned long* words, size_t count, const std::string &name) {
+        if (count != 0 && fread(words, sizeof(unsigned long), count, file) != count) {
+            fclose(file);
+            throw std::runtime_error(name + " is truncated");
+        }
+    }
+
+    // a scratch file, removed when it goes out of scope
+    class temp_file {
+        std::string name;
+
+    public:
+        explicit temp_file(std::string name) : name(std::move(name)) {}
+        ~temp_file() {
+            std::remove(name.c_str());
+        }
+        temp_file(const temp_file&) = delete;
+        temp_file& operator=(const temp_file&) = delete;
+
+        FILE* open(const char* mode) const {
+            FILE* file = fopen(name.c_str(), mode);
+            if (file == nullptr) {
+                throw std::runtime_error("cannot open " + name);
+            }
+            return file;
+        }
+    };
+}
+
+/**
+ * @param memory_budget The bytes the counter may take in memory at once. The per node arrays, three
+ * to four words per node, and the windows of text being parsed come out of it first, and the edges
+ * are partitioned to fit what is left.
+ * @param temp_dir The directory the partitions are written to. They are removed once counted.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ */
+tcount::out_of_core_counter::out_of_core_counter(size_t memory_budget, std::string temp_dir, unsigned int threads)
+        : memory_budget(memory_budget), temp_dir(std::move(temp_dir)), threads(threads),
+          bytes_read_(0), bytes_written_(0) {
+    if (this->threads == 0) {
+        this->threads = default_threads();
+    }
+    //a sixteenth of the budget is text being parsed
+    this->chunk_bytes = std::min(MAX_CHUNK_BYTES, std::max(MIN_CHUNK_BYTES, memory_budget / 16 / this->threads));
+}
+
+tcount::out_of_core_counter::~out_of_core_counter() {
+    remove_files();
+}
+
+/**
+ * Counts the triangles of a graph exactly, holding at most three partitions of its oriented edges
+ * in memory: the one whose edges are being closed, the one holding the out neighbours of their
+ * targets, and the next one, read in the background while the other two are intersected.
+ *
+ * Every triangle u < v < w (by rank) is counted once, when the partition of u meets the partition
+ * of v. For P partitions that takes P (P + 1) / 2 partition reads, all of them sequential, so as the
+ * budget shrinks the count slows down by the extra reading rather than failing.
+ *
+ * @param filename A text edge list or a .tcsr file. It is read four times, sequentially, or more
+ * if the budget is too small to buffer every partition at once.
+ * @return The number of triangles.
+ */
+unsigned long long tcount::out_of_core_counter::count_triangles(const char* filename) {
+    remove_files();
+    bytes_read_ = 0;
+    bytes_written_ = 0;
+    {
+        stats::phase_timer timer(stats::phase::build);
+        write_partitions(filename);
+    }
+    stats::phase_timer timer(stats::phase::count);
+
+    auto partitions = number_of_partitions();
+    std::vector<unsigned int> order;
+    for (unsigned int i = 0; i < partitions; ++i) {
+        for (unsigned int j = i; j < partitions; ++j) {
+            order.push_back(j);
+        }
+    }
+
+    unsigned long long T = 0;
+    if (!order.empty()) {
+        auto pending = std::async(std::launch::async, &out_of_core_counter::load_partition, this, order[0]);
+        partition resident;
+        size_t k = 0;
+
+        for (unsigned int i = 0; i < partitions; ++i) {
+            for (unsigned int j = i; j < partitions; ++j, ++k) {
+                partition current = pending.get();
+                if (k + 1 < order.size()) {
+                    pending = std::async(std::launch::async, &out_of_core_counter::load_partition, this, order[k + 1]);
+                }
+
+                if (j == i) {
+                    resident = std::move(current);
+                    T += count_pair(resident, resident);
+                }
+                else {
+                    T += count_pair(resident, current);
+                }
+            }
+        }
+    }
+
+    remove_files();
+    return T;
+}
+
+/**
+ * @return The number of partitions the last graph was split into.
+ */
+unsigned int tcount::out_of_core_counter::number_of_partitions() const {
+    return bounds.empty() ? 0 : static_cast<unsigned int>(bounds.size() - 1);
+}
+
+/**
+ * @return The bytes of partitions read back from disk while counting the last graph.
+ */
+unsigned long long tcount::out_of_core_counter::bytes_read() const {
+    return bytes_read_;
+}
+
+/**
+ * @return The bytes of partitions written to disk while counting the last graph.
+ */
+unsigned long long tcount::out_of_core_counter::bytes_written() const {
+    return bytes_written_;
+}
+
+/**
+ * Orients the edges of the input by degree and writes them to partition files, each holding the
+ * out neighbours of a range of ranks, sorted and free of duplicates.
+ *
+ * The input is read once for the largest id, once to number the nodes and count their degrees,
+ * once for the out degrees that decide the partition ranges, and once to write the edges out
+ * through a buffer per partition, or once per group of partitions if a buffer for every partition
+ * would not fit the budget.
+ *
+ * Node ids below the number of edges index the per node arrays directly. Larger ids are numbered
+ * by an external sort, so only the distinct ids are ever held, and looked up by binary search.
+ * Ranks take 32 bits when they fit. The per node arrays count against the budget, and the edges
+ * get what they leave.
+ *
+ * @throws std::runtime_error If the per node arrays alone take the whole budget.
+ */
+void tcount::out_of_core_counter::write_partitions(const char* filename) {
+    unsigned long max_id = 0;
+    unsigned long long edges = 0;
+    for_each_input_batch(filename, threads, chunk_bytes, [&](const edge* batch, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (batch[i].first != batch[i].second) {
+                max_id = std::max(max_id, std::max(batch[i].first, batch[i].second));
+                edges += 1;
+            }
+        }
+    });
+    if (edges == 0) {
+        bounds.clear();
+        return;
+    }
+
+    //number the nodes, and count their degrees
+    bool dense = max_id < edges;
+    std::vector<unsigned long> ids;
+    std::vector<unsigned long> degree;
+    if (dense) {
+        check_node_budget(max_id + 1, false);
+        degree.assign(max_id + 1, 0);
+        for_each_input_batch(filename, threads, chunk_bytes, [&](const edge* batch, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                if (batch[i].first != batch[i].second) {
+                    degree[batch[i].first] += 1;
+                    degree[batch[i].second] += 1;
+                }
+            }
+        });
+    }
+    else {
+        number_nodes(filename, ids, degree);
+    }
+    unsigned long n = degree.size();
+    check_node_budget(n, !dense);
+    auto index_of = [&](unsigned long id) {
+        return dense ? id : static_cast<unsigned long>(std::lower_bound(ids.begin(), ids.end(), id) - ids.begin());
+    };
+
+    //counting sort by degree, so ties keep index order, as oriented_graph does; degrees only
+    //exceed n through duplicate edges, and are capped there so the buckets stay per node
+    bool narrow = n <= RANK32_NODES;
+    std::vector<unsigned int> rank32(narrow ? n : 0);
+    std::vector<unsigned long> rank64(narrow ? 0 : n);
+    {
+        std::vector<unsigned long> next(n + 1, 0);
+        for (unsigned long d: degree) {
+            next[std::min(d, n - 1) + 1] += 1;
+        }
+        for (unsigned long d = 0; d < n; ++d) {
+            next[d + 1] += next[d];
+        }
+        for (unsigned long u = 0; u < n; ++u) {
+            unsigned long r = next[std::min(degree[u], n - 1)]++;
+            if (narrow) {
+                rank32[u] = static_cast<unsigned int>(r);
+            }
+            else {
+                rank64[u] = r;
+            }
+        }
+    }
+    auto rank_of = [&](unsigned long id) {
+        unsigned long u = index_of(id);
+        return narrow ? static_cast<unsigned long>(rank32[u]) : rank64[u];
+    };
+
+    //the degrees are done with, so the same array counts the out degree of every rank
+    std::vector<unsigned long> &out_degree = degree;
+    std::fill(out_degree.begin(), out_degree.end(), 0);
+    for_each_input_batch(filename, threads, chunk_bytes, [&](const edge* batch, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (batch[i].first != batch[i].second) {
+                out_degree[std::min(rank_of(batch[i].first), rank_of(batch[i].second))] += 1;
+            }
+        }
+    });
+
+    //counting holds three partitions at once, and sorting one takes its pairs plus its CSR, three
+    //words per edge either way
+    size_t edge_budget = memory_budget - node_bytes(n, !dense) - reader_bytes();
+    size_t partition_words = std::max(MIN_PARTITION_WORDS, edge_budget / sizeof(unsigned long) / 3);
+    bounds.assign(1, 0);
+    size_t words = 0;
+    for (unsigned long r = 0; r < n; ++r) {
+        //a partition always takes at least one node, however many edges it has
+        if (words > 0 && words + out_degree[r] + 1 > partition_words) {
+            bounds.push_back(r);
+            words = 0;
+        }
+        words += out_degree[r] + 1;
+    }
+    bounds.push_back(n);
+
+    auto tag = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    for (unsigned int i = 0; i < number_of_partitions(); ++i) {
+        files.push_back(temp_dir + "/tcount-" + tag + "-" + std::to_string(i) + ".part");
+        FILE* file = fopen(files.back().c_str(), "wb");
+        if (file == nullptr) {
+            throw std::runtime_error("cannot create " + files.back());
+        }
+        fclose(file);
+    }
+
+    //the edge budget is shared out as one write buffer per partition; if that leaves less than
+    //MIN_BUFFER_PAIRS each, the partitions are written a group at a time, one pass per group
+    size_t budget_pairs = std::max<size_t>(MIN_BUFFER_PAIRS, edge_budget / (2 * sizeof(unsigned long)));
+    unsigned int group = static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(number_of_partitions(),
+                                                                                        budget_pairs / MIN_BUFFER_PAIRS)));
+    std::vector<std::vector<unsigned long>> buffers(number_of_partitions());
+    auto flush = [&](unsigned int i) {
+        FILE* file = fopen(files[i].c_str(), "ab");
+        if (file == nullptr) {
+            throw std::runtime_error("cannot open " + files[i]);
+        }
+        write_words(file, buffers[i].data(), buffers[i].size(), files[i]);
+        fclose(file);
+        bytes_written_ += buffers[i].size() * sizeof(unsigned long);
+        buffers[i].clear();
+    };
+
+    for (unsigned int first = 0; first < number_of_partitions(); first += group) {
+        unsigned int last = std::min(number_of_partitions(), first + group);
+        size_t buffer_pairs = budget_pairs / (last - first);
+        unsigned long lo = bounds[first], hi = bounds[last];
+
+        for_each_input_batch(filename, threads, chunk_bytes, [&](const edge* batch, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                if (batch[i].first == batch[i].second) {
+                    continue;
+                }
+                unsigned long ru = rank_of(batch[i].first);
+                unsigned long rv = rank_of(batch[i].second);
+                unsigned long from = std::min(ru, rv);
+                if (from < lo || from >= hi) {
+                    continue;
+                }
+                auto p = static_cast<unsigned int>(std::upper_bound(bounds.begin(), bounds.end(), from) - bounds.begin() - 1);
+                if (buffers[p].capacity() == 0) {
+                    buffers[p].reserve(2 * buffer_pairs);
+                }
+                buffers[p].push_back(from);
+                buffers[p].push_back(std::max(ru, rv));
+                if (buffers[p].size() >= 2 * buffer_pairs) {
+                    flush(p);
+                }
+            }
+        });
+        for (unsigned int i = first; i < last; ++i) {
+            flush(i);
+            buffers[i] = std::vector<unsigned long>();
+        }
+    }
+    buffers = std::vector<std::vector<unsigned long>>();
+    rank32 = std::vector<unsigned int>();
+    rank64 = std::vector<unsigned long>();
+    ids = std::vector<unsigned long>();
+
+    for (unsigned int i = 0; i < number_of_partitions(); ++i) {
+        sort_partition(i, out_degree);
+    }
+}
+
+/**
+ * Numbers the distinct node ids of the input in ascending order and counts their degrees with an
+ * external sort. Runs of endpoints filling half the budget are sorted and written out as (id,
+ * occurrences) pairs, then all runs are merged through one buffer each, together taking the same
+ * half, so the only thing that grows with the graph is the result.
+ *
+ * @param filename The input.
+ * @param ids Receives the distinct ids, sorted, so a node's index is found by binary search.
+ * @param degree Receives the number of edges at every node, duplicates included.
+ * @throws std::runtime_error If the ids and degrees alone outgrow the budget.
+ */
+void tcount::out_of_core_counter::number_nodes(const char* filename, std::vector<unsigned long> &ids,
+                                               std::vector<unsigned long> &degree) {
+    size_t run_words = std::max(MIN_RUN_WORDS, (memory_budget - std::min(memory_budget, reader_bytes())) / sizeof(unsigned long) / 2);
+    std::string name = temp_dir + "/tcount-" +
+                       std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".ids";
+    temp_file runs_file(name);
+    FILE* file = runs_file.open("wb");
+    std::vector<unsigned long long> run_start, run_size;
+
+    std::vector<unsigned long> run;
+    run.reserve(run_words);
+    std::vector<unsigned long> out;
+    out.reserve(MIN_RUN_WORDS);
+    auto write_run = [&]() {
+        std::sort(run.begin(), run.end());
+        run_start.push_back(run_start.empty() ? 0 : run_start.back() + run_size.back());
+        run_size.push_back(0);
+        for (size_t i = 0; i < run.size();) {
+            size_t j = i;
+            while (j < run.size() && run[j] == run[i]) {
+                ++j;
+            }
+            out.push_back(run[i]);
+            out.push_back(j - i);
+            if (out.size() >= MIN_RUN_WORDS) {
+                write_words(file, out.data(), out.size(), name);
+                run_size.back() += out.size();
+                out.clear();
+            }
+            i = j;
+        }
+        write_words(file, out.data(), out.size(), name);
+        run_size.back() += out.size();
+        bytes_written_ += run_size.back() * sizeof(unsigned long);
+        out.clear();
+        run.clear();
+    };
+
+    for_each_input_batch(filename, threads, chunk_bytes, [&](const edge* batch, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (batch[i].first == batch[i].second) {
+                continue;
+            }
+            if (run.size() + 2 > run_words) {
+                write_run();
+            }
+            run.push_back(batch[i].first);
+            run.push_back(batch[i].second);
+        }
+    });
+    if (!run.empty()) {
+        write_run();
+    }
+    run = std::vector<unsigned long>();
+    out = std::vector<unsigned long>();
+    if (fclose(file) != 0) {
+        throw std::runtime_error("failed writing " + name);
+    }
+
+    //merge the runs, refilling the buffer of a run from its place in the file when it empties
+    size_t runs = run_start.size();
+    size_t buffer_words = std::max<size_t>(2 * MIN_BUFFER_PAIRS, run_words / runs) & ~static_cast<size_t>(1);
+    std::vector<std::vector<unsigned long>> buffers(runs);
+    std::vector<size_t> position(runs, 0);
+    file = runs_file.open("rb");
+    auto refill = [&](size_t r) {
+        size_t words = static_cast<size_t>(std::min<unsigned long long>(buffer_words, run_size[r]));
+        buffers[r].resize(words);
+        position[r] = 0;
+        if (words == 0) {
+            return false;
+        }
+        if (fseek(file, static_cast<long>(run_start[r] * sizeof(unsigned long)), SEEK_SET) != 0) {
+            fclose(file);
+            throw std::runtime_error("failed reading " + name);
+        }
+        read_words(file, buffers[r].data(), words, name);
+        bytes_read_ += words * sizeof(unsigned long);
+        run_start[r] += words;
+        run_size[r] -= words;
+        return true;
+    };
+
+    typedef std::pair<unsigned long, size_t> head;
+    std::priority_queue<head, std::vector<head>, std::greater<head>> heads;
+    for (size_t r = 0; r < runs; ++r) {
+        if (refill(r)) {
+            heads.emplace(buffers[r][0], r);
+        }
+    }
+    size_t merge_bytes = runs * buffer_words * sizeof(unsigned long);
+    while (!heads.empty()) {
+        size_t r = heads.top().second;
+        heads.pop();
+        unsigned long id = buffers[r][position[r]];
+        if (ids.empty() || ids.back() != id) {
+            if ((ids.size() + 1) * 2 * sizeof(unsigned long) + merge_bytes > memory_budget) {
+                fclose(file);
+                throw std::runtime_error("the node ids alone need more than the memory budget");
+            }
+            ids.push_back(id);
+            degree.push_back(0);
+        }
+        degree.back() += buffers[r][position[r] + 1];
+
+        position[r] += 2;
+        if (position[r] < buffers[r].size() || refill(r)) {
+            heads.emplace(buffers[r][position[r]], r);
+        }
+    }
+    fclose(file);
+    ids.shrink_to_fit();
+    degree.shrink_to_fit();
+}
+
+/**
+ * @return The most bytes the per node arrays take at once for n nodes: the degrees, the ranks and
+ * the buckets they are sorted into, and the sorted ids if the ids are not used as indices.
+ */
+size_t tcount::out_of_core_counter::node_bytes(unsigned long n, bool numbered) {
+    size_t rank_bytes = n <= RANK32_NODES ? sizeof(unsigned int) : sizeof(unsigned long);
+    size_t per_node = 2 * sizeof(unsigned long) + rank_bytes + (numbered ? sizeof(unsigned long) : 0);
+    return (n + 1) * per_node;
+}
+
+/**
+ * @return The bytes of edges the reader parses ahead, which are held while the edges are written out.
+ */
+size_t tcount::out_of_core_counter::reader_bytes() const {
+    return READER_BYTES_PER_CHUNK * chunk_bytes * threads;
+}
+
+/**
+ * @throws std::runtime_error If the per node arrays for n nodes, with the reader's windows, leave
+ * nothing of the budget for edges.
+ */
+void tcount::out_of_core_counter::check_node_budget(unsigned long n, bool numbered) const {
+    size_t needed = node_bytes(n, numbered) + reader_bytes();
+    if (needed >= memory_budget) {
+        throw std::runtime_error("the per node arrays of " + std::to_string(n) + " nodes and the input windows need " +
+                                 std::to_string((needed + (1u << 20) - 1) >> 20) + " MiB, more than the memory budget of " +
+                                 std::to_string(memory_budget >> 20) + " MiB");
+    }
+}
+
+/**
+ * Replaces the edge pairs of a partition file with the partition's CSR: a header of the first
+ * rank, the number of nodes and the number of edges, then the offsets and the sorted targets.
+ */
+void tcount::out_of_core_counter::sort_partition(unsigned int i, std::vector<unsigned long> &out_degree) {
+    unsigned long first = bounds[i];
+    unsigned long nodes = bounds[i + 1] - first;
+
+    partition part;
+    part.first = first;
+    part.offsets.assign(nodes + 1, 0);
+    for (unsigned long u = 0; u < nodes; ++u) {
+        part.offsets[u + 1] = part.offsets[u] + out_degree[first + u];
+    }
+    part.targets.resize(part.offsets[nodes]);
+
+    std::vector<unsigned long> pairs(part.targets.size() * 2);
+    FILE* file = fopen(files[i].c_str(), "rb");
+    if (file == nullptr) {
+        throw std::runtime_error("cannot open " + files[i]);
+    }
+    read_words(file, pairs.data(), pairs.size(), files[i]);
+    fclose(file);
+    bytes_read_ += pairs.size() * sizeof(unsigned long);
+
+    std::vector<unsigned long> position(part.offsets.begin(), part.offsets.end() - 1);
+    for (size_t k = 0; k < pairs.size(); k += 2) {
+        part.targets[position[pairs[k] - first]++] = pairs[k + 1];
+    }
+    pairs = std::vector<unsigned long>();
+
+    //sort every list and squeeze out duplicate edges
+    std::vector<unsigned long> sizes(nodes);
+    parallel_for_dynamic(0, nodes, NODE_GRAIN, threads, [&](unsigned int, size_t lo, size_t hi) {
+        for (size_t u = lo; u < hi; ++u) {
+            auto begin = part.targets.begin() + part.offsets[u];
+            auto end = part.targets.begin() + part.offsets[u + 1];
+            std::sort(begin, end);
+            sizes[u] = static_cast<unsigned long>(std::unique(begin, end) - begin);
+        }
+    });
+    unsigned long written = 0;
+    for (unsigned long u = 0; u < nodes; ++u) {
+        std::move(part.targets.begin() + part.offsets[u], part.targets.begin() + part.offsets[u] + sizes[u],
+                  part.targets.begin() + written);
+        part.offsets[u] = written;
+        written += sizes[u];
+    }
+    part.offsets[nodes] = written;
+    part.targets.resize(written);
+
+    file = fopen(files[i].c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("cannot open " + files[i]);
+    }
+    unsigned long header[3] = {first, nodes, written};
+    write_words(file, header, 3, files[i]);
+    write_words(file, part.offsets.data(), part.offsets.size(), files[i]);
+    write_words(file, part.targets.data(), part.targets.size(), files[i]);
+    if (fclose(file) != 0) {
+        throw std::runtime_error("failed writing " + files[i]);
+    }
+    bytes_written_ += (3 + part.offsets.size() + part.targets.size()) * sizeof(unsigned long);
+}
+
+/**
+ * Reads a sorted partition back with one sequential read per array.
+ */
+tcount::out_of_core_counter::partition tcount::out_of_core_counter::load_partition(unsigned int i) {
+    FILE* file = fopen(files[i].c_str(), "rb");
+    if (file == nullptr) {
+        throw std::runtime_error("cannot open " + files[i]);
+    }
+
+    unsigned long header[3];
+    read_words(file, header, 3, files[i]);
+    partition part;
+    part.first = header[0];
+    part.offsets.resize(header[1] + 1);
+    part.targets.resize(header[2]);
+    read_words(file, part.offsets.data(), part.offsets.size(), files[i]);
+    read_words(file, part.targets.data(), part.targets.size(), files[i]);
+    fclose(file);
+
+    bytes_read_ += (3 + part.offsets.size() + part.targets.size()) * sizeof(unsigned long);
+    return part;
+}
+
+/**
+ * Counts the triangles u < v < w with u in partition a and v in partition b, as w in the
+ * intersection of N+(u) after v and N+(v). The targets of u that fall in b are a contiguous run of
+ * its sorted list.
+ */
+unsigned long long tcount::out_of_core_counter::count_pair(const partition &a, const partition &b) const {
+    unsigned long a_nodes = a.offsets.size() - 1;
+    unsigned long b_last = b.first + b.offsets.size() - 1;
+    std::vector<unsigned long long> totals(threads, 0);
+
+    parallel_for_dynamic(0, a_nodes, NODE_GRAIN, threads, [&](unsigned int t, size_t lo, size_t hi) {
+        unsigned long long T = 0;
+        for (size_t u = lo; u < hi; ++u) {
+            const unsigned long* list = a.targets.data() + a.offsets[u];
+            const unsigned long* list_end = a.targets.data() + a.offsets[u + 1];
+            const unsigned long* p = std::lower_bound(list, list_end, b.first);
+            const unsigned long* p_end = std::lower_bound(p, list_end, b_last);
+
+            for (; p != p_end; ++p) {
+                unsigned long v = *p - b.first;
+                T += intersection_count(p + 1, static_cast<size_t>(list_end - p - 1),
+                                        b.targets.data() + b.offsets[v], b.offsets[v + 1] - b.offsets[v]);
+            }
+        }
+        totals[t] += T;
+    });
+
+    unsigned long long T = 0;
+    for (auto total: totals) {
+        T += total;
+    }
+    return T;
+}
+
+void tcount::out_of_core_counter::remove_files() {
+    for (const auto &name: files) {
+        std::remove(name.c_str());
+    }
+    files.clear();
+}
@@ -0,0 +1,57 @@
+//
+// Exact triangle counting for graphs whose edges do not fit in memory: the degree oriented edges
+// are split into partitions on disk, and pairs of partitions are streamed through a fixed budget.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_OUT_OF_CORE_H
+#define TRIANGLECOUNTINGAPI_OUT_OF_CORE_H
+
+#include <string>
+#include <vector>
+
+namespace tcount {
+    class out_of_core_counter {
+        // one partition of the oriented graph: the out neighbours of the ranks [first, first + nodes)
+        struct partition {
+            unsigned long first = 0;
+            std::vector<unsigned long> offsets;
+            std::vector<unsigned long> targets;
+        };
+
+        size_t memory_budget;
+        std::string temp_dir;
+        unsigned int threads;
+        // bytes of text each thread parses at a time
+        size_t chunk_bytes;
+
+        // first rank of every partition, and one past the last rank
+        std::vector<unsigned long> bounds;
+        std::vector<std::string> files;
+        unsigned long long bytes_read_;
+        unsigned long long bytes_written_;
+
+    public:
+        out_of_core_counter(size_t memory_budget, std::string temp_dir, unsigned int threads = 0);
+        ~out_of_core_counter();
+        out_of_core_counter(const out_of_core_counter&) = delete;
+        out_of_core_counter& operator=(const out_of_core_counter&) = delete;
+
+        unsigned long long count_triangles(const char* filename);
+        unsigned int number_of_partitions() const;
+        unsigned long long bytes_read() const;
+        unsigned long long bytes_written() const;
+
+    private:
+        void write_partitions(const char* filename);
+        void number_nodes(const char* filename, std::vector<unsigned long> &ids, std::vector<unsigned long> &degree);
+        static size_t node_bytes(unsigned long n, bool numbered);
+        size_t reader_bytes() const;
+        void check_node_budget(unsigned long n, bool numbered) const;
+        void sort_partition(unsigned int i, std::vector<unsigned long> &out_degree);
+        partition load_partition(unsigned int i);
+        unsigned long long count_pair(const partition &a, const partition &b) const;
+        void remove_files();
+    };
+}
+
+#endif //TRIANGLECOUNTINGAPI_OUT_OF_CORE_H
@@ -0,0 +1,67 @@
+//
+// Small helpers for running work on a fixed number of std::threads.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_PARALLEL_H
+#define TRIANGLECOUNTINGAPI_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace tcount {
+    /**
+     * @return The number of hardware threads, or 1 if it cannot be determined.
+     */
+    inline unsigned int default_threads() {
+        unsigned int n = std::thread::hardware_concurrency();
+        return n == 0 ? 1 : n;
+    }
+
+    /**
+     * Runs fn(thread_id) once on each of the specified number of threads, the calling thread
+     * being thread 0, and waits for all of them to finish.
+     */
+    template<typename Fn>
+    void parallel_run(unsigned int threads, Fn fn) {
+        if (threads <= 1) {
+            fn(0u);
+            return;
+        }
+
+        std::vector<std::thread> pool;
+        pool.reserve(threads - 1);
+        for (unsigned int t = 1; t < threads; ++t) {
+            pool.emplace_back(fn, t);
+        }
+        fn(0u);
+        for (auto &thread: pool) {
+            thread.join();
+        }
+    }
+
+    /**
+     * Splits [begin, end) into chunks of grain elements which threads claim one at a time until
+     * none are left, calling fn(thread_id, chunk_begin, chunk_end) for each.
+     */
+    template<typename Fn>
+    void parallel_for_dynamic(size_t begin, size_t end, size_t grain, unsigned int threads, Fn fn) {
+        if (grain == 0) {
+            grain = 1;
+        }
+
+        std::atomic<size_t> next(begin);
+        parallel_run(threads, [&](unsigned int thread_id) {
+            for (;;) {
+                size_t lo = next.fetch_add(grain);
+                if (lo >= end) {
+                    break;
+                }
+                fn(thread_id, lo, std::min(end, lo + grain));
+            }
+        });
+    }
+}
+
+#endif //TRIANGLECOUNTINGAPI_PARALLEL_H
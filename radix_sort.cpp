@@ -0,0 +1,95 @@
+//
+// A parallel, stable least significant digit radix sort for unsigned integer keys.
+//
+
+#include "radix_sort.h"
+
+#include <algorithm>
+#include <vector>
+#include "parallel.h"
+
+/**
+ * @return The number of bits needed to represent value, 0 for 0.
+ */
+unsigned int tcount::bits_needed(unsigned long value) {
+    unsigned int bits = 0;
+    while (value != 0) {
+        bits += 1;
+        value >>= 1;
+    }
+    return bits;
+}
+
+/**
+ * Sorts data in ascending order, eight bits per pass. Every thread histograms and then scatters its
+ * own fixed slice of the input, which keeps each pass stable. Passes in which every key has the same
+ * digit are skipped.
+ *
+ * @param data The keys to sort. Holds the sorted keys afterwards.
+ * @param buffer Scratch space for size keys.
+ * @param size The number of keys.
+ * @param key_bits Only the lowest key_bits bits of each key are sorted on; higher bits must be zero.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ */
+void tcount::parallel_radix_sort(unsigned long* data, unsigned long* buffer, size_t size, unsigned int key_bits,
+                                 unsigned int threads) {
+    const unsigned int radix_bits = 8;
+    const size_t radix = 1u << radix_bits;
+
+    if (threads == 0) {
+        threads = default_threads();
+    }
+    //not worth a thread per handful of keys
+    threads = static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(threads, size / 65536)));
+
+    std::vector<size_t> bounds(threads + 1);
+    for (unsigned int t = 0; t <= threads; ++t) {
+        bounds[t] = size / threads * t + std::min<size_t>(t, size % threads);
+    }
+
+    // histogram[t * radix + digit]
+    std::vector<size_t> histogram(threads * radix);
+    unsigned long* from = data;
+    unsigned long* to = buffer;
+
+    for (unsigned int shift = 0; shift < key_bits; shift += radix_bits) {
+        std::fill(histogram.begin(), histogram.end(), 0);
+        parallel_run(threads, [&](unsigned int t) {
+            size_t* h = histogram.data() + t * radix;
+            for (size_t i = bounds[t]; i < bounds[t + 1]; ++i) {
+                h[(from[i] >> shift) & (radix - 1)] += 1;
+            }
+        });
+
+        //turn the counts into write positions, digit major so the sort stays stable
+        size_t offset = 0;
+        bool single_digit = false;
+        for (size_t d = 0; d < radix; ++d) {
+            size_t digit_total = 0;
+            for (unsigned int t = 0; t < threads; ++t) {
+                size_t count = histogram[t * radix + d];
+                histogram[t * radix + d] = offset;
+                offset += count;
+                digit_total += count;
+            }
+            single_digit = single_digit || digit_total == size;
+        }
+        if (single_digit) {
+            continue;
+        }
+
+        parallel_run(threads, [&](unsigned int t) {
+            size_t* position = histogram.data() + t * radix;
+            for (size_t i = bounds[t]; i < bounds[t + 1]; ++i) {
+                to[position[(from[i] >> shift) & (radix - 1)]++] = from[i];
+            }
+        });
+        std::swap(from, to);
+    }
+
+    if (from != data) {
+        parallel_run(threads, [&](unsigned int t) {
+            std::copy(from + bounds[t], from + bounds[t + 1], data + bounds[t]);
+        });
+    }
+}
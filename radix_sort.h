@@ -0,0 +1,16 @@
+//
+// A parallel, stable least significant digit radix sort for unsigned integer keys.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_RADIX_SORT_H
+#define TRIANGLECOUNTINGAPI_RADIX_SORT_H
+
+#include <cstddef>
+
+namespace tcount {
+    unsigned int bits_needed(unsigned long value);
+    void parallel_radix_sort(unsigned long* data, unsigned long* buffer, size_t size, unsigned int key_bits,
+                             unsigned int threads = 0);
+}
+
+#endif //TRIANGLECOUNTINGAPI_RADIX_SORT_H
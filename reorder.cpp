@@ -0,0 +1,348 @@
+//
+// Vertex orderings that lay a CSR out for cache locality, applied before the samplers run on it.
+// The exact engines renumber the nodes by degree rank when they orient the graph, so only ties
+// between equal degrees would keep an ordering there, and they are not reordered.
+//
+
+#include "reorder.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include "parallel.h"
+#include "stats.h"
+
+namespace {
+    // nodes placed before the next one that it is scored against, as in the Gorder paper
+    const unsigned long GORDER_WINDOW = 5;
+    // neighbours of higher degree than this are not walked for siblings: every node of the window
+    // would share them, and walking them costs their degree each time
+    const unsigned long GORDER_MAX_SIBLING_DEGREE = 256;
+
+    // every node, highest degree first, ties in index order
+    std::vector<unsigned long> by_degree(const tcount::csr_graph &g) {
+        std::vector<unsigned long> order(g.number_of_nodes());
+        for (unsigned long u = 0; u < order.size(); ++u) {
+            order[u] = u;
+        }
+        std::stable_sort(order.begin(), order.end(), [&g](unsigned long a, unsigned long b) {
+            return g.degree(a) > g.degree(b);
+        });
+        return order;
+    }
+
+    std::vector<unsigned long> reverse_cuthill_mckee(const tcount::csr_graph &g) {
+        unsigned long n = g.number_of_nodes();
+        std::vector<unsigned long> order;
+        order.reserve(n);
+        std::vector<bool> visited(n, false);
+
+        //every component starts from its lowest degree node
+        std::vector<unsigned long> starts = by_degree(g);
+        std::reverse(starts.begin(), starts.end());
+
+        std::vector<unsigned long> children;
+        for (unsigned long start: starts) {
+            if (visited[start]) {
+                continue;
+            }
+            visited[start] = true;
+            size_t head = order.size();
+            order.push_back(start);
+
+            while (head < order.size()) {
+                unsigned long u = order[head++];
+                children.clear();
+                for (auto p = g.neighbours_begin(u); p != g.neighbours_end(u); ++p) {
+                    if (!visited[*p]) {
+                        visited[*p] = true;
+                        children.push_back(*p);
+                    }
+                }
+                std::sort(children.begin(), children.end(), [&g](unsigned long a, unsigned long b) {
+                    return g.degree(a) < g.degree(b) || (g.degree(a) == g.degree(b) && a < b);
+                });
+                order.insert(order.end(), children.begin(), children.end());
+            }
+        }
+
+        std::reverse(order.begin(), order.end());
+        return order;
+    }
+
+    std::vector<unsigned long> hub_cluster(const tcount::csr_graph &g) {
+        unsigned long n = g.number_of_nodes();
+        double average = n == 0 ? 0.0 : static_cast<double>(g.size_of_edge_array()) / n;
+
+        std::vector<unsigned long> order;
+        order.reserve(n);
+        for (unsigned long u: by_degree(g)) {
+            if (static_cast<double>(g.degree(u)) <= average) {
+                break;
+            }
+            order.push_back(u);
+        }
+        for (unsigned long u = 0; u < n; ++u) {
+            if (static_cast<double>(g.degree(u)) <= average) {
+                order.push_back(u);
+            }
+        }
+        return order;
+    }
+
+    const unsigned long NO_NODE = static_cast<unsigned long>(-1);
+
+    /**
+     * The nodes of positive score, bucketed by score in doubly linked lists, so that a score moves
+     * by one and the highest is found in constant time (the "unit heap" of the Gorder paper).
+     */
+    class score_buckets {
+        std::vector<unsigned long> score;
+        std::vector<unsigned long> next;
+        std::vector<unsigned long> prev;
+        std::vector<unsigned long> head;
+        unsigned long top = 0;
+
+        void unlink(unsigned long u) {
+            if (prev[u] != NO_NODE) {
+                next[prev[u]] = next[u];
+            }
+            else {
+                head[score[u]] = next[u];
+            }
+            if (next[u] != NO_NODE) {
+                prev[next[u]] = prev[u];
+            }
+        }
+
+        void link(unsigned long u) {
+            if (score[u] >= head.size()) {
+                head.resize(score[u] * 2, NO_NODE);
+            }
+            prev[u] = NO_NODE;
+            next[u] = head[score[u]];
+            if (next[u] != NO_NODE) {
+                prev[next[u]] = u;
+            }
+            head[score[u]] = u;
+            top = std::max(top, score[u]);
+        }
+
+    public:
+        explicit score_buckets(unsigned long n) : score(n, 0), next(n, NO_NODE), prev(n, NO_NODE), head(16, NO_NODE) {}
+
+        void increment(unsigned long u) {
+            if (score[u] > 0) {
+                unlink(u);
+            }
+            score[u] += 1;
+            link(u);
+        }
+
+        void decrement(unsigned long u) {
+            unlink(u);
+            score[u] -= 1;
+            if (score[u] > 0) {
+                link(u);
+            }
+        }
+
+        void remove(unsigned long u) {
+            if (score[u] > 0) {
+                unlink(u);
+                score[u] = 0;
+            }
+        }
+
+        // a node of the highest score, or NO_NODE if every score is 0
+        unsigned long highest() {
+            while (top > 0 && head[top] == NO_NODE) {
+                --top;
+            }
+            return top == 0 ? NO_NODE : head[top];
+        }
+    };
+
+    /**
+     * The greedy Gorder heuristic. The score of an unplaced node is the number of edges it has to
+     * the last GORDER_WINDOW placed nodes plus the neighbours it shares with them; the node of the
+     * highest score is placed next. Scores are updated as nodes enter and leave the window.
+     */
+    std::vector<unsigned long> gorder(const tcount::csr_graph &g) {
+        unsigned long n = g.number_of_nodes();
+        std::vector<unsigned long> order;
+        order.reserve(n);
+        std::vector<bool> placed(n, false);
+        score_buckets scores(n);
+
+        auto update = [&](unsigned long x, bool entering) {
+            auto touch = [&](unsigned long y) {
+                if (placed[y]) {
+                    return;
+                }
+                if (entering) {
+                    scores.increment(y);
+                }
+                else {
+                    scores.decrement(y);
+                }
+            };
+            for (auto p = g.neighbours_begin(x); p != g.neighbours_end(x); ++p) {
+                touch(*p);
+                if (g.degree(*p) > GORDER_MAX_SIBLING_DEGREE) {
+                    continue;
+                }
+                for (auto q = g.neighbours_begin(*p); q != g.neighbours_end(*p); ++q) {
+                    if (*q != x) {
+                        touch(*q);
+                    }
+                }
+            }
+        };
+
+        //when nothing scores, start again from the highest degree node left
+        std::vector<unsigned long> fallback = by_degree(g);
+        size_t next_fallback = 0;
+
+        while (order.size() < n) {
+            unsigned long x = scores.highest();
+            if (x == NO_NODE) {
+                while (placed[fallback[next_fallback]]) {
+                    ++next_fallback;
+                }
+                x = fallback[next_fallback];
+            }
+
+            scores.remove(x);
+            placed[x] = true;
+            order.push_back(x);
+            update(x, true);
+            if (order.size() > GORDER_WINDOW) {
+                update(order[order.size() - GORDER_WINDOW - 1], false);
+            }
+        }
+        return order;
+    }
+}
+
+/**
+ * @param name One of original, degree, rcm, hub or gorder.
+ * @return The ordering of that name.
+ */
+tcount::vertex_order tcount::parse_order(const std::string &name) {
+    if (name == "original") {
+        return vertex_order::original;
+    }
+    if (name == "degree") {
+        return vertex_order::degree;
+    }
+    if (name == "rcm") {
+        return vertex_order::rcm;
+    }
+    if (name == "hub") {
+        return vertex_order::hub_cluster;
+    }
+    if (name == "gorder") {
+        return vertex_order::gorder;
+    }
+    throw std::invalid_argument("unknown order " + name + ", expected original, degree, rcm, hub or gorder");
+}
+
+const char* tcount::order_name(vertex_order order) {
+    switch (order) {
+        case vertex_order::degree:
+            return "degree";
+        case vertex_order::rcm:
+            return "rcm";
+        case vertex_order::hub_cluster:
+            return "hub";
+        case vertex_order::gorder:
+            return "gorder";
+        default:
+            return "original";
+    }
+}
+
+/**
+ * @param g The graph, with sorted or unsorted neighbour lists.
+ * @param order The ordering.
+ * @return The permutation: order[i] is the node of g that becomes node i.
+ */
+std::vector<unsigned long> tcount::compute_order(const csr_graph &g, vertex_order order) {
+    stats::phase_timer timer(stats::phase::preprocess);
+    switch (order) {
+        case vertex_order::degree:
+            return by_degree(g);
+        case vertex_order::rcm:
+            return reverse_cuthill_mckee(g);
+        case vertex_order::hub_cluster:
+            return hub_cluster(g);
+        case vertex_order::gorder:
+            return gorder(g);
+        default: {
+            std::vector<unsigned long> identity(g.number_of_nodes());
+            for (unsigned long u = 0; u < identity.size(); ++u) {
+                identity[u] = u;
+            }
+            return identity;
+        }
+    }
+}
+
+/**
+ * Renumbers the nodes of a graph. The labels are carried along, so original_label still gives the
+ * id every node had in the input, and a .tcsr file saved from the result keeps the permutation.
+ *
+ * @param g The graph.
+ * @param order The permutation: order[i] is the node of g that becomes node i.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @return The renumbered graph, with sorted neighbour lists.
+ * @throws std::invalid_argument If order is not a permutation of the nodes of g.
+ */
+tcount::csr_graph tcount::reorder(const csr_graph &g, const std::vector<unsigned long> &order, unsigned int threads) {
+    if (threads == 0) {
+        threads = default_threads();
+    }
+    stats::phase_timer timer(stats::phase::preprocess);
+    unsigned long n = g.number_of_nodes();
+    if (order.size() != n) {
+        throw std::invalid_argument("the order must hold every node exactly once");
+    }
+
+    //n marks a node not placed yet, so a repeated or out of range entry is caught before it is used
+    std::vector<unsigned long> position(n, n);
+    for (unsigned long i = 0; i < n; ++i) {
+        if (order[i] >= n || position[order[i]] != n) {
+            throw std::invalid_argument("the order must hold every node exactly once, but entry " +
+                                        std::to_string(i) + " is " + std::to_string(order[i]));
+        }
+        position[order[i]] = i;
+    }
+
+    std::vector<unsigned long> node_array(n + 1, 0);
+    std::vector<unsigned long> labels(n);
+    for (unsigned long i = 0; i < n; ++i) {
+        node_array[i + 1] = node_array[i] + g.degree(order[i]);
+        labels[i] = g.original_label(order[i]);
+    }
+
+    std::vector<unsigned long> edge_array(node_array[n]);
+    parallel_for_dynamic(0, n, 1024, threads, [&](unsigned int, size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) {
+            unsigned long* out = edge_array.data() + node_array[i];
+            for (auto p = g.neighbours_begin(order[i]); p != g.neighbours_end(order[i]); ++p) {
+                *out++ = position[*p];
+            }
+            std::sort(edge_array.data() + node_array[i], out);
+        }
+    });
+
+    return csr_graph(std::move(node_array), std::move(edge_array), std::move(labels), true);
+}
+
+/**
+ * Computes an ordering of a graph and renumbers its nodes by it.
+ */
+tcount::csr_graph tcount::reorder(const csr_graph &g, vertex_order order, unsigned int threads) {
+    return reorder(g, compute_order(g, order), threads);
+}
@@ -0,0 +1,36 @@
+//
+// Vertex orderings that lay a CSR out for cache locality, applied before the samplers run on it.
+// The exact engines renumber the nodes by degree rank when they orient the graph, so only ties
+// between equal degrees would keep an ordering there, and they are not reordered.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_REORDER_H
+#define TRIANGLECOUNTINGAPI_REORDER_H
+
+#include <string>
+#include <vector>
+#include "csr_graph.h"
+
+namespace tcount {
+    enum class vertex_order {
+        // as built
+        original,
+        // highest degree first
+        degree,
+        // reverse Cuthill-McKee: breadth first, lowest degree neighbours first, reversed
+        rcm,
+        // hub clustering: the nodes of above average degree first, by degree, the rest in order
+        hub_cluster,
+        // Gorder: greedily place next the node sharing the most neighbours and edges with the
+        // nodes just placed
+        gorder
+    };
+
+    vertex_order parse_order(const std::string &name);
+    const char* order_name(vertex_order order);
+    std::vector<unsigned long> compute_order(const csr_graph &g, vertex_order order);
+    csr_graph reorder(const csr_graph &g, const std::vector<unsigned long> &order, unsigned int threads = 0);
+    csr_graph reorder(const csr_graph &g, vertex_order order, unsigned int threads = 0);
+}
+
+#endif //TRIANGLECOUNTINGAPI_REORDER_H
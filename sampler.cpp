@@ -2,28 +2,48 @@
 // A class that represents edge sampling that utilizes an adjacency list structure.
 //
 
+#include <algorithm>
 #include <chrono>
 #include <random>
-#include <iostream>
+#include <stdexcept>
 #include "sampler.h"
+#include "stats.h"
 
-tcount::sampler::sampler() {
-    this->g = new std::unordered_map<unsigned long, std::unordered_set<unsigned long>>;
+namespace {
+    // samples drawn together: every pair (u, v) of a batch is drawn first, then intersected
+    const unsigned long SAMPLE_BATCH = 256;
+    // slots are packed two to an edge key
+    const unsigned long MAX_SLOTS = 1ul << 32;
 }
 
-tcount::sampler::~sampler() {
-    delete g;
-}
+tcount::sampler::sampler() = default;
 
 /**
- * Add an edge e = (u, v) to the undirected graph stored in the sampler.
+ * Add an edge e = (u, v) to the undirected graph stored in the sampler. Self loops and edges that
+ * are already in the graph are ignored. Edges can be added between calls to sample_triangles.
  *
  * @param u The node u of edge e
  * @param v The node v of the edge e
  */
 void tcount::sampler::add_edge(unsigned long u, unsigned long v) {
-    (*g)[u].insert(v);
-    (*g)[v].insert(u);
+    if (u == v) {
+        return;
+    }
+    unsigned long a = slot_of(u), b = slot_of(v);
+    unsigned long long key = (static_cast<unsigned long long>(std::min(a, b)) << 32) | std::max(a, b);
+    if (!edges.insert(key).second) {
+        return;
+    }
+    neighbours[a].push_back(b);
+    neighbours[b].push_back(a);
+}
+
+unsigned long tcount::sampler::number_of_nodes() const {
+    return ids.size();
+}
+
+unsigned long tcount::sampler::number_of_edges() const {
+    return edges.size();
 }
 
 /**
@@ -34,49 +54,143 @@ void tcount::sampler::add_edge(unsigned long u, unsigned long v) {
  * @return An approximation of the triangle count of the graph.
  */
 unsigned long tcount::sampler::sample_triangles(unsigned long number_of_samples) {
+    auto seed = static_cast<unsigned long long>(std::chrono::system_clock::now().time_since_epoch().count());
+    return sample_triangles(number_of_samples, seed);
+}
 
-    unsigned int seed = static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count());
-    std::mt19937 mt(seed);
+/**
+ * Samples the specified number of triangles and returns an approximation of the number of
+ * triangles in the undirected graph stored in the sampler.
+ *
+ * @param number_of_samples The number of samples to perform.
+ * @param seed The random seed.
+ * @return An approximation of the triangle count of the graph.
+ */
+unsigned long tcount::sampler::sample_triangles(unsigned long number_of_samples, unsigned long long seed) const {
+    if (number_of_samples == 0 || ids.empty()) {
+        return 0;
+    }
+    stats::phase_timer timer(stats::phase::estimate);
 
+    std::mt19937_64 mt(seed);
+    double estimates[SAMPLE_BATCH];
     double sum = 0;
 
-    for (int i = 0; i < number_of_samples; ++i) {
-        //obtain random node u
-        std::uniform_int_distribution<unsigned int> dist_u(0, static_cast<unsigned int>(g->size() - 1));
-        auto u_itr = g->begin();
-        std::advance(u_itr, dist_u(mt));
-        unsigned long sample_u = (*u_itr).first;
+    for (unsigned long first = 0; first < number_of_samples; first += SAMPLE_BATCH) {
+        unsigned long count = std::min(SAMPLE_BATCH, number_of_samples - first);
+        sample_batch(mt, count, estimates);
+        for (unsigned long i = 0; i < count; ++i) {
+            sum += estimates[i];
+        }
+    }
 
-        //obtain random node v that is a neighbour of u
-        std::uniform_int_distribution<unsigned int> dist_v(0, static_cast<unsigned int>((*u_itr).second.size() - 1));
-        auto v_itr = (*u_itr).second.begin();
-        std::advance(v_itr, dist_v(mt));
-        unsigned long sample_v = (*v_itr);
+    sum /= number_of_samples;
 
-        auto degree_u = (*u_itr).second.size();
-        auto degree_v = (*g)[sample_v].size();
+    return (unsigned long) sum;
+}
 
-        //calculate |N(u) intersect N(v)|
-        unsigned long lambda = 0;
-        auto candidate_iterator = sample_u;
-        auto candidate_comparator = sample_v;
+/**
+ * Samples until the confidence interval of the estimate is within the relative error of the
+ * target, checking after every batch, and returns the estimate with its interval and the number
+ * of samples drawn.
+ *
+ * @param target The relative error and confidence to reach, and the limits on the samples.
+ * @param seed The random seed.
+ * @return The estimate, its confidence interval and the samples it took.
+ */
+tcount::sampling_estimate tcount::sampler::sample_triangles(const sampling_target &target,
+                                                            unsigned long long seed) const {
+    double z = check_target(target);
+    if (ids.empty()) {
+        return sampling_estimate{0.0, 0.0, 0.0, 0, true};
+    }
+    stats::phase_timer timer(stats::phase::estimate);
+
+    std::mt19937_64 mt(seed);
+    double estimates[SAMPLE_BATCH];
+    running_moments moments;
 
-        if (degree_v < degree_u) {
-            candidate_iterator = sample_v;
-            candidate_comparator = sample_u;
+    while (!moments.reached(target, z) && moments.count() < target.max_samples) {
+        unsigned long count = std::min(SAMPLE_BATCH, target.max_samples - moments.count());
+        sample_batch(mt, count, estimates);
+        for (unsigned long i = 0; i < count; ++i) {
+            moments.add(estimates[i]);
         }
+    }
+
+    return moments.estimate(target, z);
+}
+
+/**
+ * Draws a batch of samples: every random pair (u, v) of the batch first, then their intersections.
+ * Nodes and their neighbours are drawn by position from flat arrays, so a sample costs the
+ * intersection of two neighbour lists and nothing that grows with the number of nodes.
+ *
+ * @param mt The random stream.
+ * @param count The number of samples, at most SAMPLE_BATCH.
+ * @param estimates Receives the triangle estimate of every sample.
+ */
+void tcount::sampler::sample_batch(std::mt19937_64 &mt, unsigned long count, double* estimates) const {
+    stats::local_counters counters;
+    counters.add(stats::counter::samples, count);
+    counters.add(stats::counter::intersections, count);
+
+    std::uniform_int_distribution<unsigned long> dist_u(0, ids.size() - 1);
+    std::uniform_int_distribution<unsigned long> dist_v;
+    typedef std::uniform_int_distribution<unsigned long>::param_type range;
+
+    unsigned long batch_u[SAMPLE_BATCH];
+    unsigned long batch_v[SAMPLE_BATCH];
+    double n = static_cast<double>(ids.size());
+
+    //obtain random node u and a random neighbour v of it, for the whole batch
+    for (unsigned long i = 0; i < count; ++i) {
+        unsigned long u = dist_u(mt);
+        batch_u[i] = u;
+        batch_v[i] = neighbours[u][dist_v(mt, range(0, neighbours[u].size() - 1))];
+    }
 
-        for (auto node: (*g)[candidate_iterator]) {
-            if ((*g)[candidate_comparator].find(node) != (*g)[candidate_comparator].end()) {
+    for (unsigned long i = 0; i < count; ++i) {
+        unsigned long u = batch_u[i], v = batch_v[i];
+        auto degree_u = static_cast<double>(neighbours[u].size());
+        auto degree_v = static_cast<double>(neighbours[v].size());
+
+        //calculate |N(u) intersect N(v)|, walking the shorter list
+        unsigned long candidate_iterator = degree_v < degree_u ? v : u;
+        unsigned long candidate_comparator = degree_v < degree_u ? u : v;
+        unsigned long lambda = 0;
+        for (unsigned long w: neighbours[candidate_iterator]) {
+            if (has_edge(w, candidate_comparator)) {
                 lambda += 1;
             }
         }
+        counters.add(stats::counter::elements_compared, neighbours[candidate_iterator].size());
 
-        sum += lambda * ((double) g->size() * (double) degree_u * (double) degree_v) /
-               (3.0 * ((double) degree_u + (double) degree_v));
+        estimates[i] = lambda * (n * degree_u * degree_v) / (3.0 * (degree_u + degree_v));
     }
+}
 
-    sum /= number_of_samples;
+/**
+ * @return The slot of a node id, given the next free slot if the node is new.
+ * @throws std::length_error If the node is new and every slot is taken.
+ */
+unsigned long tcount::sampler::slot_of(unsigned long id) {
+    auto found = slots.find(id);
+    if (found != slots.end()) {
+        return found->second;
+    }
 
-    return (unsigned long) sum;
+    //the slot is only recorded once the node has room, so a refused node leaves nothing behind
+    if (ids.size() == MAX_SLOTS) {
+        throw std::length_error("the sampler holds at most 2^32 nodes");
+    }
+    ids.push_back(id);
+    neighbours.emplace_back();
+    slots.emplace(id, ids.size() - 1);
+    return ids.size() - 1;
+}
+
+bool tcount::sampler::has_edge(unsigned long a, unsigned long b) const {
+    unsigned long long key = (static_cast<unsigned long long>(std::min(a, b)) << 32) | std::max(a, b);
+    return edges.find(key) != edges.end();
 }
@@ -8,16 +8,33 @@
 
 #include <unordered_map>
 #include <unordered_set>
+#include <random>
+#include <vector>
+#include "adaptive_sampling.h"
 
 namespace tcount {
     class sampler {
-        std::unordered_map<unsigned long, std::unordered_set<unsigned long>>* g;
+        // node id -> slot, and slot -> node id, so a node can be drawn by its slot
+        std::unordered_map<unsigned long, unsigned long> slots;
+        std::vector<unsigned long> ids;
+        // the neighbour slots of every slot, so a neighbour can be drawn by its position
+        std::vector<std::vector<unsigned long>> neighbours;
+        // every edge once, as (lower slot << 32) | higher slot, for duplicates and intersections
+        std::unordered_set<unsigned long long> edges;
 
     public:
         sampler();
-        ~sampler();
         void add_edge(unsigned long u, unsigned long v);
+        unsigned long number_of_nodes() const;
+        unsigned long number_of_edges() const;
         unsigned long sample_triangles(unsigned long number_of_samples);
+        unsigned long sample_triangles(unsigned long number_of_samples, unsigned long long seed) const;
+        sampling_estimate sample_triangles(const sampling_target &target, unsigned long long seed) const;
+
+    private:
+        void sample_batch(std::mt19937_64 &mt, unsigned long count, double* estimates) const;
+        unsigned long slot_of(unsigned long id);
+        bool has_edge(unsigned long a, unsigned long b) const;
     };
 }
 
@@ -3,20 +3,45 @@
 //
 
 #include "sampler_edge_array.h"
+#include "intersection.h"
+#include "parallel.h"
+#include "stats.h"
 
+#include <atomic>
 #include <chrono>
 #include <algorithm>
 #include <random>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
-tcount::sampler_edge_array::sampler_edge_array() {
+namespace {
+    // samples per independently seeded block
+    const unsigned long SAMPLE_BLOCK = 1ul << 14;
+}
+
+template<typename Vertex>
+tcount::basic_sampler_edge_array<Vertex>::basic_sampler_edge_array() {
     this->g = new std::unordered_map<unsigned long, std::unordered_set<unsigned long>>;
-    this->node_array = nullptr;
-    this->edge_array = nullptr;
 }
 
-tcount::sampler_edge_array::~sampler_edge_array() {
-    delete (g, node_array, edge_array);
+/**
+ * Creates a sampler over an existing CSR, such as one mapped from a .tcsr file, without copying it.
+ * Edges can no longer be added.
+ *
+ * @param graph The graph to sample from.
+ */
+template<typename Vertex>
+tcount::basic_sampler_edge_array<Vertex>::basic_sampler_edge_array(basic_csr_graph<Vertex> &&graph) {
+    this->g = nullptr;
+    stats::phase_timer timer(stats::phase::preprocess);
+    this->csr = std::move(graph);
+    csr.sort_neighbours();
+}
+
+template<typename Vertex>
+tcount::basic_sampler_edge_array<Vertex>::~basic_sampler_edge_array() {
+    delete g;
 }
 
 /**
@@ -25,7 +50,8 @@ tcount::sampler_edge_array::~sampler_edge_array() {
  * @param u The node u of edge e
  * @param v The node v of the edge e
  */
-void tcount::sampler_edge_array::add_edge(unsigned long u, unsigned long v) {
+template<typename Vertex>
+void tcount::basic_sampler_edge_array<Vertex>::add_edge(unsigned long u, unsigned long v) {
     (*g)[u].insert(v);
     (*g)[v].insert(u);
 }
@@ -35,21 +61,29 @@ void tcount::sampler_edge_array::add_edge(unsigned long u, unsigned long v) {
  *
  * @param relabel If set to true, edges will be re-labeled such that they are consecutive. This
  * should be set to true if nodes added are not consecutively labeled or you are not sure if they are.
+ * @throws std::length_error If there are more nodes than Vertex can number.
  */
-void tcount::sampler_edge_array::build_edge_array(bool relabel) {
+template<typename Vertex>
+void tcount::basic_sampler_edge_array<Vertex>::build_edge_array(bool relabel) {
+    stats::phase_timer timer(stats::phase::build);
+    if (!basic_csr_graph<Vertex>::fits(g->size())) {
+        throw std::length_error("the sampler has " + std::to_string(g->size()) + " nodes, too many for " +
+                                std::to_string(sizeof(Vertex) * 8) + " bit ids");
+    }
     //sort map keys, then build off that
     //or just assume all is okay and work off using the map size
 
-    this->node_array = new std::vector<unsigned long>(g->size() + 1);
-    this->edge_array = new std::vector<unsigned long>;
+    std::vector<unsigned long> node_array(g->size() + 1);
+    std::vector<Vertex> edge_array;
+    //edge_array_label -> g_node_label
+    std::vector<unsigned long> reverse_label;
 
 
     if(relabel) {
         //re-label nodes such that labels are consecutive.
         //g_node_label -> edge_array_node_label
         std::unordered_map<unsigned long, unsigned long> label;
-        //edge_array_label -> g_node_label
-        std::unordered_map<unsigned long, unsigned long> reverse_label;
+        reverse_label.resize(g->size());
 
         unsigned long current_label = 0;
         for(const auto &pair: (*g)) {
@@ -60,10 +94,10 @@ void tcount::sampler_edge_array::build_edge_array(bool relabel) {
 
         unsigned long current_index = 0;
         for(unsigned long i = 0; i < g->size(); ++i) {
-            (*node_array)[i] = current_index;
+            node_array[i] = current_index;
 
             for(unsigned long node: (*g)[reverse_label[i]]) {
-                (*edge_array).push_back(label[node]);
+                edge_array.push_back(static_cast<Vertex>(label[node]));
                 current_index += 1;
             }
         }
@@ -72,20 +106,50 @@ void tcount::sampler_edge_array::build_edge_array(bool relabel) {
     else {
         unsigned long current_index = 0;
         for(unsigned long i = 0; i < g->size(); ++i) {
-            (*node_array)[i] = current_index;
+            node_array[i] = current_index;
 
             for(unsigned long node: (*g)[i]) {
-                (*edge_array).push_back(node);
+                edge_array.push_back(static_cast<Vertex>(node));
                 current_index += 1;
             }
         }
     }
+    node_array[node_array.size() - 1] = edge_array.size();
 
+    delete(g);
+    this->g = nullptr;
 
+    //neighbour lists are sorted once here rather than lazily while sampling, so a graph that has
+    //been saved and mapped back read only can be sampled as is
+    this->csr = basic_csr_graph<Vertex>(std::move(node_array), std::move(edge_array), std::move(reverse_label), false);
+    csr.sort_neighbours();
+}
 
+/**
+ * @return The CSR built by build_edge_array, for example to save it as a .tcsr file.
+ */
+template<typename Vertex>
+const tcount::basic_csr_graph<Vertex>& tcount::basic_sampler_edge_array<Vertex>::graph() const {
+    return csr;
+}
 
-    delete(g);
-    this->g = nullptr;
+/**
+ * Builds neighbour bitmaps for the hubs of the graph, which sample_triangles then uses for any
+ * sample that touches a hub. The edge array must be built first.
+ *
+ * @param threshold The degree at which a node becomes a hub, or 0 to choose it from the degree
+ * distribution, allowing the bitmaps up to half the memory of the edge array.
+ * @return The index, for reporting how many hubs there are and how much memory they take.
+ */
+template<typename Vertex>
+const tcount::hub_index& tcount::basic_sampler_edge_array<Vertex>::build_hub_index(unsigned long threshold) {
+    stats::phase_timer timer(stats::phase::preprocess);
+    if (threshold == 0) {
+        threshold = hub_index::choose_threshold(csr.node_array(), csr.number_of_nodes(),
+                                                csr.size_of_edge_array() * sizeof(Vertex) / 2);
+    }
+    this->hubs = hub_index(csr.node_array(), csr.edge_array(), csr.number_of_nodes(), threshold);
+    return hubs;
 }
 
 /**
@@ -97,96 +161,161 @@ void tcount::sampler_edge_array::build_edge_array(bool relabel) {
  * @param number_of_samples The number of samples to perform.
  * @return An approximation of the triangle count of the graph.
  */
-unsigned long tcount::sampler_edge_array::sample_triangles(unsigned long number_of_samples) {
-    std::vector<unsigned long> node_array_ = *node_array;
-    std::vector<unsigned long> edge_array_ = *edge_array;
-
-    (*node_array)[node_array->size() - 1] = edge_array->size();
-    auto seed = static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count());
-    std::mt19937 mt(seed);
-
-    std::vector<int64_t> sorted(node_array->size() - 1);
-
-    auto M = static_cast<unsigned long>((edge_array->size()) / 2);
-    double sum = 0;
-
-    for (int i = 0; i < number_of_samples; ++i) {
-        //std::cout << "0" << std::endl;
-        //obtain random node u
-        std::uniform_int_distribution<unsigned int> dist_u(0, static_cast<unsigned int>(edge_array->size() - 1));
-        auto u_itr = edge_array->begin();
-        std::advance(u_itr, dist_u(mt));
-        unsigned long sample_u = (*u_itr);
-
-        //std::cout << "1" << std::endl;
-
-        unsigned long degree_u;
-        unsigned long degree_v;
-
-        //obtain random node v that is a neighbour of u
-        degree_u = (*node_array)[sample_u + 1] - (*node_array)[sample_u];
-        std::uniform_int_distribution<unsigned int> dist_v(0, degree_u - 1);
-        auto v_itr = edge_array->begin();
-        std::advance(v_itr, (*node_array)[sample_u]);
-        std::advance(v_itr, dist_v(mt));
-        unsigned long sample_v = (*v_itr);
-        degree_v = (*node_array)[sample_v + 1] - (*node_array)[sample_v];
-
-        //std::cout << "2" << std::endl;
+template<typename Vertex>
+unsigned long tcount::basic_sampler_edge_array<Vertex>::sample_triangles(unsigned long number_of_samples) const {
+    auto seed = static_cast<unsigned long long>(std::chrono::system_clock::now().time_since_epoch().count());
+    return sample_triangles(number_of_samples, 0, seed);
+}
 
-        //calculate |N(u) intersect N(v)|
-        unsigned long lambda = 0;
+/**
+ * Samples the specified number of triangles on several threads and returns an approximation of
+ * the number of triangles in the edge array stored in the sampler.
+ *
+ * Samples are drawn in fixed size blocks, each with its own random stream derived from the seed
+ * and the block number, so the result only depends on the seed and not on the number of threads.
+ * The graph is only read, so several calls may run at once.
+ *
+ * @param number_of_samples The number of samples to perform.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @param seed The seed of the random streams.
+ * @return An approximation of the triangle count of the graph.
+ */
+template<typename Vertex>
+unsigned long tcount::basic_sampler_edge_array<Vertex>::sample_triangles(unsigned long number_of_samples,
+                                                                        unsigned int threads,
+                                                                        unsigned long long seed) const {
+    unsigned long edge_array_size = csr.size_of_edge_array();
+
+    if (number_of_samples == 0 || edge_array_size == 0) {
+        return 0;
+    }
+    if (threads == 0) {
+        threads = default_threads();
+    }
+    stats::phase_timer timer(stats::phase::estimate);
 
-        //sort each neighbour list
-        if(!sorted[sample_u]) {
-            auto u_begin_itr = edge_array->begin();
-            std::advance(u_begin_itr, (*node_array)[sample_u]);
+    unsigned long blocks = (number_of_samples + SAMPLE_BLOCK - 1) / SAMPLE_BLOCK;
 
-            auto u_end_itr = edge_array->begin();
-            std::advance(u_end_itr, (*node_array)[sample_u] + degree_u);
+    //the estimate of every sample is lambda * M / 3, so summing the integer lambdas keeps the total
+    //exact whatever order the blocks finish in
+    std::atomic<unsigned long long> lambda_sum(0);
 
-            std::sort(u_begin_itr, u_end_itr);
-            sorted[sample_u] = true;
+    parallel_for_dynamic(0, blocks, 1, threads, [&](unsigned int, size_t lo, size_t hi) {
+        unsigned long long local_sum = 0;
+        for (size_t block = lo; block < hi; ++block) {
+            unsigned long first = block * SAMPLE_BLOCK;
+            local_sum += sample_block(seed, block, std::min(number_of_samples - first, SAMPLE_BLOCK)).lambda;
         }
+        lambda_sum += local_sum;
+    });
 
-        //std::cout << "3" << std::endl;
+    auto M = static_cast<unsigned long>(edge_array_size / 2);
+    double sum = lambda_sum.load() * (M/3.0);
+    sum /= number_of_samples;
 
-        if(!sorted[sample_v]) {
-            auto v_begin_itr = edge_array->begin();
-            std::advance(v_begin_itr, (*node_array)[sample_v]);
+    return (unsigned long) sum;
+}
 
-            auto v_end_itr = edge_array->begin();
-            std::advance(v_end_itr, (*node_array)[sample_v] + degree_v);
+/**
+ * Samples until the confidence interval of the estimate is within the relative error of the
+ * target, and returns the estimate with its interval and the number of samples drawn.
+ *
+ * Samples are drawn in rounds of one block per thread, the blocks seeded exactly as in the fixed
+ * size sample_triangles, and the interval is checked after every round from the sums of the
+ * intersection sizes and their squares.
+ *
+ * @param target The relative error and confidence to reach, and the limits on the samples.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @param seed The seed of the random streams.
+ * @return The estimate, its confidence interval and the samples it took.
+ */
+template<typename Vertex>
+tcount::sampling_estimate tcount::basic_sampler_edge_array<Vertex>::sample_triangles(const sampling_target &target,
+                                                                                    unsigned int threads,
+                                                                                    unsigned long long seed) const {
+    double z = check_target(target);
+    unsigned long edge_array_size = csr.size_of_edge_array();
+    if (edge_array_size == 0) {
+        return sampling_estimate{0.0, 0.0, 0.0, 0, true};
+    }
+    if (threads == 0) {
+        threads = default_threads();
+    }
+    stats::phase_timer timer(stats::phase::estimate);
+
+    double scale = static_cast<double>(edge_array_size / 2) / 3.0;
+    running_moments moments;
+    std::vector<block_sums> sums(threads);
+    unsigned long next_block = 0;
+
+    while (!moments.reached(target, z) && moments.count() < target.max_samples) {
+        unsigned long drawn = moments.count();
+        unsigned long round = std::min<unsigned long>(threads, (target.max_samples - drawn + SAMPLE_BLOCK - 1) / SAMPLE_BLOCK);
+        unsigned long first_block = next_block;
+
+        parallel_for_dynamic(0, round, 1, threads, [&](unsigned int, size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) {
+                unsigned long count = std::min(SAMPLE_BLOCK, target.max_samples - drawn - i * SAMPLE_BLOCK);
+                sums[i] = sample_block(seed, first_block + i, count);
+            }
+        });
 
-            std::sort(v_begin_itr, v_end_itr);
-            sorted[sample_v] = true;
+        for (unsigned long i = 0; i < round; ++i) {
+            unsigned long count = std::min(SAMPLE_BLOCK, target.max_samples - drawn - i * SAMPLE_BLOCK);
+            moments.add(count, scale * static_cast<double>(sums[i].lambda),
+                        scale * scale * static_cast<double>(sums[i].lambda_squared));
         }
+        next_block += round;
+    }
 
-        //std::cout << "4" << std::endl;
+    return moments.estimate(target, z);
+}
 
-        auto candidate = degree_u < degree_v ? sample_u : sample_v;
-        auto other = candidate == sample_u ? sample_v : sample_u;
+/**
+ * Draws one block of samples from its own random stream, derived from the seed and the block
+ * number, so the samples of a block do not depend on the thread that draws them.
+ *
+ * @param seed The seed of the random streams.
+ * @param block The block number.
+ * @param count The number of samples, at most SAMPLE_BLOCK.
+ * @return The sums of the intersection sizes and of their squares.
+ */
+template<typename Vertex>
+typename tcount::basic_sampler_edge_array<Vertex>::block_sums
+tcount::basic_sampler_edge_array<Vertex>::sample_block(unsigned long long seed, unsigned long block,
+                                                       unsigned long count) const {
+    const unsigned long* node_array = csr.node_array();
+    const Vertex* edge_array = csr.edge_array();
+    unsigned long edge_array_size = csr.size_of_edge_array();
+    stats::local_counters counters;
+    counters.add(stats::counter::samples, count);
+    counters.add(stats::counter::intersections, count);
+
+    std::seed_seq seq{static_cast<unsigned int>(seed), static_cast<unsigned int>(seed >> 32),
+                      static_cast<unsigned int>(block), static_cast<unsigned int>(block >> 32)};
+    std::mt19937_64 mt(seq);
+    std::uniform_int_distribution<unsigned long> dist_u(0, edge_array_size - 1);
+
+    block_sums sums;
+    for (unsigned long i = 0; i < count; ++i) {
+        //obtain random node u
+        unsigned long sample_u = edge_array[dist_u(mt)];
 
-        for(auto n = (*node_array)[candidate], m = (*node_array)[other]; n < (*node_array)[candidate + 1] && m < (*node_array)[other + 1]; /* */)
-        {
-            if((*edge_array)[n] == (*edge_array)[m]) {
-                lambda++;
-                n++;
-                m++;
-            }
-            else if((*edge_array)[n] > (*edge_array)[m]) {
-                m++;
-            }
-            else if((*edge_array)[n] < (*edge_array)[m]) {
-                n++;
-            }
-        }
+        //obtain random node v that is a neighbour of u
+        unsigned long degree_u = node_array[sample_u + 1] - node_array[sample_u];
+        std::uniform_int_distribution<unsigned long> dist_v(0, degree_u - 1);
+        unsigned long sample_v = edge_array[node_array[sample_u] + dist_v(mt)];
+        unsigned long degree_v = node_array[sample_v + 1] - node_array[sample_v];
 
-        //std::cout << "5" << std::endl;
-        sum += lambda * (M/3.0);
+        //calculate |N(u) intersect N(v)|
+        unsigned long long lambda = hubs.intersection_count(sample_u, edge_array + node_array[sample_u], degree_u,
+                                                            sample_v, edge_array + node_array[sample_v], degree_v);
+        counters.add(stats::counter::elements_compared, degree_u + degree_v);
+        sums.lambda += lambda;
+        sums.lambda_squared += lambda * lambda;
     }
-
-    sum /= number_of_samples;
-
-    return (unsigned long) sum;
+    return sums;
 }
+
+template class tcount::basic_sampler_edge_array<unsigned int>;
+template class tcount::basic_sampler_edge_array<unsigned long>;
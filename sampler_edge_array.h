@@ -9,20 +9,47 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <vector>
+#include "csr_graph.h"
+#include "hub_index.h"
+#include "adaptive_sampling.h"
 
 namespace tcount {
-    class sampler_edge_array {
+    /*
+     * Vertex is the type of the ids in the CSR that is sampled, as in basic_csr_graph. Nodes are
+     * added with any unsigned long id and relabelled to 0..n-1 when the edge array is built.
+     */
+    template<typename Vertex>
+    class basic_sampler_edge_array {
         std::unordered_map<unsigned long, std::unordered_set<unsigned long>>* g;
-        std::vector<unsigned long>* node_array;
-        std::vector<unsigned long>* edge_array;
+        basic_csr_graph<Vertex> csr;
+        hub_index hubs;
 
     public:
-        sampler_edge_array();
-        ~sampler_edge_array();
+        basic_sampler_edge_array();
+        explicit basic_sampler_edge_array(basic_csr_graph<Vertex> &&graph);
+        ~basic_sampler_edge_array();
         void add_edge(unsigned long u, unsigned long v);
         void build_edge_array(bool relabel);
-        unsigned long sample_triangles(unsigned long number_of_samples);
+        const basic_csr_graph<Vertex>& graph() const;
+        const hub_index& build_hub_index(unsigned long threshold);
+        unsigned long sample_triangles(unsigned long number_of_samples) const;
+        unsigned long sample_triangles(unsigned long number_of_samples, unsigned int threads,
+                                       unsigned long long seed) const;
+        sampling_estimate sample_triangles(const sampling_target &target, unsigned int threads,
+                                           unsigned long long seed) const;
+
+    private:
+        // the sum of the intersection sizes of a block of samples, and the sum of their squares
+        struct block_sums {
+            unsigned long long lambda = 0;
+            unsigned long long lambda_squared = 0;
+        };
+
+        block_sums sample_block(unsigned long long seed, unsigned long block, unsigned long count) const;
     };
+
+    typedef basic_sampler_edge_array<unsigned long> sampler_edge_array;
+    typedef basic_sampler_edge_array<unsigned int> compact_sampler_edge_array;
 }
 
 
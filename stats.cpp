@@ -0,0 +1,134 @@
+//
+// Phase timers and hot path counters for the whole library, dumped as JSON by the cli. Building
+// without TCOUNT_STATS compiles every timer and counter out.
+//
+
+#include "stats.h"
+
+#include <atomic>
+
+namespace {
+    const char* PHASE_NAMES[tcount::stats::NUMBER_OF_PHASES] = {"load", "build", "preprocess", "count", "estimate"};
+    const char* COUNTER_NAMES[tcount::stats::NUMBER_OF_COUNTERS] = {"edges_ingested", "intersections",
+                                                                    "elements_compared", "reservoir_evictions",
+                                                                    "samples"};
+
+#ifdef TCOUNT_STATS
+    // phase times are kept in nanoseconds, since there is no atomic add for doubles
+    std::atomic<unsigned long long> phase_nanoseconds[tcount::stats::NUMBER_OF_PHASES];
+    std::atomic<unsigned long long> counter_values[tcount::stats::NUMBER_OF_COUNTERS];
+
+    // the innermost running timer of this thread
+    thread_local tcount::stats::phase_timer* running = nullptr;
+#endif
+}
+
+const char* tcount::stats::phase_name(phase p) {
+    return PHASE_NAMES[static_cast<unsigned int>(p)];
+}
+
+const char* tcount::stats::counter_name(counter c) {
+    return COUNTER_NAMES[static_cast<unsigned int>(c)];
+}
+
+/**
+ * @return Whether the library was built with TCOUNT_STATS, so that timers and counters are kept.
+ */
+bool tcount::stats::enabled() {
+#ifdef TCOUNT_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Sets every timer and counter back to 0.
+ */
+void tcount::stats::reset() {
+#ifdef TCOUNT_STATS
+    for (auto &t: phase_nanoseconds) {
+        t.store(0, std::memory_order_relaxed);
+    }
+    for (auto &c: counter_values) {
+        c.store(0, std::memory_order_relaxed);
+    }
+#endif
+}
+
+/**
+ * @return The seconds spent in a phase since the start or the last reset, over every thread.
+ */
+double tcount::stats::seconds(phase p) {
+#ifdef TCOUNT_STATS
+    return phase_nanoseconds[static_cast<unsigned int>(p)].load(std::memory_order_relaxed) / 1e9;
+#else
+    (void) p;
+    return 0.0;
+#endif
+}
+
+/**
+ * @return The value of a counter since the start or the last reset.
+ */
+unsigned long long tcount::stats::value(counter c) {
+#ifdef TCOUNT_STATS
+    return counter_values[static_cast<unsigned int>(c)].load(std::memory_order_relaxed);
+#else
+    (void) c;
+    return 0;
+#endif
+}
+
+/**
+ * Writes every phase time and counter as one JSON object, with "enabled": false and zeros if the
+ * library was built without TCOUNT_STATS.
+ */
+void tcount::stats::write_json(std::ostream &out) {
+    out << "{\"enabled\": " << (enabled() ? "true" : "false") << ", \"phases\": {";
+    for (unsigned int p = 0; p < NUMBER_OF_PHASES; ++p) {
+        out << (p == 0 ? "" : ", ") << "\"" << PHASE_NAMES[p] << "\": " << seconds(static_cast<phase>(p));
+    }
+    out << "}, \"counters\": {";
+    for (unsigned int c = 0; c < NUMBER_OF_COUNTERS; ++c) {
+        out << (c == 0 ? "" : ", ") << "\"" << COUNTER_NAMES[c] << "\": " << value(static_cast<counter>(c));
+    }
+    out << "}}" << std::endl;
+}
+
+#ifdef TCOUNT_STATS
+void tcount::stats::add(counter c, unsigned long long amount) {
+    counter_values[static_cast<unsigned int>(c)].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void tcount::stats::add_seconds(phase p, double seconds) {
+    phase_nanoseconds[static_cast<unsigned int>(p)].fetch_add(static_cast<unsigned long long>(seconds * 1e9),
+                                                              std::memory_order_relaxed);
+}
+
+tcount::stats::phase_timer::phase_timer(phase p) : p(p), outer(running), elapsed(0.0) {
+    start = std::chrono::steady_clock::now();
+    if (outer != nullptr) {
+        outer->pause(start);
+    }
+    running = this;
+}
+
+tcount::stats::phase_timer::~phase_timer() {
+    auto now = std::chrono::steady_clock::now();
+    pause(now);
+    add_seconds(p, elapsed);
+    running = outer;
+    if (outer != nullptr) {
+        outer->resume(now);
+    }
+}
+
+void tcount::stats::phase_timer::pause(std::chrono::steady_clock::time_point now) {
+    elapsed += std::chrono::duration<double>(now - start).count();
+}
+
+void tcount::stats::phase_timer::resume(std::chrono::steady_clock::time_point now) {
+    start = now;
+}
+#endif
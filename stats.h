@@ -0,0 +1,115 @@
+//
+// Phase timers and hot path counters for the whole library, dumped as JSON by the cli. Building
+// without TCOUNT_STATS compiles every timer and counter out.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_STATS_H
+#define TRIANGLECOUNTINGAPI_STATS_H
+
+#include <chrono>
+#include <ostream>
+
+namespace tcount {
+    namespace stats {
+        enum class phase {
+            // reading edge lists and mapping .tcsr files
+            load,
+            // turning edges into a graph: CSR construction, hash adjacency, relabeling
+            build,
+            // work done on a built graph before counting: orientation, hub bitmaps, reordering,
+            // sparsification
+            preprocess,
+            // exact counting
+            count,
+            // sampling and the estimates made from samples
+            estimate
+        };
+        const unsigned int NUMBER_OF_PHASES = 5;
+
+        enum class counter {
+            // edges read from an input, again on every pass over it
+            edges_ingested,
+            intersections,
+            // list elements an intersection walked, or accumulator probes for the matrix engines
+            elements_compared,
+            reservoir_evictions,
+            samples
+        };
+        const unsigned int NUMBER_OF_COUNTERS = 5;
+
+        const char* phase_name(phase p);
+        const char* counter_name(counter c);
+        void reset();
+        double seconds(phase p);
+        unsigned long long value(counter c);
+        void write_json(std::ostream &out);
+
+        bool enabled();
+
+#ifdef TCOUNT_STATS
+        void add(counter c, unsigned long long amount);
+        void add_seconds(phase p, double seconds);
+
+        /**
+         * Times the enclosing scope as one phase. Timers nest: while an inner timer runs, the outer
+         * one is paused, so the phases of a thread add up to its wall time instead of overlapping.
+         * Only the thread that drives a run should time phases; the workers it starts just count.
+         */
+        class phase_timer {
+            phase p;
+            phase_timer* outer;
+            std::chrono::steady_clock::time_point start;
+            double elapsed;
+
+        public:
+            explicit phase_timer(phase p);
+            ~phase_timer();
+            phase_timer(const phase_timer&) = delete;
+            phase_timer& operator=(const phase_timer&) = delete;
+
+        private:
+            void pause(std::chrono::steady_clock::time_point now);
+            void resume(std::chrono::steady_clock::time_point now);
+        };
+
+        /**
+         * Counts on a single thread and adds its totals to the shared counters once, when it goes
+         * out of scope, so hot loops never touch shared memory.
+         */
+        class local_counters {
+            unsigned long long values[NUMBER_OF_COUNTERS] = {};
+
+        public:
+            local_counters() = default;
+            ~local_counters() {
+                for (unsigned int c = 0; c < NUMBER_OF_COUNTERS; ++c) {
+                    if (values[c] != 0) {
+                        stats::add(static_cast<counter>(c), values[c]);
+                    }
+                }
+            }
+            local_counters(const local_counters&) = delete;
+            local_counters& operator=(const local_counters&) = delete;
+
+            void add(counter c, unsigned long long amount) {
+                values[static_cast<unsigned int>(c)] += amount;
+            }
+        };
+#else
+        inline void add(counter, unsigned long long) {}
+        inline void add_seconds(phase, double) {}
+
+        class phase_timer {
+        public:
+            explicit phase_timer(phase) {}
+        };
+
+        class local_counters {
+        public:
+            void add(counter, unsigned long long) {}
+        };
+#endif
+    }
+}
+
+#endif //TRIANGLECOUNTINGAPI_STATS_H
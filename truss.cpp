@@ -0,0 +1,295 @@
+//
+// The number of triangles through every edge, and the k-truss decomposition peeled from it.
+//
+
+#include "truss.h"
+
+#include <algorithm>
+#include "parallel.h"
+#include "stats.h"
+
+namespace {
+    // edges claimed by a thread at a time
+    const size_t EDGE_GRAIN = 1024;
+    // peeling states
+    const unsigned char REMAINING = 0;
+    const unsigned char FRONTIER = 1;
+    const unsigned char PEELED = 2;
+
+    void increment(unsigned int &count) {
+        __atomic_fetch_add(&count, 1u, __ATOMIC_RELAXED);
+    }
+
+    // the node whose out neighbours include edge e
+    unsigned long source_of(const unsigned long* node_array, unsigned long n, unsigned long e) {
+        return static_cast<unsigned long>(std::upper_bound(node_array, node_array + n + 1, e) - node_array - 1);
+    }
+
+    // a list this many times shorter than the other is searched in it rather than merged with it
+    const size_t SEARCH_RATIO = 16;
+
+    // calls fn(i, j) for every i in [a, a_end) and j in [b, b_end) with list[i] == list[j], both
+    // ranges sorted
+    template<typename Vertex, typename Fn>
+    void for_each_common(const Vertex* list, size_t a, size_t a_end, size_t b, size_t b_end, Fn fn) {
+        if ((a_end - a) * SEARCH_RATIO < b_end - b || (b_end - b) * SEARCH_RATIO < a_end - a) {
+            bool swapped = a_end - a > b_end - b;
+            if (swapped) {
+                std::swap(a, b);
+                std::swap(a_end, b_end);
+            }
+            for (; a != a_end; ++a) {
+                b = static_cast<size_t>(std::lower_bound(list + b, list + b_end, list[a]) - list);
+                if (b == b_end) {
+                    return;
+                }
+                if (list[b] == list[a]) {
+                    swapped ? fn(b, a) : fn(a, b);
+                }
+            }
+            return;
+        }
+
+        while (a != a_end && b != b_end) {
+            if (list[a] < list[b]) {
+                ++a;
+            }
+            else if (list[b] < list[a]) {
+                ++b;
+            }
+            else {
+                fn(a++, b++);
+            }
+        }
+    }
+
+    // appends every thread's list to one, emptying them
+    void concatenate(std::vector<std::vector<unsigned long>> &parts, std::vector<unsigned long> &whole) {
+        whole.clear();
+        for (auto &part: parts) {
+            whole.insert(whole.end(), part.begin(), part.end());
+            part.clear();
+        }
+    }
+}
+
+/**
+ * Counts the triangles through every edge in the same pass that forward_oriented makes. Every
+ * triangle u < v < w (by rank) is found once, as w in the intersection of N+(u) after v and N+(v),
+ * and the positions the merge stops at are the edges (u, w) and (v, w) themselves, so all three
+ * edges are credited without looking anything up. The counts are shared between threads and
+ * incremented atomically.
+ *
+ * @param g The oriented graph.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @return The support of every edge, which adds up to three times the number of triangles.
+ */
+template<typename Vertex>
+std::vector<unsigned int> tcount::edge_support(const basic_oriented_graph<Vertex> &g, unsigned int threads) {
+    if (threads == 0) {
+        threads = default_threads();
+    }
+    stats::phase_timer timer(stats::phase::count);
+
+    const unsigned long* node_array = g.node_array();
+    const Vertex* edge_array = g.edge_array();
+    unsigned long n = g.number_of_nodes();
+    std::vector<unsigned int> support(g.number_of_edges(), 0);
+
+    parallel_for_dynamic(0, g.number_of_edges(), EDGE_GRAIN, threads, [&](unsigned int, size_t lo, size_t hi) {
+        unsigned long u = source_of(node_array, n, lo);
+        stats::local_counters counters;
+        counters.add(stats::counter::intersections, hi - lo);
+
+        for (size_t e = lo; e < hi; ++e) {
+            while (node_array[u + 1] <= e) {
+                ++u;
+            }
+            unsigned long v = edge_array[e];
+
+            unsigned long a = e + 1;
+            unsigned long a_end = node_array[u + 1];
+            unsigned long b = node_array[v];
+            unsigned long b_end = node_array[v + 1];
+            counters.add(stats::counter::elements_compared, a_end - a + b_end - b);
+            while (a != a_end && b != b_end) {
+                if (edge_array[a] < edge_array[b]) {
+                    ++a;
+                }
+                else if (edge_array[b] < edge_array[a]) {
+                    ++b;
+                }
+                else {
+                    increment(support[e]);
+                    increment(support[a]);
+                    increment(support[b]);
+                    ++a;
+                    ++b;
+                }
+            }
+        }
+    });
+
+    return support;
+}
+
+/**
+ * Finds the truss number of every edge: the largest k such that the edge is in the k-truss, the
+ * largest subgraph in which every edge is in at least k - 2 triangles.
+ *
+ * Edges are peeled a level at a time. Each level takes the bucket of the remaining edges with the
+ * lowest support, removes them in parallel, and decrements the support of the edges they shared a
+ * triangle with, never below the level; those that reach it join the next round of the same
+ * level. A triangle with two edges in one round is accounted for by the lower numbered of them
+ * only. The remaining edges are compacted as levels are finished, so each level scans only what
+ * is left.
+ *
+ * Besides the graph it takes around seven words per edge: the undirected neighbour lists with the
+ * id of every edge in them, the supports and states, and the lists of edges left to peel. The
+ * neighbour lists are as wide as the ranks of g, so 32 bit ranks save one of those words.
+ *
+ * @param g The oriented graph.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @return The truss number of every edge, at least 2.
+ */
+template<typename Vertex>
+std::vector<unsigned int> tcount::truss_decomposition(const basic_oriented_graph<Vertex> &g, unsigned int threads) {
+    if (threads == 0) {
+        threads = default_threads();
+    }
+    stats::phase_timer timer(stats::phase::count);
+
+    const unsigned long* node_array = g.node_array();
+    const Vertex* edge_array = g.edge_array();
+    unsigned long n = g.number_of_nodes();
+    unsigned long m = g.number_of_edges();
+
+    std::vector<unsigned int> support = edge_support(g, threads);
+
+    //undirected lists: the lower ranked neighbours, then N+(u), so every list is already sorted
+    std::vector<unsigned long> full_index(n + 1, 0);
+    for (unsigned long e = 0; e < m; ++e) {
+        full_index[edge_array[e] + 1] += 1;
+    }
+    for (unsigned long u = 0; u < n; ++u) {
+        full_index[u + 1] += full_index[u] + g.out_degree(u);
+    }
+    std::vector<Vertex> neighbours(2 * m);
+    std::vector<unsigned long> edge_ids(2 * m);
+    std::vector<unsigned long> position(full_index.begin(), full_index.end() - 1);
+    for (unsigned long u = 0; u < n; ++u) {
+        for (unsigned long e = node_array[u]; e < node_array[u + 1]; ++e) {
+            unsigned long v = edge_array[e];
+            neighbours[position[v]] = static_cast<Vertex>(u);
+            edge_ids[position[v]++] = e;
+        }
+    }
+    parallel_for_dynamic(0, n, EDGE_GRAIN, threads, [&](unsigned int, size_t lo, size_t hi) {
+        for (size_t u = lo; u < hi; ++u) {
+            std::copy(edge_array + node_array[u], edge_array + node_array[u + 1], neighbours.begin() + position[u]);
+            for (unsigned long e = node_array[u]; e < node_array[u + 1]; ++e) {
+                edge_ids[position[u] + e - node_array[u]] = e;
+            }
+        }
+    });
+    position = std::vector<unsigned long>();
+
+    std::vector<unsigned int> truss(m, 2);
+    std::vector<unsigned char> state(m, REMAINING);
+    std::vector<unsigned long> remaining(m);
+    for (unsigned long e = 0; e < m; ++e) {
+        remaining[e] = e;
+    }
+    std::vector<unsigned long> frontier;
+    std::vector<std::vector<unsigned long>> kept(threads), found(threads);
+    std::vector<unsigned int> minimum(threads);
+
+    while (!remaining.empty()) {
+        //the lowest support left is the next level
+        std::fill(minimum.begin(), minimum.end(), ~0u);
+        parallel_for_dynamic(0, remaining.size(), EDGE_GRAIN, threads, [&](unsigned int t, size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) {
+                if (state[remaining[i]] == REMAINING) {
+                    minimum[t] = std::min(minimum[t], support[remaining[i]]);
+                }
+            }
+        });
+        unsigned int level = *std::min_element(minimum.begin(), minimum.end());
+        if (level == ~0u) {
+            break;
+        }
+
+        parallel_for_dynamic(0, remaining.size(), EDGE_GRAIN, threads, [&](unsigned int t, size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) {
+                unsigned long e = remaining[i];
+                if (state[e] == REMAINING) {
+                    (support[e] <= level ? found[t] : kept[t]).push_back(e);
+                }
+            }
+        });
+        concatenate(found, frontier);
+        concatenate(kept, remaining);
+
+        //takes a triangle away from edge f, keeping it at the level, and queues it once it gets there
+        auto decrement = [&](unsigned long f, std::vector<unsigned long> &next) {
+            unsigned int before = __atomic_fetch_sub(&support[f], 1u, __ATOMIC_RELAXED);
+            if (before == level + 1) {
+                next.push_back(f);
+            }
+            else if (before <= level) {
+                __atomic_fetch_add(&support[f], 1u, __ATOMIC_RELAXED);
+            }
+        };
+
+        while (!frontier.empty()) {
+            for (unsigned long e: frontier) {
+                state[e] = FRONTIER;
+            }
+
+            parallel_for_dynamic(0, frontier.size(), 64, threads, [&](unsigned int t, size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) {
+                    unsigned long e = frontier[i];
+                    //support never drops below the triangles left, so none are left to take away
+                    if (support[e] == 0) {
+                        continue;
+                    }
+                    unsigned long u = source_of(node_array, n, e);
+                    unsigned long v = edge_array[e];
+
+                    for_each_common(neighbours.data(), full_index[u], full_index[u + 1], full_index[v], full_index[v + 1],
+                                    [&](size_t a, size_t b) {
+                        unsigned long e1 = edge_ids[a], e2 = edge_ids[b];
+                        if (state[e1] == PEELED || state[e2] == PEELED) {
+                            return;
+                        }
+                        bool e1_peeling = state[e1] == FRONTIER;
+                        bool e2_peeling = state[e2] == FRONTIER;
+                        if (!e1_peeling && !e2_peeling) {
+                            decrement(e1, found[t]);
+                            decrement(e2, found[t]);
+                        }
+                        else if (!e1_peeling && e < e2) {
+                            decrement(e1, found[t]);
+                        }
+                        else if (!e2_peeling && e < e1) {
+                            decrement(e2, found[t]);
+                        }
+                    });
+                }
+            });
+
+            for (unsigned long e: frontier) {
+                state[e] = PEELED;
+                truss[e] = level + 2;
+            }
+            concatenate(found, frontier);
+        }
+    }
+
+    return truss;
+}
+
+template std::vector<unsigned int> tcount::edge_support(const compact_oriented_graph &g, unsigned int threads);
+template std::vector<unsigned int> tcount::edge_support(const oriented_graph &g, unsigned int threads);
+template std::vector<unsigned int> tcount::truss_decomposition(const compact_oriented_graph &g, unsigned int threads);
+template std::vector<unsigned int> tcount::truss_decomposition(const oriented_graph &g, unsigned int threads);
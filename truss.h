@@ -0,0 +1,20 @@
+//
+// The number of triangles through every edge, and the k-truss decomposition peeled from it.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_TRUSS_H
+#define TRIANGLECOUNTINGAPI_TRUSS_H
+
+#include <vector>
+#include "oriented_graph.h"
+
+namespace tcount {
+    // both indexed like the edge array of the oriented graph: entry e is the edge from the node
+    // whose out neighbours include position e to edge_array()[e]
+    template<typename Vertex>
+    std::vector<unsigned int> edge_support(const basic_oriented_graph<Vertex> &g, unsigned int threads = 0);
+    template<typename Vertex>
+    std::vector<unsigned int> truss_decomposition(const basic_oriented_graph<Vertex> &g, unsigned int threads = 0);
+}
+
+#endif //TRIANGLECOUNTINGAPI_TRUSS_H
@@ -0,0 +1,47 @@
+//
+// Triangle counts and local clustering coefficients of every vertex, exact or estimated, and the
+// binary columnar file they are written to.
+//
+
+#ifndef TRIANGLECOUNTINGAPI_VERTEX_TRIANGLES_H
+#define TRIANGLECOUNTINGAPI_VERTEX_TRIANGLES_H
+
+#include <vector>
+#include "oriented_graph.h"
+
+namespace tcount {
+    /*
+     * Layout of a vertex triangle file, all integers little endian. The columns follow each other
+     * so a reader can map just the ones it needs:
+     *
+     *   header         24 bytes, see vertex_file_header
+     *   ids            vertices x uint64, original node ids
+     *   degrees        vertices x uint64, 0 where the degree is unknown
+     *   triangles      vertices x float64, exact counts are whole numbers
+     *   clustering     vertices x float64, local clustering coefficients
+     */
+    const char VERTEX_MAGIC[8] = {'T', 'V', 'E', 'R', 'T', 'E', 'X', 'T'};
+    const unsigned int VERTEX_VERSION = 1;
+
+    struct vertex_file_header {
+        char magic[8];
+        unsigned int version;
+        unsigned int reserved;
+        unsigned long long vertices;
+    };
+
+    // one entry per vertex in each column, in the same order
+    struct vertex_counts {
+        std::vector<unsigned long> ids;
+        std::vector<unsigned long> degrees;
+        std::vector<double> triangles;
+    };
+
+    template<typename Vertex>
+    vertex_counts count_vertex_triangles(const basic_oriented_graph<Vertex> &g, unsigned int threads = 0);
+    double local_clustering(unsigned long degree, double triangles);
+    void save_vertex_counts(const char* filename, const vertex_counts &counts);
+    vertex_counts load_vertex_counts(const char* filename);
+}
+
+#endif //TRIANGLECOUNTINGAPI_VERTEX_TRIANGLES_H
@@ -0,0 +1,234 @@
+//
+// Estimates the transitivity and the triangle count of a graph by sampling wedges, paths u - v - w
+// through a centre v, and testing whether they are closed by the edge (u, w).
+//
+
+#include "wedge_sampler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <stdexcept>
+#include "parallel.h"
+#include "stats.h"
+
+namespace {
+    // samples per independently seeded block
+    const unsigned long SAMPLE_BLOCK = 1ul << 14;
+
+    unsigned long long wedges_at(unsigned long degree) {
+        return static_cast<unsigned long long>(degree) * (degree - 1) / 2;
+    }
+}
+
+/**
+ * Builds the alias table of the wedge centres in O(n), so a wedge can then be drawn uniformly at
+ * random in constant time. The sampler keeps a pointer to the graph, which must outlive it.
+ *
+ * @param graph A graph with sorted neighbour lists, such as the CSR of a sampler_edge_array.
+ * @throws std::invalid_argument If the neighbour lists are not sorted.
+ */
+template<typename Vertex>
+tcount::basic_wedge_sampler<Vertex>::basic_wedge_sampler(const basic_csr_graph<Vertex> &graph)
+        : graph(&graph), wedges(0) {
+    if (!graph.is_sorted()) {
+        throw std::invalid_argument("wedge sampling needs a graph with sorted neighbour lists");
+    }
+    stats::phase_timer timer(stats::phase::preprocess);
+
+    for (unsigned long v = 0; v < graph.number_of_nodes(); ++v) {
+        if (graph.degree(v) >= 2) {
+            centres.push_back(v);
+            wedges += wedges_at(graph.degree(v));
+        }
+    }
+
+    //Vose: scale every weight so they average 1, then pair each centre below 1 with one above it
+    unsigned long k = centres.size();
+    probability.resize(k);
+    alias.resize(k);
+    std::vector<unsigned long> small, large;
+    for (unsigned long i = 0; i < k; ++i) {
+        probability[i] = static_cast<double>(wedges_at(graph.degree(centres[i]))) * k / static_cast<double>(wedges);
+        (probability[i] < 1.0 ? small : large).push_back(i);
+    }
+    while (!small.empty() && !large.empty()) {
+        unsigned long s = small.back(), l = large.back();
+        small.pop_back();
+        alias[s] = l;
+        probability[l] -= 1.0 - probability[s];
+        if (probability[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    //whatever is left is 1 up to rounding
+    for (unsigned long i: small) {
+        probability[i] = 1.0;
+    }
+    for (unsigned long i: large) {
+        probability[i] = 1.0;
+    }
+}
+
+/**
+ * @return The number of wedges in the graph, the sum of d(d - 1) / 2 over its nodes.
+ */
+template<typename Vertex>
+unsigned long long tcount::basic_wedge_sampler<Vertex>::number_of_wedges() const {
+    return wedges;
+}
+
+/**
+ * Samples the specified number of wedges on several threads and returns the fraction that were
+ * closed, and from it the number of triangles.
+ *
+ * Samples are drawn in fixed size blocks seeded from the seed and the block number, as in
+ * sampler_edge_array, so the result only depends on the seed and not on the number of threads.
+ *
+ * @param number_of_samples The number of wedges to sample.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @param seed The seed of the random streams.
+ * @return The estimated transitivity and triangle count.
+ */
+template<typename Vertex>
+tcount::wedge_estimate tcount::basic_wedge_sampler<Vertex>::sample_wedges(unsigned long number_of_samples,
+                                                                          unsigned int threads,
+                                                                          unsigned long long seed) const {
+    if (number_of_samples == 0 || wedges == 0) {
+        return wedge_estimate{0, 0, 0.0, 0.0};
+    }
+    if (threads == 0) {
+        threads = default_threads();
+    }
+    stats::phase_timer timer(stats::phase::estimate);
+
+    unsigned long blocks = (number_of_samples + SAMPLE_BLOCK - 1) / SAMPLE_BLOCK;
+    std::atomic<unsigned long> closed(0);
+
+    parallel_for_dynamic(0, blocks, 1, threads, [&](unsigned int, size_t lo, size_t hi) {
+        unsigned long local_closed = 0;
+        for (size_t block = lo; block < hi; ++block) {
+            unsigned long first = block * SAMPLE_BLOCK;
+            local_closed += sample_block(seed, block, std::min(number_of_samples - first, SAMPLE_BLOCK));
+        }
+        closed += local_closed;
+    });
+
+    double transitivity = static_cast<double>(closed.load()) / number_of_samples;
+    return wedge_estimate{number_of_samples, closed.load(), transitivity, transitivity * wedges / 3.0};
+}
+
+/**
+ * Samples wedges until the confidence interval of the triangle estimate is within the relative
+ * error of the target, checking after every round of one block per thread.
+ *
+ * @param target The relative error and confidence to reach, and the limits on the samples.
+ * @param threads The number of threads, or 0 to use every hardware thread.
+ * @param seed The seed of the random streams.
+ * @return The estimate, its confidence interval and the samples it took.
+ */
+template<typename Vertex>
+tcount::sampling_estimate tcount::basic_wedge_sampler<Vertex>::sample_triangles(const sampling_target &target,
+                                                                                unsigned int threads,
+                                                                                unsigned long long seed) const {
+    double z = check_target(target);
+    if (wedges == 0) {
+        return sampling_estimate{0.0, 0.0, 0.0, 0, true};
+    }
+    if (threads == 0) {
+        threads = default_threads();
+    }
+    stats::phase_timer timer(stats::phase::estimate);
+
+    //every sample estimates wedges / 3 if it is closed and 0 if not
+    double scale = static_cast<double>(wedges) / 3.0;
+    running_moments moments;
+    std::vector<unsigned long> closed(threads);
+    unsigned long next_block = 0;
+
+    while (!moments.reached(target, z) && moments.count() < target.max_samples) {
+        unsigned long drawn = moments.count();
+        unsigned long round = std::min<unsigned long>(threads, (target.max_samples - drawn + SAMPLE_BLOCK - 1) / SAMPLE_BLOCK);
+        unsigned long first_block = next_block;
+
+        parallel_for_dynamic(0, round, 1, threads, [&](unsigned int, size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) {
+                unsigned long count = std::min(SAMPLE_BLOCK, target.max_samples - drawn - i * SAMPLE_BLOCK);
+                closed[i] = sample_block(seed, first_block + i, count);
+            }
+        });
+
+        for (unsigned long i = 0; i < round; ++i) {
+            unsigned long count = std::min(SAMPLE_BLOCK, target.max_samples - drawn - i * SAMPLE_BLOCK);
+            moments.add(count, scale * static_cast<double>(closed[i]),
+                        scale * scale * static_cast<double>(closed[i]));
+        }
+        next_block += round;
+    }
+
+    return moments.estimate(target, z);
+}
+
+/**
+ * Draws one block of wedges from its own random stream. A centre is drawn from the alias table,
+ * two distinct neighbours of it uniformly, and the wedge is closed if the shorter neighbour list
+ * of the two holds the other, found by binary search.
+ *
+ * @param seed The seed of the random streams.
+ * @param block The block number.
+ * @param count The number of samples, at most SAMPLE_BLOCK.
+ * @return The number of closed wedges.
+ */
+template<typename Vertex>
+unsigned long tcount::basic_wedge_sampler<Vertex>::sample_block(unsigned long long seed, unsigned long block,
+                                                                unsigned long count) const {
+    const unsigned long* node_array = graph->node_array();
+    const Vertex* edge_array = graph->edge_array();
+    stats::local_counters counters;
+    counters.add(stats::counter::samples, count);
+    counters.add(stats::counter::intersections, count);
+
+    std::seed_seq seq{static_cast<unsigned int>(seed), static_cast<unsigned int>(seed >> 32),
+                      static_cast<unsigned int>(block), static_cast<unsigned int>(block >> 32)};
+    std::mt19937_64 mt(seq);
+    std::uniform_int_distribution<unsigned long> dist_centre(0, centres.size() - 1);
+    std::uniform_real_distribution<double> dist_coin(0.0, 1.0);
+    std::uniform_int_distribution<unsigned long> dist_neighbour;
+    typedef std::uniform_int_distribution<unsigned long>::param_type range;
+
+    unsigned long closed = 0;
+    for (unsigned long i = 0; i < count; ++i) {
+        //obtain a centre v with probability proportional to its wedges
+        unsigned long c = dist_centre(mt);
+        if (dist_coin(mt) >= probability[c]) {
+            c = alias[c];
+        }
+        unsigned long v = centres[c];
+
+        //obtain two distinct neighbours u and w of v
+        unsigned long degree_v = node_array[v + 1] - node_array[v];
+        unsigned long a = dist_neighbour(mt, range(0, degree_v - 1));
+        unsigned long b = dist_neighbour(mt, range(0, degree_v - 2));
+        if (b >= a) {
+            b += 1;
+        }
+        unsigned long u = edge_array[node_array[v] + a];
+        unsigned long w = edge_array[node_array[v] + b];
+
+        //is (u, w) an edge
+        if (node_array[w + 1] - node_array[w] < node_array[u + 1] - node_array[u]) {
+            std::swap(u, w);
+        }
+        unsigned long degree_u = node_array[u + 1] - node_array[u];
+        if (std::binary_search(edge_array + node_array[u], edge_array + node_array[u + 1], w)) {
+            closed += 1;
+        }
+        //a binary search compares about log2(d) + 1 elements
+        counters.add(stats::counter::elements_compared, 64 - __builtin_clzll(degree_u));
+    }
+    return closed;
+}
+
+template class tcount::basic_wedge_sampler<unsigned int>;
+template class tcount::basic_wedge_sampler<unsigned long>;
@@ -0,0 +1,49 @@
+//
+// Estimates the transitivity and the triangle count of a graph by sampling wedges, paths u - v - w
+// through a centre v, and testing whether they are closed by the edge (u, w).
+//
+
+#ifndef TRIANGLECOUNTINGAPI_WEDGE_SAMPLER_H
+#define TRIANGLECOUNTINGAPI_WEDGE_SAMPLER_H
+
+#include <vector>
+#include "csr_graph.h"
+#include "adaptive_sampling.h"
+
+namespace tcount {
+    struct wedge_estimate {
+        unsigned long samples;
+        unsigned long closed;
+        // the fraction of wedges that are closed, the global clustering coefficient
+        double transitivity;
+        // transitivity * wedges / 3, as every triangle closes three wedges
+        double triangles;
+    };
+
+    template<typename Vertex>
+    class basic_wedge_sampler {
+        const basic_csr_graph<Vertex>* graph;
+        // the nodes of degree at least 2, which are the centre of some wedge
+        std::vector<unsigned long> centres;
+        // Vose's alias table over the centres, weighted by the d(d - 1) / 2 wedges of each
+        std::vector<double> probability;
+        std::vector<unsigned long> alias;
+        unsigned long long wedges;
+
+    public:
+        explicit basic_wedge_sampler(const basic_csr_graph<Vertex> &graph);
+        unsigned long long number_of_wedges() const;
+        wedge_estimate sample_wedges(unsigned long number_of_samples, unsigned int threads,
+                                     unsigned long long seed) const;
+        sampling_estimate sample_triangles(const sampling_target &target, unsigned int threads,
+                                           unsigned long long seed) const;
+
+    private:
+        unsigned long sample_block(unsigned long long seed, unsigned long block, unsigned long count) const;
+    };
+
+    typedef basic_wedge_sampler<unsigned long> wedge_sampler;
+    typedef basic_wedge_sampler<unsigned int> compact_wedge_sampler;
+}
+
+#endif //TRIANGLECOUNTINGAPI_WEDGE_SAMPLER_H